@@ -0,0 +1,125 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Compares random page lookups through the blocking BufMgr::readPage with the
+// same lookups issued from coroutines via BufMgr::readPageAsync.
+// Build with "make bench" and run from the src directory:
+//   $ ./bench/async_read_bench [pages] [frames] [lookups] [coroutines]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "buffer_async.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_async.db";
+
+double secondsSince(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+void checkPage(Page* page, const PageId pageNo) {
+  const RecordId rid = {pageNo, 1};
+  if (page->getRecord(rid) != "page " + std::to_string(pageNo)) {
+    std::cerr << "Wrong contents on page " << pageNo << "\n";
+    std::exit(1);
+  }
+}
+
+AsyncTask lookups(BufMgr& bufMgr, File& file, const std::vector<PageId>& pageNos,
+                  std::size_t begin, std::size_t end, std::size_t stride) {
+  for (std::size_t i = begin; i < end; i += stride) {
+    PageHandle handle = co_await bufMgr.readPageAsync(&file, pageNos[i]);
+    checkPage(handle.get(), pageNos[i]);
+  }
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId numPages = argc > 1 ? std::atoi(argv[1]) : 2000;
+  const std::uint32_t numFrames = argc > 2 ? std::atoi(argv[2]) : 512;
+  const std::size_t numLookups = argc > 3 ? std::atoi(argv[3]) : 50000;
+  const std::size_t numCoroutines = argc > 4 ? std::atoi(argv[4]) : 128;
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    {
+      BufMgr loader(numFrames);
+      for (PageId i = 0; i < numPages; i++) {
+        PageId pageNo;
+        Page* page;
+        loader.allocPage(&file, pageNo, page);
+        page->insertRecord("page " + std::to_string(pageNo));
+        loader.unPinPage(&file, pageNo, true);
+      }
+      loader.flushFile(&file);
+    }
+
+    std::vector<PageId> pageNos(numLookups);
+    std::srand(42);
+    for (std::size_t i = 0; i < numLookups; i++) {
+      pageNos[i] = 1 + std::rand() % numPages;
+    }
+
+    double syncSeconds;
+    {
+      BufMgr bufMgr(numFrames);
+      const std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      for (std::size_t i = 0; i < numLookups; i++) {
+        Page* page;
+        bufMgr.readPage(&file, pageNos[i], page);
+        checkPage(page, pageNos[i]);
+        bufMgr.unPinPage(&file, pageNos[i], false);
+      }
+      syncSeconds = secondsSince(start);
+    }
+
+    double asyncSeconds;
+    std::size_t batches;
+    {
+      BufMgr bufMgr(numFrames);
+      AsyncScheduler scheduler;
+      const std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      for (std::size_t c = 0; c < numCoroutines; c++) {
+        scheduler.spawn(lookups(bufMgr, file, pageNos, c, numLookups,
+                                numCoroutines));
+      }
+      scheduler.run();
+      asyncSeconds = secondsSince(start);
+      batches = scheduler.batches();
+    }
+
+    std::cout << "pages=" << numPages << " frames=" << numFrames
+              << " lookups=" << numLookups
+              << " coroutines=" << numCoroutines << "\n";
+    std::cout << "readPage       " << numLookups / syncSeconds
+              << " lookups/s\n";
+    std::cout << "readPageAsync  " << numLookups / asyncSeconds
+              << " lookups/s (" << batches << " batches of reads started)\n";
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,154 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Measures what page checksums cost next to the page I/O they guard.  Times
+// CRC-32C of a page in hardware and in software, then a bare pread() of a
+// page and File::readPage(), which adds verification, with the file's pages
+// in the OS page cache: the cheapest I/O a page read can get, so the share
+// the checksum takes there is the most it can take.  Last, File::readPage()
+// with the pages dropped from the page cache, where the kernel allows it.
+// Build with "make bench" and run from the src directory:
+//   $ ./bench/checksum_bench [pages] [rounds]
+
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "crc32c.h"
+#include "file.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_checksum.db";
+
+typedef std::chrono::steady_clock Clock;
+
+double nanosPerPage(const Clock::time_point start, const std::size_t pages) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+             .count() / pages;
+}
+
+// Checksums a few pages over and over: File checksums a page right after
+// copying it, so it is in the CPU cache.
+double timeChecksum(const std::vector<char>& pages, const std::size_t times,
+                    const bool hardware, std::uint32_t& sink) {
+  const std::size_t count = pages.size() / Page::SIZE;
+  const Clock::time_point start = Clock::now();
+  for (std::size_t r = 0; r < times; r++) {
+    for (std::size_t p = 0; p < count; p++) {
+      const char* page = &pages[p * Page::SIZE];
+      sink ^= hardware ? Crc32c::extend(0, page, Page::SIZE)
+                       : Crc32c::extendSoftware(0, page, Page::SIZE);
+    }
+  }
+  return nanosPerPage(start, times * count);
+}
+
+double timePread(const PageId numPages, const std::size_t rounds) {
+  const int fd = ::open(kFilename.c_str(), O_RDONLY);
+  std::vector<char> page(Page::SIZE);
+  const Clock::time_point start = Clock::now();
+  for (std::size_t r = 0; r < rounds; r++) {
+    for (PageId p = 0; p < numPages; p++) {
+      // Same offsets as File, give or take the bitmap page.
+      if (::pread(fd, &page[0], Page::SIZE, (p + 1) * Page::SIZE) < 0) {
+        std::cerr << "pread failed\n";
+        std::exit(1);
+      }
+    }
+  }
+  const double nanos = nanosPerPage(start, rounds * numPages);
+  ::close(fd);
+  return nanos;
+}
+
+void dropFromPageCache() {
+  const int fd = ::open(kFilename.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+double timeReadPage(const File& file, const PageId numPages,
+                    const std::size_t rounds) {
+  const Clock::time_point start = Clock::now();
+  for (std::size_t r = 0; r < rounds; r++) {
+    for (PageId p = 1; p <= numPages; p++) {
+      file.readPage(p);
+    }
+  }
+  return nanosPerPage(start, rounds * numPages);
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId numPages = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const std::size_t rounds = argc > 2 ? std::atoi(argv[2]) : 10;
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  std::vector<char> images(16 * Page::SIZE);
+  for (std::size_t i = 0; i < images.size(); i++) {
+    images[i] = static_cast<char>(i * 31 + i / 7);
+  }
+  std::uint32_t sink = 0;
+  const std::size_t times = numPages * rounds / 16;
+  const double hardware = timeChecksum(images, times, true, sink);
+  const double software = timeChecksum(images, times, false, sink);
+
+  {
+    File file = File::create(kFilename);
+    file.setDurability(File::NO_SYNC);
+    std::vector<Page> pages = file.allocatePages(numPages);
+    std::vector<const Page*> batch;
+    for (PageId p = 0; p < numPages; p++) {
+      while (pages[p].hasSpaceForRecord("record of some text payload")) {
+        pages[p].insertRecord("record of some text payload");
+      }
+      batch.push_back(&pages[p]);
+    }
+    file.writePages(batch);
+
+    // Warm the page cache, then time.
+    timeReadPage(file, numPages, 1);
+    const double pread = timePread(numPages, rounds);
+    const double readPage = timeReadPage(file, numPages, rounds);
+    dropFromPageCache();
+    const double coldReadPage = timeReadPage(file, numPages, 1);
+    const double active = Crc32c::isHardware() ? hardware : software;
+
+    std::cout << "pages=" << numPages << " rounds=" << rounds
+              << " (checksum " << sink % 2 << ")\n";
+    std::cout << "crc32c hardware: " << hardware << " ns/page"
+              << (Crc32c::isHardware() ? "" : " (not available, software)")
+              << "\n";
+    std::cout << "crc32c software: " << software << " ns/page\n";
+    std::cout << "pread:           " << pread << " ns/page\n";
+    std::cout << "File::readPage:  " << readPage << " ns/page\n";
+    std::cout << "File::readPage, not cached: " << coldReadPage << " ns/page\n";
+    std::cout << "checksum share of a cached readPage: "
+              << 100.0 * active / readPage << "%\n";
+    std::cout << "checksum share of an uncached readPage: "
+              << 100.0 * active / coldReadPage << "%\n";
+  }
+  File::remove(kFilename);
+
+  return 0;
+}
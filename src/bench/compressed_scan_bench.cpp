@@ -0,0 +1,153 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Compares a full scan of a compressed file (File::createCompressed()) with
+// the same scan of a plain file holding the same pages.  The pages are filled
+// with short text records, a typical table.  Reports the size of each file,
+// the time to write it, and scan throughput with the file in the OS page
+// cache and, where the kernel allows dropping it, read from the device.
+// Build with "make bench" and run from the src directory:
+//   $ ./bench/compressed_scan_bench [pages] [rounds]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "file.h"
+#include "file_iterator.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kPlainFilename = "bench_scan_plain.db";
+const std::string kCompressedFilename = "bench_scan_compressed.db";
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds(const Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void removeIfExists(const std::string& filename) {
+  try {
+    File::remove(filename);
+  } catch (FileNotFoundException&) {
+  }
+}
+
+void dropFromPageCache(const std::string& filename) {
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+off_t fileSize(const std::string& filename) {
+  struct stat info;
+  return ::stat(filename.c_str(), &info) == 0 ? info.st_size : 0;
+}
+
+// Fills the file with numPages pages of records, in batches.
+double load(File& file, const PageId numPages) {
+  const Clock::time_point start = Clock::now();
+  const PageId batchSize = 256;
+  char record[64];
+  unsigned int key = 0;
+  for (PageId done = 0; done < numPages; done += batchSize) {
+    std::vector<Page> pages =
+        file.allocatePages(std::min(batchSize, numPages - done));
+    std::vector<const Page*> batch;
+    for (std::size_t p = 0; p < pages.size(); p++) {
+      for (;;) {
+        std::snprintf(record, sizeof(record), "%08u|customer#%06u|%9.2f|open",
+                      key, key % 150000, (key % 99991) * 1.37);
+        if (!pages[p].hasSpaceForRecord(record)) {
+          break;
+        }
+        pages[p].insertRecord(record);
+        key++;
+      }
+      batch.push_back(&pages[p]);
+    }
+    file.writePages(batch);
+  }
+  file.sync();
+  return seconds(start);
+}
+
+// Reads every page through the file iterator, returning pages per second.
+double scan(File& file, const std::size_t rounds, std::size_t& records) {
+  const Clock::time_point start = Clock::now();
+  std::size_t pages = 0;
+  for (std::size_t r = 0; r < rounds; r++) {
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      Page page = *iter;
+      records += page.getFreeSpace() > 0;
+      pages++;
+    }
+  }
+  return pages / seconds(start);
+}
+
+void report(const char* name, const std::string& filename, File& file,
+            const double loadSeconds, const PageId numPages,
+            const std::size_t rounds) {
+  std::size_t sink = 0;
+  scan(file, 1, sink);
+  const double cached = scan(file, rounds, sink);
+  dropFromPageCache(filename);
+  const double uncached = scan(file, 1, sink);
+  const double mb = static_cast<double>(Page::SIZE) / (1 << 20);
+  std::cout << name << ": " << fileSize(filename) / (1 << 20) << " MB on disk, "
+            << "load " << numPages / loadSeconds << " pages/s, "
+            << "scan cached " << cached << " pages/s ("
+            << cached * mb << " MB/s), uncached " << uncached
+            << " pages/s (" << uncached * mb << " MB/s)"
+            << (sink == 0 ? " (empty)" : "") << "\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId numPages = argc > 1 ? std::atoi(argv[1]) : 16384;
+  const std::size_t rounds = argc > 2 ? std::atoi(argv[2]) : 3;
+
+  removeIfExists(kPlainFilename);
+  removeIfExists(kCompressedFilename);
+
+  std::cout << "pages=" << numPages << " rounds=" << rounds
+            << " (throughput in uncompressed pages)\n";
+  {
+    File plain = File::create(kPlainFilename);
+    const double loadSeconds = load(plain, numPages);
+    report("plain     ", kPlainFilename, plain, loadSeconds, numPages, rounds);
+  }
+  {
+    File compressed = File::createCompressed(kCompressedFilename);
+    const double loadSeconds = load(compressed, numPages);
+    report("compressed", kCompressedFilename, compressed, loadSeconds,
+           numPages, rounds);
+  }
+  std::cout << "compression ratio: "
+            << static_cast<double>(fileSize(kPlainFilename)) /
+                   fileSize(kCompressedFilename) << "\n";
+
+  File::remove(kPlainFilename);
+  File::remove(kCompressedFilename);
+
+  return 0;
+}
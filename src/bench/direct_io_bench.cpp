@@ -0,0 +1,134 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Compares buffered and direct (O_DIRECT) file I/O under a BufMgr doing random
+// page lookups, one in eight of them dirtying the page.  Besides throughput it
+// reports the memory holding the file's pages: the buffer pool itself plus
+// whatever the OS page cache keeps of the file, as measured with mincore().
+// Build with "make bench" and run from the src directory:
+//   $ ./bench/direct_io_bench [pages] [frames] [lookups]
+
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_direct_io.db";
+
+void dropFromPageCache() {
+  const int fd = ::open(kFilename.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+// Bytes of the file resident in the OS page cache.
+std::size_t pageCacheBytes() {
+  const int fd = ::open(kFilename.c_str(), O_RDONLY);
+  struct stat info;
+  if (fd < 0 || ::fstat(fd, &info) != 0 || info.st_size == 0) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    return 0;
+  }
+  void* map = ::mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    return 0;
+  }
+  const std::size_t osPage = ::sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> resident((info.st_size + osPage - 1) / osPage);
+  std::size_t bytes = 0;
+  if (::mincore(map, info.st_size, &resident[0]) == 0) {
+    for (std::size_t i = 0; i < resident.size(); i++) {
+      bytes += (resident[i] & 1) * osPage;
+    }
+  }
+  ::munmap(map, info.st_size);
+  return bytes;
+}
+
+void run(const char* mode, const bool direct, const std::uint32_t numFrames,
+         const std::vector<PageId>& pageNos) {
+  dropFromPageCache();
+  File file = File::open(kFilename, direct);
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  {
+    BufMgr bufMgr(numFrames);
+    for (std::size_t i = 0; i < pageNos.size(); i++) {
+      Page* page;
+      bufMgr.readPage(&file, pageNos[i], page);
+      bufMgr.unPinPage(&file, pageNos[i], i % 8 == 0);
+    }
+    bufMgr.flushFile(&file);
+  }
+  const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  const double mb = 1024.0 * 1024.0;
+  std::cout << mode << (direct && !file.isDirect() ? " (fell back)" : "")
+            << "\t" << pageNos.size() / seconds << "\t\t"
+            << numFrames * Page::SIZE / mb << "\t\t" << pageCacheBytes() / mb
+            << "\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId numPages = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const std::uint32_t numFrames = argc > 2 ? std::atoi(argv[2]) : 1024;
+  const std::size_t numLookups = argc > 3 ? std::atoi(argv[3]) : 50000;
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    BufMgr loader(numFrames);
+    for (PageId i = 0; i < numPages; i++) {
+      PageId pageNo;
+      Page* page;
+      loader.allocPage(&file, pageNo, page);
+      page->insertRecord("page " + std::to_string(pageNo));
+      loader.unPinPage(&file, pageNo, true);
+    }
+    loader.flushFile(&file);
+  }
+
+  std::vector<PageId> pageNos(numLookups);
+  std::minstd_rand rng(42);
+  for (std::size_t i = 0; i < numLookups; i++) {
+    pageNos[i] = 1 + rng() % numPages;
+  }
+
+  std::cout << "pages=" << numPages << " frames=" << numFrames
+            << " lookups=" << numLookups << "\n";
+  std::cout << "mode\t\tlookups/s\tpool(MB)\tpage cache(MB)\n";
+  run("buffered", false, numFrames, pageNos);
+  run("direct", true, numFrames, pageNos);
+
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Sweeps the queue depth from 1 to 64 for random page reads from a local file,
+// comparing blocking File::readPage with File::readPageAsync through the
+// io_uring and thread pool backends of PageIoQueue.  The file's pages are
+// dropped from the OS page cache before each run where the kernel allows it.
+// Build with "make bench" and run from the src directory:
+//   $ ./bench/page_io_bench [pages] [reads]
+
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "file.h"
+#include "page_io.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/io_error_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_page_io.db";
+
+void dropFromPageCache() {
+  const int fd = ::open(kFilename.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+std::vector<PageId> randomPages(PageId numPages, std::size_t reads) {
+  std::minstd_rand rng(42);
+  std::vector<PageId> pageNos(reads);
+  for (std::size_t i = 0; i < reads; i++) {
+    pageNos[i] = 1 + rng() % numPages;
+  }
+  return pageNos;
+}
+
+double runSync(const File& file, const std::vector<PageId>& pageNos) {
+  dropFromPageCache();
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < pageNos.size(); i++) {
+    file.readPage(pageNos[i]);
+  }
+  return pageNos.size() / std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+// Keeps up to depth reads in flight, in batches of depth.
+double runQueue(const File& file, PageIoQueue& queue,
+                const std::vector<PageId>& pageNos) {
+  std::vector<Page> pages(queue.queueDepth());
+  dropFromPageCache();
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::size_t next = 0;
+  while (next < pageNos.size()) {
+    for (std::size_t i = 0; i < pages.size() && next < pageNos.size(); i++) {
+      file.readPageAsync(queue, pageNos[next++], pages[i]);
+    }
+    queue.submitAndWait();
+  }
+  return pageNos.size() / std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId numPages = argc > 1 ? std::atoi(argv[1]) : 16384;
+  const std::size_t reads = argc > 2 ? std::atoi(argv[2]) : 20000;
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    // Temporary files allocate in memory, so setup stays linear.
+    File file = File::createTemp(kFilename);
+    for (PageId p = 0; p < numPages; p++) {
+      Page page = file.allocatePage();
+      page.insertRecord("page " + std::to_string(page.page_number()));
+      file.writePage(page);
+    }
+    const std::vector<PageId> pageNos = randomPages(numPages, reads);
+
+    std::cout << "pages=" << numPages << " reads=" << reads << "\n";
+    std::cout << "sync: " << runSync(file, pageNos) << " reads/s\n";
+    std::cout << "depth  io_uring(reads/s)  thread pool(reads/s)\n";
+    for (unsigned depth = 1; depth <= 64; depth *= 2) {
+      std::cout << depth << "\t ";
+      try {
+        std::unique_ptr<PageIoQueue> ring(
+            PageIoQueue::create(depth, PageIoQueue::IO_URING));
+        std::cout << runQueue(file, *ring, pageNos);
+      } catch (IoErrorException&) {
+        std::cout << "n/a";
+      }
+      std::unique_ptr<PageIoQueue> pool(
+          PageIoQueue::create(depth, PageIoQueue::THREAD_POOL));
+      std::cout << "\t\t" << runQueue(file, *pool, pageNos) << "\n";
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Measures (file, page) -> frame lookups per second on resident pages as the
+// number of threads grows from 1 to 64, for BufHashTbl behind one latch
+// versus LockFreePageTable, while one writer thread keeps inserting and
+// removing other pages.
+// Build with "make bench" and run from the src directory:
+//   $ ./bench/page_table_bench [pages] [lookups per thread]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bufHashTbl.h"
+#include "lock_free_page_table.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_page_table.db";
+
+struct LatchedTable {
+  explicit LatchedTable(std::uint32_t pages) : table(pages * 2 + 1) {}
+
+  bool find(const File* file, PageId pageNo, FrameId& frame) {
+    std::lock_guard<std::mutex> guard(latch);
+    return table.find(file, pageNo, frame);
+  }
+  void insert(const File* file, PageId pageNo, FrameId frame) {
+    std::lock_guard<std::mutex> guard(latch);
+    table.insert(file, pageNo, frame);
+  }
+  void remove(const File* file, PageId pageNo) {
+    std::lock_guard<std::mutex> guard(latch);
+    table.remove(file, pageNo);
+  }
+
+  std::mutex latch;
+  BufHashTbl table;
+};
+
+struct FreeTable {
+  explicit FreeTable(std::uint32_t pages) : table(pages * 2) {}
+
+  bool find(const File* file, PageId pageNo, FrameId& frame) {
+    return table.find(file->pageKey(pageNo), frame);
+  }
+  void insert(const File* file, PageId pageNo, FrameId frame) {
+    table.insert(file->pageKey(pageNo), frame);
+  }
+  void remove(const File* file, PageId pageNo) {
+    table.remove(file->pageKey(pageNo));
+  }
+
+  LockFreePageTable table;
+};
+
+template <typename Table>
+double run(Table& table, const File* file, PageId numPages,
+           unsigned numThreads, std::size_t lookups) {
+  std::atomic<bool> done(false);
+  // Churns pages numPages+1 .. 2*numPages, which readers never look up.
+  std::thread writer([&]() {
+    PageId next = 0;
+    while (!done.load(std::memory_order_relaxed)) {
+      const PageId pageNo = numPages + 1 + next % numPages;
+      table.insert(file, pageNo, pageNo);
+      table.remove(file, pageNo);
+      next++;
+    }
+  });
+
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::vector<std::thread> readers;
+  for (unsigned t = 0; t < numThreads; t++) {
+    readers.push_back(std::thread([&table, file, numPages, lookups, t]() {
+      std::minstd_rand rng(t + 1);
+      FrameId frame;
+      std::size_t found = 0;
+      for (std::size_t i = 0; i < lookups; i++) {
+        found += table.find(file, 1 + rng() % numPages, frame);
+      }
+      if (found != lookups) {
+        std::cerr << "lost " << lookups - found << " lookups\n";
+      }
+    }));
+  }
+  for (unsigned t = 0; t < numThreads; t++) {
+    readers[t].join();
+  }
+  const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  done = true;
+  writer.join();
+  return numThreads * lookups / seconds;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId numPages = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const std::size_t lookups = argc > 2 ? std::atoi(argv[2]) : 1000000;
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    // Only the file's id is used; no pages are written.
+    File file = File::create(kFilename);
+
+    std::cout << "pages=" << numPages
+              << " cores=" << std::thread::hardware_concurrency() << "\n";
+    std::cout << "threads  latched(lookups/s)  lock-free(lookups/s)\n";
+    for (unsigned threads = 1; threads <= 64; threads *= 2) {
+      LatchedTable latched(numPages * 2);
+      FreeTable lockFree(numPages * 2);
+      for (PageId p = 1; p <= numPages; p++) {
+        latched.insert(&file, p, p);
+        lockFree.insert(&file, p, p);
+      }
+      const double latchedRate = run(latched, &file, numPages, threads,
+                                     lookups);
+      const double freeRate = run(lockFree, &file, numPages, threads, lookups);
+      std::cout << threads << "\t " << latchedRate << "\t\t" << freeRate
+                << "\n";
+    }
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
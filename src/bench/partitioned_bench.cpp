@@ -0,0 +1,107 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Measures readPage/unPinPage throughput on resident pages as the number of
+// threads grows, for one latched pool versus a partitioned pool.
+// Build with "make bench" and run from the src directory:
+//   $ ./bench/partitioned_bench [pages] [partitions] [lookups per thread]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "partitioned_buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_partitioned.db";
+
+void worker(PartitionedBufMgr* bufMgr, File* file, PageId numPages,
+            std::size_t lookups, unsigned seed) {
+  std::minstd_rand rng(seed);
+  for (std::size_t i = 0; i < lookups; i++) {
+    const PageId pageNo = 1 + rng() % numPages;
+    Page* page;
+    bufMgr->readPage(file, pageNo, page);
+    bufMgr->unPinPage(file, pageNo, false);
+  }
+}
+
+double run(PartitionedBufMgr& bufMgr, File& file, PageId numPages,
+           unsigned numThreads, std::size_t lookups) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < numThreads; t++) {
+    threads.push_back(std::thread(worker, &bufMgr, &file, numPages, lookups,
+                                  t + 1));
+  }
+  for (unsigned t = 0; t < numThreads; t++) {
+    threads[t].join();
+  }
+  const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return numThreads * lookups / seconds;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId numPages = argc > 1 ? std::atoi(argv[1]) : 1000;
+  const std::uint32_t numPartitions = argc > 2 ? std::atoi(argv[2]) : 16;
+  const std::size_t lookups = argc > 3 ? std::atoi(argv[3]) : 1000000;
+  // Room for every page in every partition, so the runs measure the hit path.
+  const std::uint32_t numFrames = numPages * 2;
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    File file = File::create(kFilename);
+    for (PageId i = 0; i < numPages; i++) {
+      Page page = file.allocatePage();
+      page.insertRecord("page");
+      file.writePage(page);
+    }
+
+    unsigned maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads < 8) {
+      maxThreads = 8;
+    }
+
+    std::cout << "pages=" << numPages << " partitions=" << numPartitions
+              << " cores=" << std::thread::hardware_concurrency() << "\n";
+    std::cout << "threads  one-latch(lookups/s)  partitioned(lookups/s)\n";
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+      PartitionedBufMgr single(numFrames, 1);
+      PartitionedBufMgr partitioned(numFrames, numPartitions);
+      // Warm both pools so every lookup is a hit.
+      run(single, file, numPages, 1, numPages * 4);
+      run(partitioned, file, numPages, 1, numPages * 4);
+
+      const double singleRate = run(single, file, numPages, threads, lookups);
+      const double partRate = run(partitioned, file, numPages, threads,
+                                  lookups);
+      std::cout << threads << "\t " << singleRate << "\t\t\t" << partRate
+                << "\n";
+      single.flushFile(&file);
+      partitioned.flushFile(&file);
+    }
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
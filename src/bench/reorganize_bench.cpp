@@ -0,0 +1,131 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Shows what File::reorganize() gains for scans of a compressed file after
+// churn.  The file is loaded in page order, then random pages grow, which
+// moves them to new slots, and some are deleted and allocated again.  Scan
+// locality (File::scanLocality()) and the throughput of a scan read from the
+// device, where the kernel allows dropping the page cache, are reported
+// before and after reorganizing at a bounded rate.
+// Build with "make bench" and run from the src directory:
+//   $ ./bench/reorganize_bench [pages] [MB/s, 0 for no bound]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "file.h"
+#include "file_iterator.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_reorganize.db";
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds(const Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void dropFromPageCache() {
+  const int fd = ::open(kFilename.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+  }
+}
+
+// Pages per second of a scan that starts with nothing cached.
+double coldScan(File& file) {
+  dropFromPageCache();
+  const Clock::time_point start = Clock::now();
+  std::size_t pages = 0;
+  for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+    Page page = *iter;
+    pages += page.page_number() != Page::INVALID_NUMBER;
+  }
+  return pages / seconds(start);
+}
+
+void report(const char* when, File& file) {
+  const ScanLocality locality = file.scanLocality();
+  std::cout << when << ": " << locality.sequential << " of " << locality.pages
+            << " pages in sequence, " << locality.backward
+            << " backward seeks, " << locality.bytes / 1024 << " KB read over "
+            << locality.span / 1024 << " KB, cold scan " << coldScan(file)
+            << " pages/s\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId numPages = argc > 1 ? std::atoi(argv[1]) : 16384;
+  const off_t rate = (argc > 2 ? std::atoi(argv[2]) : 64) * (off_t(1) << 20);
+
+  try {
+    File::remove(kFilename);
+  } catch (FileNotFoundException&) {
+  }
+
+  {
+    File file = File::createCompressed(kFilename);
+    file.setDurability(File::NO_SYNC);
+    char record[64];
+    unsigned int key = 0;
+    for (PageId p = 0; p < numPages; p++) {
+      Page page = file.allocatePage();
+      for (int r = 0; r < 40; r++) {
+        std::snprintf(record, sizeof(record), "%08u|customer#%06u|%9.2f|open",
+                      key, key % 150000, (key % 99991) * 1.37);
+        page.insertRecord(record);
+        key++;
+      }
+      file.writePage(page);
+    }
+
+    std::mt19937 random(50);
+    for (PageId i = 0; i < numPages / 2; i++) {
+      const PageId n = random() % numPages + 1;
+      Page page = file.readPage(n);
+      for (int r = 0; r < 40 && page.hasSpaceForRecord(record); r++) {
+        std::snprintf(record, sizeof(record), "%08u|customer#%06u|%9.2f|late",
+                      key, key % 150000, (key % 99991) * 1.37);
+        page.insertRecord(record);
+        key++;
+      }
+      file.writePage(page);
+    }
+    for (PageId n = 1; n <= numPages; n += 17) {
+      file.deletePage(n);
+    }
+    for (PageId n = 1; n <= numPages; n += 17) {
+      file.writePage(file.allocatePage());
+    }
+
+    report("before", file);
+    const Clock::time_point start = Clock::now();
+    const off_t moved = file.reorganize(rate);
+    const double elapsed = seconds(start);
+    std::cout << "reorganize: moved " << moved / 1024 << " KB in " << elapsed
+              << " s (" << moved / elapsed / (1 << 20) << " MB/s, bound "
+              << rate / (1 << 20) << " MB/s)\n";
+    report("after ", file);
+  }
+  File::remove(kFilename);
+
+  return 0;
+}
@@ -15,17 +15,19 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+int BufHashTbl::hash(const PageKey key)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
-  return value;
+  // Fibonacci hashing spreads both the file id and the page number over the
+  // high bits before reducing to the table size.
+  const PageKey mixed = key * 0x9E3779B97F4A7C15ULL;
+  return (int) ((mixed >> 32) % HTSIZE);
 }
 
-BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+BufHashTbl::BufHashTbl(const int htSize, const bool useLockFree)
+	: HTSIZE(htSize), ht(NULL), lockFree(useLockFree ? new LockFreePageTable(htSize) : NULL)
 {
+  if (lockFree)
+    return;
   // allocate an array of pointers to hashBuckets
   ht = new hashBucket* [htSize];
   for(int i=0; i < HTSIZE; i++)
@@ -34,6 +36,10 @@ BufHashTbl::BufHashTbl(int htSize)
 
 BufHashTbl::~BufHashTbl()
 {
+  if (lockFree) {
+    delete lockFree;
+    return;
+  }
   for(int i = 0; i < HTSIZE; i++) {
     hashBucket* tmpBuf = ht[i];
     while (ht[i]) {
@@ -47,12 +53,21 @@ BufHashTbl::~BufHashTbl()
 
 void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
 {
-  int index = hash(file, pageNo);
+  const PageKey key = file->pageKey(pageNo);
+  if (lockFree) {
+    if (!lockFree->insert(key, frameNo)) {
+      FrameId present = 0;
+      lockFree->find(key, present);
+      throw HashAlreadyPresentException(file->filename(), pageNo, present);
+    }
+    return;
+  }
+  int index = hash(key);
 
   hashBucket* tmpBuc = ht[index];
   while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
+    if (tmpBuc->key == key)
+  		throw HashAlreadyPresentException(file->filename(), pageNo, tmpBuc->frameNo);
     tmpBuc = tmpBuc->next;
   }
 
@@ -60,38 +75,51 @@ void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId fra
   if (!tmpBuc)
   	throw HashTableException();
 
-  tmpBuc->file = (File*) file;
-  tmpBuc->pageNo = pageNo;
+  tmpBuc->key = key;
   tmpBuc->frameNo = frameNo;
   tmpBuc->next = ht[index];
   ht[index] = tmpBuc;
 }
 
-void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
+bool BufHashTbl::find(const File* file, const PageId pageNo, FrameId &frameNo)
 {
-  int index = hash(file, pageNo);
+  const PageKey key = file->pageKey(pageNo);
+  if (lockFree)
+    return lockFree->find(key, frameNo);
+  int index = hash(key);
   hashBucket* tmpBuc = ht[index];
   while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+    if (tmpBuc->key == key)
     {
       frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
+      return true;
     }
     tmpBuc = tmpBuc->next;
   }
+  return false;
+}
 
-  throw HashNotFoundException(file->filename(), pageNo);
+void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
+{
+  if (!find(file, pageNo, frameNo))
+    throw HashNotFoundException(file->filename(), pageNo);
 }
 
 void BufHashTbl::remove(const File* file, const PageId pageNo) {
 
-  int index = hash(file, pageNo);
+  const PageKey key = file->pageKey(pageNo);
+  if (lockFree) {
+    if (!lockFree->remove(key))
+      throw HashNotFoundException(file->filename(), pageNo);
+    return;
+  }
+  int index = hash(key);
   hashBucket* tmpBuc = ht[index];
   hashBucket* prevBuc = NULL;
 
   while (tmpBuc)
 	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+    if (tmpBuc->key == key)
 		{
       if(prevBuc) 
 				prevBuc->next = tmpBuc->next;
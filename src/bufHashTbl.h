@@ -8,6 +8,7 @@
 #pragma once
 
 #include "file.h"
+#include "lock_free_page_table.h"
 
 namespace badgerdb {
 
@@ -16,14 +17,9 @@ namespace badgerdb {
 */
 struct hashBucket {
 	/**
-	 * pointer a file object (more on this below)
+	 * key of the page, packs the file identifier and page number within the file
 	 */
-	File *file;
-
-	/**
-	 * page number within a file
-	 */
-	PageId pageNo;
+	PageKey key;
 
 	/**
 	 * frame number of page in the buffer pool
@@ -40,7 +36,11 @@ struct hashBucket {
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
-* @warning This class is not threadsafe.
+* Chained by default.  A table built lock-free keeps its entries in a
+* LockFreePageTable instead, so find() may run in other threads alongside the
+* one thread changing the table.
+*
+* @warning Otherwise this class is not threadsafe.
 */
 class BufHashTbl
 {
@@ -55,19 +55,26 @@ class BufHashTbl
   hashBucket**  ht;
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * Entries of a lock-free table, NULL for a chained one
+	 */
+  LockFreePageTable* lockFree;
+
+	/**
+	 * returns hash value between 0 and HTSIZE-1 computed using the page key
 	 *
-	 * @param file   	File object
-	 * @param pageNo  Page number in the file
+	 * @param key   	Key of the page, see File::pageKey()
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  int	 hash(const PageKey key);
 
  public:
 	/**
    * Constructor of BufHashTbl class
+	 *
+	 * @param htSize  	Number of buckets, or of entries for a lock-free table
+	 * @param useLockFree	True to keep the entries in a LockFreePageTable
 	 */
-	BufHashTbl(const int htSize);  // constructor
+	BufHashTbl(const int htSize, const bool useLockFree = false);  // constructor
 
 	/**
    * Destructor of BufHashTbl class
@@ -96,6 +103,22 @@ class BufHashTbl
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
+	/**
+   * Same as lookup() but reports a missing entry by returning false instead of
+   * throwing, for callers that expect misses.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, set only if the entry is found
+	 * @return  			True if the entry is found
+	 */
+  bool find(const File* file, const PageId pageNo, FrameId &frameNo);
+
+	/**
+   * Returns true if the table was built lock-free.
+	 */
+  bool isLockFree() const { return lockFree != NULL; }
+
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
@@ -15,17 +15,20 @@
 
 #include <memory>
 #include <iostream>
+#include <algorithm>
+#include <utility>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
+#include "exceptions/invalid_quota_exception.h"
 
 namespace badgerdb { 
 
 BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
+	: numBufs(bufs), combineWindow(DEFAULT_COMBINE_WINDOW), accessClock(0), compressedCache(NULL), cacheFile(NULL), reservedFrames(0), ioQueue(NULL) {
 	bufDescTable = new BufDesc[bufs];
 
   for (FrameId i = 0; i < bufs; i++) 
@@ -52,10 +55,135 @@ BufMgr::~BufMgr() {
 		if (bufDescTable[i].dirty) {
 			bufDescTable[i].file->writePage(bufPool[i]);
 		}
+		detachSnapshot(i);
 	}
 	delete[] bufPool;
 	delete hashTable;
 	delete[] bufDescTable;
+	delete compressedCache;
+	delete cacheFile;
+	delete ioQueue;
+}
+
+bool BufMgr::isResident(const File* file, const PageId pageNo) const
+{
+	FrameId frame;
+	return hashTable->find(file, pageNo, frame);
+}
+
+void BufMgr::enableLockFreeTable()
+{
+	if (hashTable->isLockFree())
+		return;
+	BufHashTbl* table = new BufHashTbl(((((int) (numBufs * 1.2))*2)/2)+1, true);
+	for (FrameId i = 0; i < numBufs; i++) {
+		if (bufDescTable[i].valid)
+			table->insert(bufDescTable[i].file, bufDescTable[i].pageNo, i);
+	}
+	delete hashTable;
+	hashTable = table;
+}
+
+void BufMgr::enableCompressedCache(const std::size_t capacity)
+{
+	delete compressedCache;
+	compressedCache = capacity > 0 ? new CompressedPageCache(capacity) : NULL;
+}
+
+void BufMgr::enableCacheFile(const std::string& path, const std::uint32_t numPages)
+{
+	delete cacheFile;
+	cacheFile = NULL;
+	if (numPages > 0) {
+		cacheFile = new PageCacheFile(path, numPages);
+	}
+}
+
+void BufMgr::enableAsyncIo(const unsigned queueDepth, const PageIoQueue::Backend backend)
+{
+	delete ioQueue;
+	ioQueue = NULL;
+	if (queueDepth > 0) {
+		ioQueue = PageIoQueue::create(queueDepth, backend);
+	}
+}
+
+void BufMgr::spillFrame(const FrameId frame)
+{
+	const BufDesc& desc = bufDescTable[frame];
+	if (compressedCache) {
+		compressedCache->insert(desc.file, desc.pageNo, bufPool[frame]);
+	}
+	if (cacheFile) {
+		cacheFile->insert(desc.file, desc.pageNo, bufPool[frame]);
+	}
+}
+
+bool BufMgr::readFromCaches(const File* file, const PageId pageNo, Page& page)
+{
+	if (compressedCache && compressedCache->lookup(file, pageNo, page)) {
+		return true;
+	}
+	return cacheFile && cacheFile->lookup(file, pageNo, page);
+}
+
+void BufMgr::dropFromCaches(const File* file, const PageId pageNo)
+{
+	if (compressedCache) {
+		compressedCache->remove(file, pageNo);
+	}
+	if (cacheFile) {
+		cacheFile->remove(file, pageNo);
+	}
+}
+
+void BufMgr::setWriteCombineWindow(const std::uint32_t pages)
+{
+	combineWindow = pages;
+}
+
+bool BufMgr::isCombinable(const File* file, const PageId pageNo, FrameId& frame)
+{
+	return pageNo != Page::INVALID_NUMBER && hashTable->find(file, pageNo, frame) &&
+		bufDescTable[frame].dirty && bufDescTable[frame].pinCnt == 0;
+}
+
+void BufMgr::writeDirtyRun(const FrameId frame)
+{
+	/*	Grow a run of consecutive dirty, unpinned pages of the same file
+	 *	around the victim, up to combineWindow pages on each side, and write
+	 *	it with one request. The neighbours stay cached, but are clean now.
+	 */
+	BufDesc& victim = bufDescTable[frame];
+	std::vector<FrameId> below, above;
+	FrameId neighbour;
+	for (std::uint32_t k = 1; k <= combineWindow && k < victim.pageNo; k++) {
+		if (!isCombinable(victim.file, victim.pageNo - k, neighbour))
+			break;
+		below.push_back(neighbour);
+	}
+	for (std::uint32_t k = 1; k <= combineWindow; k++) {
+		if (!isCombinable(victim.file, victim.pageNo + k, neighbour))
+			break;
+		above.push_back(neighbour);
+	}
+
+	std::vector<FrameId> run(below.rbegin(), below.rend());
+	run.push_back(frame);
+	run.insert(run.end(), above.begin(), above.end());
+
+	std::vector<const Page*> pages;
+	pages.reserve(run.size());
+	for (std::size_t i = 0; i < run.size(); i++) {
+		pages.push_back(&bufPool[run[i]]);
+	}
+	victim.file->writePages(pages);
+
+	for (std::size_t i = 0; i < run.size(); i++) {
+		bufDescTable[run[i]].dirty = false;
+	}
+	bufStats.diskwrites += run.size();
+	bufStats.combinedwrites += run.size() - 1;
 }
 
 void BufMgr::advanceClock()
@@ -66,28 +194,54 @@ void BufMgr::advanceClock()
 	clockHand = (clockHand + 1) % numBufs;
 }
 
-void BufMgr::allocBuf(FrameId & frame) 
+bool BufMgr::isReplaceable(const BufDesc& desc, const FileId fileId, const bool capped) const
+{
+	if (desc.fileId == fileId)
+		return true;
+	if (capped)
+		return false;
+	std::map<FileId, FileQuota>::const_iterator quota = quotas.find(desc.fileId);
+	return quota == quotas.end() || quota->second.resident > quota->second.minFrames;
+}
+
+void BufMgr::allocBuf(FrameId & frame, const File* file) 
 {
 	/*	Allocate free frame using clock policy.
 	 *	If replacing frame, remove from hashTable and write to disk if dirty.
-	 *	Throw exception if all frames pinned.
+	 *	Frames the file's quota does not let it take are passed over.
+	 *	Throw exception if all frames pinned, or if there are no frames at all.
 	 *	Not threadsafe.
 	 */
+	if (numBufs == 0)
+		throw BufferExceededException();
+	const FileId fileId = file->id();
+	std::map<FileId, FileQuota>::const_iterator quota = quotas.find(fileId);
+	// A capped file may only replace its own pages, never take a free frame
+	const bool capped = quota != quotas.end() && quota->second.maxFrames > 0 &&
+		quota->second.resident >= quota->second.maxFrames;
+
 	FrameId startFrame = clockHand; // Initial frame, so we know we went around
 	bool frameAvail = false; // Track whether there is an unpinned page in buffer
 	
 	while(true) {
 		if(!bufDescTable[clockHand].valid) {
 			// Always choose if current frame invalid.
-			frame = clockHand;
+			if (!capped) {
+				frame = clockHand;
+				advanceClock();
+				return;
+			}
 			advanceClock();
-			return;
 		}
 		else if(bufDescTable[clockHand].pinCnt > 0) {
 			// If current frame in use, dereference and skip.
 			bufDescTable[clockHand].refbit = 0;
 			advanceClock();
 		}
+		else if(!isReplaceable(bufDescTable[clockHand], fileId, capped)) {
+			// Protected by a quota, leave its refbit for its own file's allocations.
+			advanceClock();
+		}
 		else if(bufDescTable[clockHand].refbit == 1) {
 			// If current frame not in use, but referenced, dereference and skip.
 			bufDescTable[clockHand].refbit = 0;
@@ -97,13 +251,16 @@ void BufMgr::allocBuf(FrameId & frame)
 		else {
 			// Valid, unpinned, unreferenced -> Replace frame
 			if(bufDescTable[clockHand].dirty) {
-				// Need to write dirty frame to disk before replacing
-				bufDescTable[clockHand].file->writePage(bufPool[clockHand]);
-				bufDescTable[clockHand].dirty = false;
+				// Need to write dirty frame to disk before replacing, along with any dirty neighbours
+				writeDirtyRun(clockHand);
 			}
+			// Frame is clean now, keep a copy in the second-tier caches
+			spillFrame(clockHand);
 			// Need to remove reference to existing frame from HashTable
 			hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-			bufDescTable[clockHand].Clear();
+			releaseFrame(clockHand);
+			if (capped)
+				bufStats.quotaevictions++;
 			frame = clockHand;
 			advanceClock();
 			return;
@@ -115,6 +272,70 @@ void BufMgr::allocBuf(FrameId & frame)
 	}
 }
 
+void BufMgr::claimFrame(const FrameId frame, File* file, const PageId pageNo)
+{
+	bufDescTable[frame].Set(file, pageNo);
+	touch(frame);
+	std::map<FileId, FileQuota>::iterator quota = quotas.find(file->id());
+	if (quota != quotas.end())
+		quota->second.resident++;
+}
+
+void BufMgr::releaseFrame(const FrameId frame)
+{
+	detachSnapshot(frame);
+	std::map<FileId, FileQuota>::iterator quota = quotas.find(bufDescTable[frame].fileId);
+	if (quota != quotas.end())
+		quota->second.resident--;
+	bufDescTable[frame].Clear();
+}
+
+void BufMgr::detachSnapshot(const FrameId frame)
+{
+	std::shared_ptr<SnapshotState> state = bufDescTable[frame].snapshot.lock();
+	if (state && state->detach())
+		bufStats.snapshotcopies++;
+	bufDescTable[frame].snapshot.reset();
+}
+
+void BufMgr::enableSnapshotArena(const std::uint32_t numPages)
+{
+	// Copies already taken keep the old arena alive through their SnapshotState
+	if (numPages > 0)
+		snapshotArena = std::make_shared<SnapshotArena>(numPages);
+	else
+		snapshotArena.reset();
+}
+
+void BufMgr::setFileQuota(const File* file, const std::uint32_t minFrames, const std::uint32_t maxFrames)
+{
+	std::map<FileId, FileQuota>::iterator old = quotas.find(file->id());
+	const std::uint32_t otherReserved = reservedFrames - (old == quotas.end() ? 0 : old->second.minFrames);
+	if ((maxFrames > 0 && minFrames > maxFrames) || otherReserved + minFrames > numBufs)
+		throw InvalidQuotaException(file->filename(), minFrames, maxFrames);
+
+	FileQuota quota;
+	quota.minFrames = minFrames;
+	quota.maxFrames = maxFrames;
+	quota.resident = 0;
+	for (FrameId i = 0; i < numBufs; i++) {
+		if (bufDescTable[i].valid && bufDescTable[i].fileId == file->id())
+			quota.resident++;
+	}
+	// A file already over a new cap shrinks as it replaces its own pages
+	quotas[file->id()] = quota;
+	reservedFrames = otherReserved + minFrames;
+}
+
+void BufMgr::clearFileQuota(const File* file)
+{
+	std::map<FileId, FileQuota>::iterator quota = quotas.find(file->id());
+	if (quota != quotas.end()) {
+		reservedFrames -= quota->second.minFrames;
+		quotas.erase(quota);
+	}
+}
+
 	
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 {
@@ -126,24 +347,190 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 	 *	to frame in "page"
 	 */
 	FrameId frame;
+	bufStats.accesses++;
 	try {
 		hashTable->lookup(file, pageNo, frame);
-		// Page found
-		bufDescTable[frame].refbit = 1;
+		// Page found, the pin may be for a writer
+		if (bufDescTable[frame].pinCnt == 0)
+			detachSnapshot(frame);
+		touch(frame);
 		bufDescTable[frame].pinCnt++;
 		page = &bufPool[frame];
   	}
 	catch (HashNotFoundException e) {
-		// Page not found, read into buffer from file.
-    	allocBuf(frame);
-    	bufPool[frame] = file->readPage(pageNo);
+		// Page not found, read into buffer from the second-tier caches or file.
+    	allocBuf(frame, file);
+    	if (!readFromCaches(file, pageNo, bufPool[frame])) {
+    		bufPool[frame] = file->readPage(pageNo);
+    		bufStats.diskreads++;
+    	}
     	hashTable->insert(file, pageNo, frame);
-    	bufDescTable[frame].Set(file, pageNo);
+    	claimFrame(frame, file, pageNo);
     	page = &bufPool[frame];
   	}
 }
 
 
+bool BufMgr::pinIfResident(File* file, const PageId pageNo, Page*& page)
+{
+	FrameId frame;
+	if (!hashTable->find(file, pageNo, frame)) {
+		return false;
+	}
+	if (bufDescTable[frame].pinCnt == 0)
+		detachSnapshot(frame);
+	touch(frame);
+	bufDescTable[frame].pinCnt++;
+	page = &bufPool[frame];
+	bufStats.accesses++;
+	return true;
+}
+
+bool BufMgr::pinIfCached(File* file, const PageId pageNo, Page*& page)
+{
+	if (pinIfResident(file, pageNo, page)) {
+		return true;
+	}
+	// Look in the caches before taking a frame, so a miss evicts nothing
+	Page image;
+	if (!readFromCaches(file, pageNo, image)) {
+		return false;
+	}
+	pinImage(file, pageNo, image, page);
+	return true;
+}
+
+void BufMgr::pinReadPage(File* file, const PageId pageNo, const Page& image, Page*& page)
+{
+	bufStats.diskreads++;
+	pinImage(file, pageNo, image, page);
+}
+
+void BufMgr::pinImage(File* file, const PageId pageNo, const Page& image, Page*& page)
+{
+	if (pinIfResident(file, pageNo, page)) {
+		return;
+	}
+	FrameId frame;
+	bufStats.accesses++;
+	allocBuf(frame, file);
+	bufPool[frame] = image;
+	hashTable->insert(file, pageNo, frame);
+	claimFrame(frame, file, pageNo);
+	page = &bufPool[frame];
+}
+
+void BufMgr::readPages(File* file, const std::vector<PageId>& pageNos, std::vector<Page*>& pages)
+{
+	/*	Pin every hit and claim (and pin) a frame for every miss before any I/O,
+	 *	so a later allocBuf can not hand out a frame we are still filling.
+	 *	Then serve misses from the second-tier caches and read the rest from
+	 *	the file sorted by page number. On error, undo all pins taken here.
+	 */
+	std::vector<FrameId> frames;
+	std::vector<std::pair<PageId, FrameId> > misses;
+	frames.reserve(pageNos.size());
+	pages.resize(pageNos.size());
+
+	try {
+		for (std::size_t i = 0; i < pageNos.size(); i++) {
+			FrameId frame;
+			try {
+				hashTable->lookup(file, pageNos[i], frame);
+				if (bufDescTable[frame].pinCnt == 0)
+					detachSnapshot(frame);
+				touch(frame);
+				bufDescTable[frame].pinCnt++;
+			}
+			catch (HashNotFoundException e) {
+				allocBuf(frame, file);
+				hashTable->insert(file, pageNos[i], frame);
+				claimFrame(frame, file, pageNos[i]);
+				misses.push_back(std::make_pair(pageNos[i], frame));
+			}
+			frames.push_back(frame);
+		}
+
+		std::vector<std::pair<PageId, FrameId> > toRead;
+		for (std::size_t i = 0; i < misses.size(); i++) {
+			if (!readFromCaches(file, misses[i].first, bufPool[misses[i].second])) {
+				toRead.push_back(misses[i]);
+			}
+		}
+		std::sort(toRead.begin(), toRead.end());
+
+		if (ioQueue && !toRead.empty()) {
+			// Read straight into the frames, every miss in flight at once
+			for (std::size_t i = 0; i < toRead.size(); i++) {
+				file->readPageAsync(*ioQueue, toRead[i].first, bufPool[toRead[i].second]);
+			}
+			ioQueue->submitAndWait();
+			bufStats.diskreads += toRead.size();
+			toRead.clear();
+		}
+
+		std::vector<PageId> readNos;
+		readNos.reserve(toRead.size());
+		for (std::size_t i = 0; i < toRead.size(); i++) {
+			readNos.push_back(toRead[i].first);
+		}
+		if (!readNos.empty()) {
+			std::vector<Page> read = file->readPages(readNos);
+			for (std::size_t i = 0; i < toRead.size(); i++) {
+				bufPool[toRead[i].second] = read[i];
+			}
+			bufStats.diskreads += readNos.size();
+		}
+	}
+	catch (...) {
+		if (ioQueue) {
+			// Frames must not be reused while reads into them are in flight
+			ioQueue->waitAll();
+		}
+		// Release every pin taken so far; frames claimed for misses go back unused.
+		for (std::size_t i = 0; i < frames.size(); i++) {
+			bufDescTable[frames[i]].pinCnt--;
+		}
+		for (std::size_t i = 0; i < misses.size(); i++) {
+			hashTable->remove(file, misses[i].first);
+			releaseFrame(misses[i].second);
+		}
+		throw;
+	}
+
+	for (std::size_t i = 0; i < frames.size(); i++) {
+		pages[i] = &bufPool[frames[i]];
+	}
+	bufStats.accesses += frames.size();
+}
+
+
+PageSnapshot BufMgr::readSnapshot(File* file, const PageId pageNo)
+{
+	/*	Share the frame with other snapshot readers until it changes. Only a
+	 *	miss goes through readPage, whose pin is dropped right away.
+	 */
+	FrameId frame;
+	if (hashTable->find(file, pageNo, frame)) {
+		touch(frame);
+		bufStats.accesses++;
+	} else {
+		Page* page;
+		readPage(file, pageNo, page);
+		unPinPage(file, pageNo, false);
+		hashTable->find(file, pageNo, frame);
+	}
+
+	BufDesc& desc = bufDescTable[frame];
+	std::shared_ptr<SnapshotState> state = desc.snapshot.lock();
+	if (!state) {
+		// A pinned page may be changing; its copy waits for the last unpin
+		state = std::make_shared<SnapshotState>(&bufPool[frame], snapshotArena, desc.pinCnt > 0);
+		desc.snapshot = state;
+	}
+	return PageSnapshot(state);
+}
+
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
 {
 	/*	Decrement pinCnt, possibly set dirty bit.
@@ -157,6 +544,9 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
 		} else {
 			bufDescTable[frame].pinCnt--;
 			if (dirty) bufDescTable[frame].dirty = true;
+			// Snapshots taken while the page was pinned get it as it is now
+			if (bufDescTable[frame].pinCnt == 0)
+				detachSnapshot(frame);
 		}
 	}
 	catch (HashNotFoundException e) {
@@ -166,14 +556,45 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
 }
 
 void BufMgr::flushFile(const File* file) 
+{
+	writeOutFile(file);
+	// One sync for all the pages written out
+	file->sync();
+}
+
+void BufMgr::writeOutFile(const File* file)
 {
 	/*	Scan bufDescTable for pages in buffer for file.
 	 *	- if frame is dirty, write to disk and unset dirty bit
 	 * Remove page from hashTable, clear entry in bufDescTable
 	 * Need to check for frames which are pinned or invalid.
+	 * With an I/O queue, dirty pages are all written first, in flight at once,
+	 * and the loop below finds them clean.
 	 */
+	if (ioQueue) {
+		std::vector<FrameId> written;
+		try {
+			for (FrameId i = 0; i < numBufs; i++) {
+				const BufDesc& desc = bufDescTable[i];
+				if (desc.fileId == file->id() && desc.valid && desc.dirty && desc.pinCnt == 0) {
+					desc.file->writePageAsync(*ioQueue, bufPool[i]);
+					written.push_back(i);
+				}
+			}
+			ioQueue->submitAndWait();
+		}
+		catch (...) {
+			ioQueue->waitAll();
+			throw;
+		}
+		for (std::size_t i = 0; i < written.size(); i++) {
+			bufDescTable[written[i]].dirty = false;
+		}
+		bufStats.diskwrites += written.size();
+	}
 	for(FrameId i=0; i<numBufs; i++) {
-		if(bufDescTable[i].file == file) {
+		// Compare ids so frames read through other copies of the File are flushed too
+		if(bufDescTable[i].fileId == file->id()) {
 			// Check for error conditions
 			if(bufDescTable[i].pinCnt > 0)
 				throw PagePinnedException(file->filename(), bufDescTable[i].pageNo,i);
@@ -182,28 +603,82 @@ void BufMgr::flushFile(const File* file)
 			if(bufDescTable[i].dirty) { // Dirty page needs to be written to disk
 				bufDescTable[i].file->writePage(bufPool[i]);
 				bufDescTable[i].dirty = false;
+				bufStats.diskwrites++;
 			}
 			hashTable->remove(file,bufDescTable[i].pageNo);
-			bufDescTable[i].Clear();
+			releaseFrame(i);
 		}
 	}
+	// Callers flush a file right before closing it, so its pages would only
+	// linger in the caches until they age out
+	if (compressedCache) {
+		compressedCache->removeFile(file);
+	}
+	if (cacheFile) {
+		cacheFile->removeFile(file);
+	}
+}
+
+void BufMgr::discardFile(const File* file)
+{
+	/*	Same scan as flushFile, but dirty pages are dropped instead of written.
+	 *	Check for pins first so nothing is dropped if the call fails.
+	 */
+	for (FrameId i = 0; i < numBufs; i++) {
+		if (bufDescTable[i].fileId == file->id() && bufDescTable[i].pinCnt > 0)
+			throw PagePinnedException(file->filename(), bufDescTable[i].pageNo, i);
+	}
+	for (FrameId i = 0; i < numBufs; i++) {
+		if (bufDescTable[i].valid && bufDescTable[i].fileId == file->id()) {
+			hashTable->remove(file, bufDescTable[i].pageNo);
+			releaseFrame(i);
+		}
+	}
+	if (compressedCache) {
+		compressedCache->removeFile(file);
+	}
+	if (cacheFile) {
+		cacheFile->removeFile(file);
+	}
 }
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
-	/*	Create empty page with file->allocatePage.
+	/*	Reserve empty page with file->reservePage; it reaches the disk
+	 *	only when the frame is first written back.
 	 *	Get buffer pool frame with allocBuf.
 	 *	Store in hashtable with HashTable->insert.
-	 *	Set entry in bufDescTable.
+	 *	Set entry in bufDescTable, dirty so the page does get written.
 	 *	Return page number created and pointer to frame.
 	 */
 	FrameId frame;
-	allocBuf(frame);
-	bufPool[frame] = file->allocatePage();
+	allocBuf(frame, file);
+	bufPool[frame] = file->reservePage();
 	pageNo = bufPool[frame].page_number();
+	// Page number may be reused from a deleted page
+	dropFromCaches(file, pageNo);
 	hashTable->insert(file, pageNo, frame);
-	bufDescTable[frame].Set(file,pageNo);
+	claimFrame(frame, file, pageNo);
+	bufDescTable[frame].dirty = true;
 	page = &bufPool[frame];
+	bufStats.accesses++;
+}
+
+void BufMgr::installPage(File* file, const Page& newPage, Page*& page)
+{
+	/*	Same as allocPage for a page the caller already allocated or
+	 *	reserved in the file.
+	 */
+	FrameId frame;
+	allocBuf(frame, file);
+	bufPool[frame] = newPage;
+	const PageId pageNo = newPage.page_number();
+	dropFromCaches(file, pageNo);
+	hashTable->insert(file, pageNo, frame);
+	claimFrame(frame, file, pageNo);
+	bufDescTable[frame].dirty = true;
+	page = &bufPool[frame];
+	bufStats.accesses++;
 }
 
 void BufMgr::disposePage(File* file, const PageId PageNo)
@@ -213,11 +688,12 @@ void BufMgr::disposePage(File* file, const PageId PageNo)
 	 *	then frees frame and removes entry from hashTable.
 	 */
 	FrameId frame;
+	dropFromCaches(file, PageNo);
 	try {
 		hashTable->lookup(file, PageNo, frame);
 		// Page in buffer, need to clear references.
 		hashTable->remove(file, PageNo);
-		bufDescTable[frame].Clear();
+		releaseFrame(frame);
 		file->deletePage(PageNo);
 	}
 	catch (HashNotFoundException e) {
@@ -245,4 +721,37 @@ void BufMgr::printSelf(void)
 	std::cout << "Total Number of Valid Frames:" << validFrames << "\n";
 }
 
+BufSnapshot BufMgr::snapshot() const
+{
+	/*	Single read-only pass over bufDescTable; nothing is locked or moved,
+	 *	so this costs about as much as one sweep of the clock hand.
+	 */
+	BufSnapshot snap;
+	snap.frames = numBufs;
+	snap.accessClock = accessClock;
+	for (FrameId i = 0; i < numBufs; i++) {
+		const BufDesc& desc = bufDescTable[i];
+		if (!desc.valid)
+			continue;
+		snap.valid++;
+		FileFrameCounts& counts = snap.files[desc.fileId];
+		if (counts.resident == 0)
+			counts.name = desc.file->filename();
+		counts.resident++;
+		if (desc.dirty) {
+			snap.dirty++;
+			counts.dirty++;
+		}
+		if (desc.pinCnt > 0) {
+			snap.pinned++;
+			counts.pinned++;
+		}
+		if (desc.refbit)
+			snap.referenced++;
+		BufSnapshot::addToHistogram(snap.pinCounts, desc.pinCnt);
+		BufSnapshot::addToHistogram(snap.ages, accessClock - desc.lastAccess);
+	}
+	return snap;
+}
+
 }
@@ -11,8 +11,15 @@
 
 #pragma once
 
+#include <map>
+#include <vector>
+
 #include "file.h"
 #include "bufHashTbl.h"
+#include "compressed_cache.h"
+#include "page_cache_file.h"
+#include "buffer_snapshot.h"
+#include "page_snapshot.h"
 
 namespace badgerdb {
 
@@ -21,6 +28,13 @@ namespace badgerdb {
 */
 class BufMgr;
 
+#if defined(__cpp_impl_coroutine)
+/**
+* forward declaration of the awaitable returned by BufMgr::readPageAsync, see buffer_async.h
+*/
+class PageAwaitable;
+#endif
+
 /**
 * @brief Class for maintaining information about buffer pool frames
 */
@@ -34,6 +48,11 @@ class BufDesc {
 	 */
   File* file;
 
+	/**
+   * Identifier of the file, shared by all File objects for the same file
+	 */
+  FileId fileId;
+
 	/**
    * Page within file to which corresponding frame is assigned
 	 */
@@ -64,6 +83,16 @@ class BufDesc {
 	 */
   bool refbit;
 
+	/**
+   * Value of the owning BufMgr's access clock at the last access to the frame
+	 */
+  std::uint64_t lastAccess;
+
+	/**
+   * Snapshot readers of the page in the frame, expired if there are none
+	 */
+  std::weak_ptr<SnapshotState> snapshot;
+
 	/**
    * Initialize buffer frame for a new user
 	 */
@@ -71,10 +100,13 @@ class BufDesc {
 	{
     pinCnt = 0;
 		file = NULL;
+		fileId = 0;
 		pageNo = Page::INVALID_NUMBER;
     dirty = false;
     refbit = false;
 		valid = false;
+		lastAccess = 0;
+		snapshot.reset();
   };
 
 	/**
@@ -87,6 +119,7 @@ class BufDesc {
   void Set(File* filePtr, PageId pageNum)
 	{ 
 		file = filePtr;
+		fileId = filePtr->id();
     pageNo = pageNum;
     pinCnt = 1;
     dirty = false;
@@ -131,7 +164,7 @@ struct BufStats
   int accesses;
 
 	/**
-   * Number of pages read from disk (including allocs)
+   * Number of pages read from disk; allocated pages are not read, so they do not count
 	 */
   int diskreads;
 
@@ -140,12 +173,27 @@ struct BufStats
 	 */
   int diskwrites;
 
+	/**
+   * Number of those writes done early, together with an evicted neighbouring page
+	 */
+  int combinedwrites;
+
+	/**
+   * Number of evictions of a file's own page because the file was at its frame cap
+	 */
+  int quotaevictions;
+
+	/**
+   * Number of pages copied for snapshot readers before the frame was handed out or reused
+	 */
+  int snapshotcopies;
+
 	/**
    * Clear all values 
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = diskreads = diskwrites = combinedwrites = quotaevictions = snapshotcopies = 0;
   }
       
 	/**
@@ -158,11 +206,35 @@ struct BufStats
 };
 
 
+/**
+* @brief Frame quota of one file in the buffer pool, see BufMgr::setFileQuota()
+*/
+struct FileQuota
+{
+	/**
+   * Frames of the file protected from eviction by other files
+	 */
+  std::uint32_t minFrames;
+
+	/**
+   * Most frames the file may hold, 0 for no cap
+	 */
+  std::uint32_t maxFrames;
+
+	/**
+   * Frames the file holds now
+	 */
+  std::uint32_t resident;
+};
+
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
 */
 class BufMgr 
 {
+	friend class PartitionedBufMgr;
+
  private:
 	/**
    * Current position of clockhand in our buffer pool
@@ -173,9 +245,14 @@ class BufMgr
    * Number of frames in the buffer pool
 	 */
   std::uint32_t numBufs;
+
+	/**
+   * Most neighbouring pages on each side written together with an evicted dirty page
+	 */
+  std::uint32_t combineWindow;
 	
 	/**
-   * Hash table mapping (File, page) to frame
+   * Hash table mapping (file id, page) to frame
 	 */
   BufHashTbl *hashTable;
 
@@ -189,20 +266,183 @@ class BufMgr
 	 */
   BufStats bufStats;
 
+	/**
+   * Logical clock advanced by every page access, used to age frames
+	 */
+  std::uint64_t accessClock;
+
+	/**
+   * Optional cache of compressed pages evicted from the pool, NULL if disabled
+	 */
+  CompressedPageCache *compressedCache;
+
+	/**
+   * Optional cache file on fast local storage, NULL if disabled
+	 */
+  PageCacheFile *cacheFile;
+
+	/**
+   * Frame quotas by file id, only for files that have one
+	 */
+  std::map<FileId, FileQuota> quotas;
+
+	/**
+   * Sum of the minimum reservations in quotas
+	 */
+  std::uint32_t reservedFrames;
+
+	/**
+   * Arena for private copies of snapshot pages, NULL to copy onto the heap
+	 */
+  std::shared_ptr<SnapshotArena> snapshotArena;
+
+	/**
+   * Queue for asynchronous reads and writes, NULL to do them one by one
+	 */
+  PageIoQueue *ioQueue;
+
 	/**
    * Advance clock to next frame in the buffer pool
 	 */
   void advanceClock();
 
 	/**
+   * Record an access to the frame: set its refbit and stamp it with the access clock
+	 */
+  void touch(const FrameId frame)
+  {
+		bufDescTable[frame].refbit = true;
+		bufDescTable[frame].lastAccess = ++accessClock;
+  }
+
+	/**
 	 * Allocate a free frame.  
+	 * Honours frame quotas: a file at its cap only replaces one of its own pages,
+	 * and pages of a file holding no more than its reservation are only replaced
+	 * by that file.
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param file   	File the frame is for
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 */
+  void allocBuf(FrameId & frame, const File* file);
+
+	/**
+	 * Returns true if allocBuf() may replace the page in the frame.
+	 *
+	 * @param desc   	Descriptor of a valid, unpinned frame
+	 * @param fileId	Id of the file the frame is wanted for
+	 * @param capped	True if that file is at its frame cap
+	 */
+  bool isReplaceable(const BufDesc& desc, const FileId fileId, const bool capped) const;
+
+	/**
+	 * Assign a frame to a page and pin it, keeping the file's quota count.
+	 *
+	 * @param frame   	Frame from allocBuf()
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  void claimFrame(const FrameId frame, File* file, const PageId pageNo);
+
+	/**
+	 * Take the page out of a frame, keeping the file's quota count. The caller
+	 * removes the page from the hash table.
+	 *
+	 * @param frame   	Frame to clear
+	 */
+  void releaseFrame(const FrameId frame);
+
+	/**
+	 * Move any snapshot readers of the frame onto a private copy of the page.
+	 * Called before an unpinned page is pinned, when the last pin is released,
+	 * and before the frame is reused; never while another thread may be
+	 * changing the page, except for a pinned frame being released.
+	 *
+	 * @param frame   	Frame about to be handed out, unpinned or reused
+	 */
+  void detachSnapshot(const FrameId frame);
+
+	/**
+	 * Write the dirty page in the frame to disk together with the run of dirty,
+	 * unpinned pages of the same file directly before and after it, and mark
+	 * them all clean.
+	 *
+	 * @param frame   	Frame holding a dirty page
+	 */
+  void writeDirtyRun(const FrameId frame);
+
+	/**
+	 * Returns true if the page is in the pool, dirty and unpinned.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Set to the page's frame if it is in the pool
+	 */
+  bool isCombinable(const File* file, const PageId pageNo, FrameId& frame);
+
+	/**
+	 * Put a page already reserved in the file into a free frame, pin it and
+	 * mark it dirty, the part of allocPage() that comes after File::reservePage().
+	 *
+	 * @param file   	File object
+	 * @param newPage Page returned by File::reservePage()
+	 * @param page  	Reference to page pointer, receives the frame holding the page
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  void allocBuf(FrameId & frame);
+  void installPage(File* file, const Page& newPage, Page*& page);
+
+	/**
+	 * Offer the clean page held in the frame to the enabled second-tier caches.
+	 *
+	 * @param frame   	Frame about to be reused
+	 */
+  void spillFrame(const FrameId frame);
+
+	/**
+	 * Fill the page from the second-tier caches, fastest tier first.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param page   	Frame, or other page, to read the page into
+	 * @return  			True if one of the caches had the page
+	 */
+  bool readFromCaches(const File* file, const PageId pageNo, Page& page);
+
+	/**
+	 * Pin the page, copying the image into a newly allocated frame unless the
+	 * page has become resident in the meantime.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param image  	Contents of the page
+	 * @param page  	Reference to page pointer, set to the pinned page
+	 * @throws BufferExceededException If all buffer frames are pinned
+	 */
+  void pinImage(File* file, const PageId pageNo, const Page& image, Page*& page);
+
+	/**
+	 * Drop (file, pageNo) from the second-tier caches.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  void dropFromCaches(const File* file, const PageId pageNo);
+
+	/**
+	 * Same as flushFile() without the sync at the end, for callers that flush
+	 * the file from several buffer pools and sync it once.
+	 *
+	 * @param file   	File object
+	 */
+  void writeOutFile(const File* file);
 
  public:
+	/**
+   * Default for setWriteCombineWindow()
+	 */
+  static const std::uint32_t DEFAULT_COMBINE_WINDOW = 8;
+
 	/**
    * Actual buffer pool from which frames are allocated
 	 */
@@ -229,6 +469,107 @@ class BufMgr
 	 */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
+	/**
+	 * Pins the page and returns it if it is already in the buffer pool. Never reads from disk.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param page  	Reference to page pointer, set only if the page is in the buffer pool
+	 * @return  			True if the page was in the buffer pool and is now pinned
+	 */
+  bool pinIfResident(File* file, const PageId pageNo, Page*& page);
+
+	/**
+	 * Like pinIfResident(), but a page found in the second-tier caches is
+	 * brought into the buffer pool and pinned as well. Never reads from disk.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param page  	Reference to page pointer, set only if the page was found
+	 * @return  			True if the page is now pinned
+	 * @throws BufferExceededException If all buffer frames are pinned
+	 */
+  bool pinIfCached(File* file, const PageId pageNo, Page*& page);
+
+	/**
+	 * Pins a page the caller has read from the file itself, for callers that
+	 * drive their own I/O. The image is copied into a frame, unless the page
+	 * has been read into the pool meanwhile, in which case that frame is
+	 * pinned and the image dropped.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param image  	Page as read from the file
+	 * @param page  	Reference to page pointer, set to the pinned page
+	 * @throws BufferExceededException If all buffer frames are pinned
+	 */
+  void pinReadPage(File* file, const PageId pageNo, const Page& image, Page*& page);
+
+#if defined(__cpp_impl_coroutine)
+	/**
+	 * Reads the given page like readPage() from a coroutine, for use with the
+	 * AsyncScheduler in buffer_async.h. Awaiting the result yields a PageHandle
+	 * that owns one pin of the page. A miss suspends the coroutine, so others
+	 * run, until the scheduler's I/O queue has read it.
+	 * Requires a C++20 compiler.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Awaitable yielding the pinned page
+	 */
+  PageAwaitable readPageAsync(File* file, const PageId pageNo);
+#endif
+
+	/**
+	 * Reads a batch of pages of the file into the buffer pool and pins all of them.
+	 * Pages already in the pool are pinned in place. Frames for all the other pages
+	 * are allocated first, then the missing pages are read from the file in page
+	 * number order so consecutive pages are fetched with a single request.
+	 * The same page may be requested more than once; it is pinned once per request.
+	 * If anything fails no page is left pinned by this call.
+	 *
+	 * @param file   	File object
+	 * @param pageNos Page numbers in the file to be read
+	 * @param pages  	Receives a pointer to each page, in the same order as pageNos
+	 * @throws BufferExceededException If there are not enough unpinned frames for the batch
+	 * @throws InvalidPageException If any page does not exist in the file
+	 */
+  void readPages(File* file, const std::vector<PageId>& pageNos, std::vector<Page*>& pages);
+
+	/**
+	 * Reads the given page into the buffer pool like readPage() and returns a
+	 * read-only snapshot of it without keeping it pinned. Long readers use this
+	 * so they block neither writers nor flushFile(). The snapshot reads a
+	 * private copy of the page taken from the snapshot arena, outside the
+	 * buffer pool latch when the snapshot is first read, or here before the
+	 * page is pinned again, replaced or flushed, whichever comes first. A page
+	 * that is pinned right now may be changing, so it is copied when its last
+	 * pin is released and reading the snapshot waits until then; the thread
+	 * holding the pin must not read the snapshot before unpinning.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Snapshot of the page
+	 */
+  PageSnapshot readSnapshot(File* file, const PageId pageNo);
+
+	/**
+	 * Take private copies for snapshot readers from a fixed arena instead of
+	 * the heap. The arena stays alive until the last copy taken from it is
+	 * released. Replaces any arena enabled earlier.
+	 *
+	 * @param numPages	Number of pages in the arena, 0 copies onto the heap
+	 */
+  void enableSnapshotArena(const std::uint32_t numPages);
+
+	/**
+   * Get the snapshot arena, NULL if copies go to the heap
+	 */
+  const SnapshotArena* getSnapshotArena() const
+  {
+		return snapshotArena.get();
+  }
+
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
 	 *
@@ -242,6 +583,9 @@ class BufMgr
 	/**
 	 * Allocates a new, empty page in the file and returns the Page object.
 	 * The newly allocated page is also assigned a frame in the buffer pool.
+	 * The page number is only reserved in the file (see File::reservePage());
+	 * the page is dirty from the start and reaches the disk, contents and all,
+	 * when it is first written back.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
@@ -250,7 +594,7 @@ class BufMgr
   void allocPage(File* file, PageId &PageNo, Page*& page); 
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
+	 * Writes out all dirty pages of the file to disk, then syncs the file once (see File::sync()).
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
 	 * Otherwise Error returned.
 	 *
@@ -260,6 +604,16 @@ class BufMgr
 	 */
   void flushFile(const File* file);
 
+	/**
+	 * Drops all pages of the file from the buffer pool without writing them,
+	 * for temporary files (see File::createTemp()) whose contents are no
+	 * longer needed. Like flushFile(), all pages must be unpinned.
+	 *
+	 * @param file   	File object
+	 * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+	 */
+  void discardFile(const File* file);
+
 	/**
 	 * Delete page from file and also from buffer pool if present.
 	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
@@ -270,11 +624,125 @@ class BufMgr
   void disposePage(File* file, const PageId PageNo);
 
 	/**
+	 * Returns true if the page is in the buffer pool, without touching it.
+	 * With a lock-free page table (see enableLockFreeTable()) this may be
+	 * called from other threads while one thread uses the buffer manager; the
+	 * answer may then be stale by the time it is returned.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  bool isResident(const File* file, const PageId pageNo) const;
+
+	/**
+	 * Keep the page table in a LockFreePageTable instead of a chained hash
+	 * table, so isResident() can be asked without the buffer manager's latch.
+	 * Pages already in the pool are carried over. Does nothing if the table is
+	 * lock-free already.
+	 */
+  void enableLockFreeTable();
+
+	/**
+	 * Keep compressed copies of clean pages evicted from the buffer pool and
+	 * check them on readPage() misses before going to the file.
+	 * Replaces any compressed cache enabled earlier.
+	 *
+	 * @param capacity	Size of the compressed cache arena in bytes, 0 disables it
+	 */
+  void enableCompressedCache(const std::size_t capacity);
+
+	/**
+	 * Spill clean pages evicted from the buffer pool into a fixed-size cache
+	 * file, normally on faster storage than the data files, and serve readPage()
+	 * misses from it before going to the file. The compressed cache, if enabled,
+	 * is checked first. Replaces any cache file enabled earlier.
+	 *
+	 * @param path  		Name of the cache file, created now and removed with the cache
+	 * @param numPages	Number of pages the cache file holds, 0 disables it
+	 */
+  void enableCacheFile(const std::string& path, const std::uint32_t numPages);
+
+	/**
+	 * Read the misses of readPages() and write the dirty pages of flushFile()
+	 * through an asynchronous queue, with up to queueDepth requests in flight
+	 * at once, instead of one after the other. Replaces any queue enabled
+	 * earlier.
+	 *
+	 * @param queueDepth	Most requests in flight at once, 0 disables the queue
+	 * @param backend			Backend of the queue
+	 * @throws  IoErrorException If the backend asked for is not available
+	 */
+  void enableAsyncIo(const unsigned queueDepth,
+                     const PageIoQueue::Backend backend = PageIoQueue::AUTO);
+
+	/**
+   * Get the asynchronous I/O queue, NULL if it is disabled
+	 */
+  const PageIoQueue* getIoQueue() const
+  {
+		return ioQueue;
+  }
+
+	/**
+   * Get the cache file, NULL if it is disabled
+	 */
+  const PageCacheFile* getCacheFile() const
+  {
+		return cacheFile;
+  }
+
+	/**
+   * Get the compressed cache, NULL if it is disabled
+	 */
+  const CompressedPageCache* getCompressedCache() const
+  {
+		return compressedCache;
+  }
+
+	/**
+	 * Set how far evicting a dirty page looks for dirty, unpinned neighbours
+	 * (pageNo-1, pageNo-2, ... and pageNo+1, ...) of the same file to write
+	 * in the same request. The run stops at the first page that does not qualify.
+	 *
+	 * @param pages		Most neighbours on each side, 0 writes only the evicted page
+	 */
+  void setWriteCombineWindow(const std::uint32_t pages);
+
+	/**
+	 * Set the frame quota of a file, replacing any earlier one. Pages of the file
+	 * are never replaced to make room for other files while it holds at most
+	 * minFrames frames, and once it holds maxFrames frames it can only get a new
+	 * frame by replacing one of its own pages. Useful to keep a large scan or
+	 * temporary file from pushing catalog and index pages out of the pool.
+	 *
+	 * @param file   		File object
+	 * @param minFrames	Frames reserved for the file, 0 for none
+	 * @param maxFrames	Most frames the file may hold, 0 for no cap
+	 * @throws InvalidQuotaException If minFrames exceeds a non-zero maxFrames or all reservations together exceed the pool
+	 */
+  void setFileQuota(const File* file, const std::uint32_t minFrames, const std::uint32_t maxFrames);
+
+	/**
+	 * Remove the frame quota of a file, if it has one.
+	 *
+	 * @param file   	File object
+	 */
+  void clearFileQuota(const File* file);
+
+	/**
    * Print member variable values. 
 	 */
   void  printSelf();
 
 	/**
+	 * Summarize the buffer pool in one pass over the frame table: per-file
+	 * resident, dirty and pinned counts, and the distributions of pin counts and
+	 * frame ages.  Cheap enough to call periodically; BufSnapshot::writeJson()
+	 * exports the result.
+	 */
+  BufSnapshot snapshot() const;
+
+	/**
    * Get buffer pool usage statistics
 	 */
   BufStats & getBufStats()
@@ -0,0 +1,222 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <iostream>
+#include "buffer_async.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace badgerdb {
+
+namespace {
+
+thread_local AsyncScheduler* current_scheduler = NULL;
+
+// Orders parked reads by pool, file and page number, so reads reach each
+// file sorted.
+bool byTarget(const PageAwaitable* a, const PageAwaitable* b) {
+  return std::make_pair(std::make_pair(a->pool(), a->file()), a->pageNo()) <
+         std::make_pair(std::make_pair(b->pool(), b->file()), b->pageNo());
+}
+
+}
+
+PageAwaitable BufMgr::readPageAsync(File* file, const PageId pageNo)
+{
+	return PageAwaitable(this, file, pageNo);
+}
+
+PageAwaitable PartitionedBufMgr::readPageAsync(File* file, const PageId pageNo)
+{
+	return PageAwaitable(this, file, pageNo);
+}
+
+bool PageAwaitable::await_suspend(std::coroutine_handle<> waiter) {
+  AsyncScheduler* scheduler = AsyncScheduler::current();
+  if (scheduler == NULL) {
+    // Nobody to batch with; do the read now and carry on.
+    try {
+      pool_.readPage(file_, pageNo_, page_);
+    } catch (...) {
+      error_ = std::current_exception();
+    }
+    return false;
+  }
+  waiter_ = waiter;
+  scheduler->park(this);
+  return true;
+}
+
+AsyncScheduler::AsyncScheduler(const unsigned queueDepth,
+                               const PageIoQueue::Backend backend)
+    : queueDepth_(queueDepth > 0 ? queueDepth : 1), backend_(backend) {
+}
+
+AsyncScheduler::~AsyncScheduler() {
+  // Reads still in flight land in the pending pages; wait before freeing them.
+  delete queue_;
+  std::map<ReadKey, PendingRead*>::iterator it;
+  for (it = reading_.begin(); it != reading_.end(); ++it) {
+    delete it->second;
+  }
+  for (std::size_t i = 0; i < spare_.size(); i++) {
+    delete spare_[i];
+  }
+  for (std::size_t i = 0; i < tasks_.size(); i++) {
+    tasks_[i].destroy();
+  }
+}
+
+AsyncScheduler* AsyncScheduler::current() {
+  return current_scheduler;
+}
+
+void AsyncScheduler::spawn(AsyncTask&& task) {
+  tasks_.push_back(task.handle_);
+  ready_.push_back(task.handle_);
+  task.handle_ = nullptr;
+}
+
+void AsyncScheduler::run() {
+  AsyncScheduler* previous = current_scheduler;
+  current_scheduler = this;
+  std::vector<PageIoQueue::Completion> done;
+  while (true) {
+    while (!ready_.empty()) {
+      std::coroutine_handle<> next = ready_.front();
+      ready_.pop_front();
+      next.resume();
+    }
+    if (!parked_.empty()) {
+      startParked();
+    }
+    if (!ready_.empty()) {
+      continue;
+    }
+    if (queue_ == NULL || queue_->taggedInFlight() == 0) {
+      break;
+    }
+    // Nothing runnable: wait for the next read, not for all of them.
+    done.clear();
+    queue_->poll(done, true);
+    for (std::size_t i = 0; i < done.size(); i++) {
+      finishRead(static_cast<PendingRead*>(done[i].tag), done[i].error);
+    }
+  }
+  current_scheduler = previous;
+
+  std::exception_ptr error;
+  for (std::size_t i = 0; i < tasks_.size(); i++) {
+    if (!error && tasks_[i].promise().error) {
+      error = tasks_[i].promise().error;
+    }
+    tasks_[i].destroy();
+  }
+  tasks_.clear();
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void AsyncScheduler::startParked() {
+  std::vector<PageAwaitable*> parked;
+  parked.swap(parked_);
+  std::sort(parked.begin(), parked.end(), byTarget);
+
+  bool started = false;
+  for (std::size_t i = 0; i < parked.size(); i++) {
+    PageAwaitable* waiter = parked[i];
+    const ReadKey key(std::make_pair(waiter->pool_, waiter->file_),
+                      waiter->pageNo_);
+    std::map<ReadKey, PendingRead*>::iterator it = reading_.find(key);
+    if (it != reading_.end()) {
+      it->second->waiters.push_back(waiter);
+      continue;
+    }
+    try {
+      if (waiter->pool_.pinIfCached(waiter->file_, waiter->pageNo_,
+                                    waiter->page_)) {
+        ready_.push_back(waiter->waiter_);
+        continue;
+      }
+    } catch (...) {
+      waiter->error_ = std::current_exception();
+      ready_.push_back(waiter->waiter_);
+      continue;
+    }
+    if (queue_ == NULL) {
+      queue_ = PageIoQueue::create(queueDepth_, backend_);
+    } else if (queue_->taggedInFlight() >= queueDepth_) {
+      // Queue full; try again once reads have finished.
+      parked_.push_back(waiter);
+      continue;
+    }
+
+    PendingRead* read;
+    if (spare_.empty()) {
+      read = new PendingRead(waiter->pool_);
+    } else {
+      read = spare_.back();
+      spare_.pop_back();
+      read->pool = waiter->pool_;
+    }
+    read->file = waiter->file_;
+    read->pageNo = waiter->pageNo_;
+    read->waiters.push_back(waiter);
+    reading_[key] = read;
+    try {
+      if (waiter->file_->readPageAsync(*queue_, waiter->pageNo_, read->image,
+                                       read)) {
+        started = true;
+      } else {
+        // Read right away, as direct and compressed files are.
+        finishRead(read, std::exception_ptr());
+      }
+    } catch (...) {
+      finishRead(read, std::current_exception());
+    }
+  }
+  if (started) {
+    ++batches_;
+  }
+}
+
+void AsyncScheduler::finishRead(PendingRead* read,
+                                const std::exception_ptr& error) {
+  bool resident = false;
+  for (std::size_t i = 0; i < read->waiters.size(); i++) {
+    PageAwaitable* waiter = read->waiters[i];
+    if (error) {
+      waiter->error_ = error;
+    } else {
+      try {
+        // The first pin brings the page in; it keeps it there for the rest.
+        if (!(resident && read->pool.pinIfResident(read->file, read->pageNo,
+                                                   waiter->page_))) {
+          read->pool.pinReadPage(read->file, read->pageNo, read->image,
+                                 waiter->page_);
+          resident = true;
+        }
+      } catch (...) {
+        waiter->error_ = std::current_exception();
+      }
+    }
+    ready_.push_back(waiter->waiter_);
+  }
+  reading_.erase(ReadKey(std::make_pair(read->pool, read->file),
+                         read->pageNo));
+  read->waiters.clear();
+  spare_.push_back(read);
+}
+
+}
+
+#endif
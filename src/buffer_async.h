@@ -0,0 +1,378 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+// Coroutine support needs a C++20 compiler; the rest of BadgerDB builds
+// without it, so everything here compiles away on older standards.
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "page_io.h"
+#include "partitioned_buffer.h"
+
+namespace badgerdb {
+
+class AsyncScheduler;
+
+/**
+ * @brief Buffer pool that awaitables read through: a BufMgr, or a
+ *        PartitionedBufMgr shared by threads with a scheduler each.
+ */
+class AsyncPool {
+ public:
+  AsyncPool(BufMgr* bufMgr) : bufMgr_(bufMgr), partitioned_(NULL) {}
+
+  AsyncPool(PartitionedBufMgr* partitioned)
+      : bufMgr_(NULL), partitioned_(partitioned) {
+  }
+
+  bool pinIfResident(File* file, const PageId pageNo, Page*& page) const {
+    return bufMgr_ ? bufMgr_->pinIfResident(file, pageNo, page)
+                   : partitioned_->pinIfResident(file, pageNo, page);
+  }
+
+  void readPage(File* file, const PageId pageNo, Page*& page) const {
+    if (bufMgr_) {
+      bufMgr_->readPage(file, pageNo, page);
+    } else {
+      partitioned_->readPage(file, pageNo, page);
+    }
+  }
+
+  bool pinIfCached(File* file, const PageId pageNo, Page*& page) const {
+    return bufMgr_ ? bufMgr_->pinIfCached(file, pageNo, page)
+                   : partitioned_->pinIfCached(file, pageNo, page);
+  }
+
+  void pinReadPage(File* file, const PageId pageNo, const Page& image,
+                   Page*& page) const {
+    if (bufMgr_) {
+      bufMgr_->pinReadPage(file, pageNo, image, page);
+    } else {
+      partitioned_->pinReadPage(file, pageNo, image, page);
+    }
+  }
+
+  void unPinPage(File* file, const PageId pageNo, const bool dirty) const {
+    if (bufMgr_) {
+      bufMgr_->unPinPage(file, pageNo, dirty);
+    } else {
+      partitioned_->unPinPage(file, pageNo, dirty);
+    }
+  }
+
+  /**
+   * Orders pools so the scheduler can group reads by pool.
+   */
+  bool operator<(const AsyncPool& other) const {
+    return std::make_pair(bufMgr_, partitioned_) <
+           std::make_pair(other.bufMgr_, other.partitioned_);
+  }
+
+ private:
+  BufMgr* bufMgr_;
+  PartitionedBufMgr* partitioned_;
+};
+
+/**
+ * @brief A pinned page returned by BufMgr::readPageAsync() or
+ *        PartitionedBufMgr::readPageAsync().
+ *
+ * The page stays pinned for as long as the handle owns it and is unpinned when
+ * the handle is destroyed or reset.  Handles can be moved but not copied.
+ */
+class PageHandle {
+ public:
+  /**
+   * Constructs an empty handle.
+   */
+  PageHandle()
+      : pool_(static_cast<BufMgr*>(NULL)), file_(NULL),
+        pageNo_(Page::INVALID_NUMBER),
+        page_(NULL), dirty_(false) {
+  }
+
+  /**
+   * Constructs a handle owning one pin of the page.
+   */
+  PageHandle(const AsyncPool& pool, File* file, const PageId pageNo,
+             Page* page)
+      : pool_(pool), file_(file), pageNo_(pageNo), page_(page),
+        dirty_(false) {
+  }
+
+  PageHandle(PageHandle&& other)
+      : pool_(other.pool_), file_(other.file_), pageNo_(other.pageNo_),
+        page_(other.page_), dirty_(other.dirty_) {
+    other.page_ = NULL;
+  }
+
+  PageHandle& operator=(PageHandle&& other) {
+    if (this != &other) {
+      reset();
+      pool_ = other.pool_;
+      file_ = other.file_;
+      pageNo_ = other.pageNo_;
+      page_ = other.page_;
+      dirty_ = other.dirty_;
+      other.page_ = NULL;
+    }
+    return *this;
+  }
+
+  PageHandle(const PageHandle&) = delete;
+  PageHandle& operator=(const PageHandle&) = delete;
+
+  /**
+   * Unpins the page if the handle still owns it.
+   */
+  ~PageHandle() { reset(); }
+
+  /**
+   * Unpins the page now, marking it dirty if markDirty() was called.
+   */
+  void reset() {
+    if (page_) {
+      pool_.unPinPage(file_, pageNo_, dirty_);
+      page_ = NULL;
+    }
+  }
+
+  /**
+   * Marks the page dirty; it is written back when the pool evicts it.
+   */
+  void markDirty() { dirty_ = true; }
+
+  /**
+   * Returns the page number.
+   */
+  PageId pageNo() const { return pageNo_; }
+
+  /**
+   * Returns the pinned page, NULL for an empty handle.
+   */
+  Page* get() const { return page_; }
+  Page* operator->() const { return page_; }
+  Page& operator*() const { return *page_; }
+
+ private:
+  AsyncPool pool_;
+  File* file_;
+  PageId pageNo_;
+  Page* page_;
+  bool dirty_;
+};
+
+/**
+ * @brief Awaitable returned by BufMgr::readPageAsync() and
+ *        PartitionedBufMgr::readPageAsync().
+ *
+ * Resident pages are pinned without suspending.  On a miss the awaiting
+ * coroutine is parked with the current AsyncScheduler, which resumes it once
+ * its page has been read.  Awaited outside AsyncScheduler::run() a miss is
+ * read right away without suspending.
+ */
+class PageAwaitable {
+ public:
+  PageAwaitable(const AsyncPool& pool, File* file, const PageId pageNo)
+      : pool_(pool), file_(file), pageNo_(pageNo), page_(NULL) {
+  }
+
+  bool await_ready() {
+    return pool_.pinIfResident(file_, pageNo_, page_);
+  }
+
+  bool await_suspend(std::coroutine_handle<> waiter);
+
+  PageHandle await_resume() {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+    return PageHandle(pool_, file_, pageNo_, page_);
+  }
+
+  /**
+   * Returns the pool the page is read through.
+   */
+  const AsyncPool& pool() const { return pool_; }
+
+  /**
+   * Returns the file the page is read from.
+   */
+  File* file() const { return file_; }
+
+  /**
+   * Returns the number of the page being read.
+   */
+  PageId pageNo() const { return pageNo_; }
+
+ private:
+  friend class AsyncScheduler;
+
+  AsyncPool pool_;
+  File* file_;
+  PageId pageNo_;
+  Page* page_;
+  std::exception_ptr error_;
+  std::coroutine_handle<> waiter_;
+};
+
+/**
+ * @brief Coroutine type for work run by an AsyncScheduler.
+ *
+ * A task does not start until it is handed to AsyncScheduler::spawn().
+ */
+class AsyncTask {
+ public:
+  struct promise_type {
+    std::exception_ptr error;
+
+    AsyncTask get_return_object() {
+      return AsyncTask(
+          std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { error = std::current_exception(); }
+  };
+
+  AsyncTask(AsyncTask&& other) : handle_(other.handle_) {
+    other.handle_ = nullptr;
+  }
+  AsyncTask(const AsyncTask&) = delete;
+  AsyncTask& operator=(const AsyncTask&) = delete;
+
+  ~AsyncTask() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+ private:
+  friend class AsyncScheduler;
+
+  explicit AsyncTask(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {
+  }
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * @brief Single-threaded scheduler for AsyncTasks that overlaps page misses.
+ *
+ * run() resumes runnable coroutines until all of them are either finished or
+ * parked on a page miss.  It then starts the parked reads on its own
+ * PageIoQueue, sorted by file and page number, and resumes each coroutine as
+ * soon as its own read completes.  Misses parked by the resumed coroutines
+ * join the reads still in flight, so the thread only waits when nothing is
+ * runnable, and then only for the next read to finish.  Thousands of lookups
+ * can be outstanding on one thread this way.
+ *
+ * Misses found in the pool's second-tier caches are not read from disk, and
+ * coroutines missing on the same page share one read.  The pool is entered
+ * only to pin pages, never while a read is in flight.
+ *
+ * @warning This class is not threadsafe; use one scheduler per thread.
+ */
+class AsyncScheduler {
+ public:
+  /**
+   * Default for the most reads in flight at once.
+   */
+  static const unsigned DEFAULT_QUEUE_DEPTH = 64;
+
+  /**
+   * Constructs a scheduler.  Its I/O queue is created at the first miss.
+   *
+   * @param queueDepth  Most reads in flight at once.
+   * @param backend     Backend of the I/O queue.
+   */
+  explicit AsyncScheduler(
+      const unsigned queueDepth = DEFAULT_QUEUE_DEPTH,
+      const PageIoQueue::Backend backend = PageIoQueue::AUTO);
+  ~AsyncScheduler();
+
+  /**
+   * Queues a task to be started by run().
+   */
+  void spawn(AsyncTask&& task);
+
+  /**
+   * Runs until every spawned task has finished.
+   *
+   * @throws  The first exception that escaped a task, after all tasks finish.
+   */
+  void run();
+
+  /**
+   * Returns the scheduler whose run() is executing on this thread, or NULL.
+   */
+  static AsyncScheduler* current();
+
+  /**
+   * Returns the number of times parked misses were started on the I/O queue.
+   */
+  std::size_t batches() const { return batches_; }
+
+ private:
+  friend class PageAwaitable;
+
+  /**
+   * A page read in flight and the awaitables waiting for it.
+   */
+  struct PendingRead {
+    PendingRead(const AsyncPool& pool) : pool(pool) {}
+
+    AsyncPool pool;
+    File* file;
+    PageId pageNo;
+    Page image;
+    std::vector<PageAwaitable*> waiters;
+  };
+
+  typedef std::pair<std::pair<AsyncPool, File*>, PageId> ReadKey;
+
+  /**
+   * Parks an awaitable until its page has been read.
+   */
+  void park(PageAwaitable* read) { parked_.push_back(read); }
+
+  /**
+   * Pins parked pages found resident or in the caches and starts reads for
+   * the others, as many as the queue takes; the rest stay parked.
+   */
+  void startParked();
+
+  /**
+   * Pins the page of a finished read for each of its waiters, or hands them
+   * the error, and requeues their coroutines.
+   */
+  void finishRead(PendingRead* read, const std::exception_ptr& error);
+
+  std::deque<std::coroutine_handle<> > ready_;
+  std::vector<PageAwaitable*> parked_;
+  std::map<ReadKey, PendingRead*> reading_;
+  std::vector<PendingRead*> spare_;
+  std::vector<std::coroutine_handle<AsyncTask::promise_type> > tasks_;
+  PageIoQueue* queue_ = NULL;
+  const unsigned queueDepth_;
+  const PageIoQueue::Backend backend_;
+  std::size_t batches_ = 0;
+};
+
+}
+
+#endif
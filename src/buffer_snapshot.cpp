@@ -0,0 +1,118 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "buffer_snapshot.h"
+
+#include <cstdio>
+
+namespace badgerdb {
+
+namespace {
+
+void writeJsonString(std::ostream& out, const std::string& value) {
+  out << '"';
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    const unsigned char c = value[i];
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (c < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out << escaped;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+void writeHistogram(std::ostream& out,
+                    const std::vector<std::uint32_t>& histogram) {
+  out << '[';
+  for (std::size_t i = 0; i < histogram.size(); ++i) {
+    if (i > 0) {
+      out << ',';
+    }
+    const std::uint64_t low = i == 0 ? 0 : (1ULL << (i - 1));
+    const std::uint64_t high = i == 0 ? 0 : (1ULL << i) - 1;
+    out << "{\"min\":" << low << ",\"max\":" << high
+        << ",\"frames\":" << histogram[i] << '}';
+  }
+  out << ']';
+}
+
+}
+
+void BufSnapshot::addToHistogram(std::vector<std::uint32_t>& histogram,
+                                 std::uint64_t value) {
+  std::size_t bucket = 0;
+  while (value > 0) {
+    ++bucket;
+    value >>= 1;
+  }
+  if (histogram.size() <= bucket) {
+    histogram.resize(bucket + 1, 0);
+  }
+  ++histogram[bucket];
+}
+
+void BufSnapshot::merge(const BufSnapshot& other) {
+  frames += other.frames;
+  valid += other.valid;
+  dirty += other.dirty;
+  pinned += other.pinned;
+  referenced += other.referenced;
+  accessClock += other.accessClock;
+
+  std::map<FileId, FileFrameCounts>::const_iterator it;
+  for (it = other.files.begin(); it != other.files.end(); ++it) {
+    FileFrameCounts& counts = files[it->first];
+    counts.name = it->second.name;
+    counts.resident += it->second.resident;
+    counts.dirty += it->second.dirty;
+    counts.pinned += it->second.pinned;
+  }
+
+  if (pinCounts.size() < other.pinCounts.size()) {
+    pinCounts.resize(other.pinCounts.size(), 0);
+  }
+  for (std::size_t i = 0; i < other.pinCounts.size(); ++i) {
+    pinCounts[i] += other.pinCounts[i];
+  }
+  if (ages.size() < other.ages.size()) {
+    ages.resize(other.ages.size(), 0);
+  }
+  for (std::size_t i = 0; i < other.ages.size(); ++i) {
+    ages[i] += other.ages[i];
+  }
+}
+
+void BufSnapshot::writeJson(std::ostream& out) const {
+  out << "{\"frames\":" << frames << ",\"valid\":" << valid
+      << ",\"dirty\":" << dirty << ",\"pinned\":" << pinned
+      << ",\"referenced\":" << referenced
+      << ",\"refbitRatio\":" << refbitRatio()
+      << ",\"accessClock\":" << accessClock << ",\"files\":[";
+  std::map<FileId, FileFrameCounts>::const_iterator it;
+  for (it = files.begin(); it != files.end(); ++it) {
+    if (it != files.begin()) {
+      out << ',';
+    }
+    out << "{\"id\":" << it->first << ",\"name\":";
+    writeJsonString(out, it->second.name);
+    out << ",\"resident\":" << it->second.resident
+        << ",\"dirty\":" << it->second.dirty
+        << ",\"pinned\":" << it->second.pinned << '}';
+  }
+  out << "],\"pinCounts\":";
+  writeHistogram(out, pinCounts);
+  out << ",\"ages\":";
+  writeHistogram(out, ages);
+  out << '}';
+}
+
+}
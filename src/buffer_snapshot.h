@@ -0,0 +1,138 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Frame counts of one file in a buffer pool snapshot.
+ */
+struct FileFrameCounts {
+  /**
+   * Name of the file.
+   */
+  std::string name;
+
+  /**
+   * Number of frames holding pages of the file.
+   */
+  std::uint32_t resident;
+
+  /**
+   * Number of those frames that are dirty.
+   */
+  std::uint32_t dirty;
+
+  /**
+   * Number of those frames that are pinned.
+   */
+  std::uint32_t pinned;
+
+  FileFrameCounts() : resident(0), dirty(0), pinned(0) {}
+};
+
+/**
+ * @brief Summary of the state of a buffer pool, taken by BufMgr::snapshot().
+ *
+ * Distributions are histograms with power-of-two buckets: bucket 0 counts the
+ * value 0 and bucket i > 0 counts values in [2^(i-1), 2^i).
+ */
+struct BufSnapshot {
+  /**
+   * Number of frames in the pool.
+   */
+  std::uint32_t frames;
+
+  /**
+   * Number of frames holding a page.
+   */
+  std::uint32_t valid;
+
+  /**
+   * Number of dirty frames.
+   */
+  std::uint32_t dirty;
+
+  /**
+   * Number of pinned frames.
+   */
+  std::uint32_t pinned;
+
+  /**
+   * Number of valid frames with the reference bit set.
+   */
+  std::uint32_t referenced;
+
+  /**
+   * Value of the pool's access clock when the snapshot was taken.  Every page
+   * access advances the clock by one.
+   */
+  std::uint64_t accessClock;
+
+  /**
+   * Frame counts per file.
+   */
+  std::map<FileId, FileFrameCounts> files;
+
+  /**
+   * Histogram of the pin counts of valid frames.
+   */
+  std::vector<std::uint32_t> pinCounts;
+
+  /**
+   * Histogram of the ages of valid frames, counted in accesses to the pool
+   * since the frame was last accessed.
+   */
+  std::vector<std::uint32_t> ages;
+
+  BufSnapshot()
+      : frames(0), valid(0), dirty(0), pinned(0), referenced(0),
+        accessClock(0) {
+  }
+
+  /**
+   * Returns the fraction of valid frames with the reference bit set.
+   */
+  double refbitRatio() const {
+    return valid == 0 ? 0.0 : static_cast<double>(referenced) / valid;
+  }
+
+  /**
+   * Adds a value to a power-of-two histogram.
+   *
+   * @param histogram Histogram to update, grown as needed.
+   * @param value     Value to count.
+   */
+  static void addToHistogram(std::vector<std::uint32_t>& histogram,
+                             std::uint64_t value);
+
+  /**
+   * Adds the counts of another snapshot to this one, e.g. to combine the
+   * partitions of a PartitionedBufMgr.  Ages are kept relative to each pool's
+   * own clock.
+   *
+   * @param other Snapshot to add.
+   */
+  void merge(const BufSnapshot& other);
+
+  /**
+   * Writes the snapshot as a single JSON object.
+   *
+   * @param out Stream to write to.
+   */
+  void writeJson(std::ostream& out) const;
+};
+
+}
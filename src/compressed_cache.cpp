@@ -0,0 +1,121 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "compressed_cache.h"
+
+#include <cstring>
+
+#include "lz_codec.h"
+
+namespace badgerdb {
+
+CompressedPageCache::CompressedPageCache(const std::size_t capacity)
+    : capacity_(capacity),
+      arena_(new char[capacity]),
+      head_(0),
+      used_(0) {
+}
+
+CompressedPageCache::~CompressedPageCache() {
+  delete[] arena_;
+}
+
+void CompressedPageCache::insert(const File* file, const PageId pageNo,
+                                 const Page& page) {
+  remove(file, pageNo);
+
+  char raw[Page::SIZE];
+  std::memcpy(raw, &page.header_, sizeof(page.header_));
+  std::memcpy(raw + sizeof(page.header_), page.data_.data(), Page::DATA_SIZE);
+  LzCodec::compress(raw, Page::SIZE, scratch_);
+
+  const std::size_t length = scratch_.size();
+  if (length >= Page::SIZE || length > capacity_) {
+    // Storing it would cost more than it saves.
+    return;
+  }
+
+  if (head_ + length > capacity_) {
+    // Wrap around.  Everything between the old head and the end of the arena
+    // was written in the previous lap, so it is the oldest data we hold.
+    while (!entries_.empty() && entries_.front().offset >= head_) {
+      erase(entries_.begin());
+      ++stats_.evictions;
+    }
+    head_ = 0;
+  }
+  makeRoom(head_, length);
+
+  std::memcpy(arena_ + head_, scratch_.data(), length);
+  Entry entry = {file->pageKey(pageNo), head_, length};
+  index_[entry.key] = entries_.insert(entries_.end(), entry);
+  head_ += length;
+  used_ += length;
+  ++stats_.inserts;
+}
+
+bool CompressedPageCache::lookup(const File* file, const PageId pageNo,
+                                 Page& page) {
+  EntryMap::iterator it = index_.find(file->pageKey(pageNo));
+  if (it == index_.end()) {
+    ++stats_.misses;
+    return false;
+  }
+
+  const Entry& entry = *it->second;
+  char raw[Page::SIZE];
+  if (!LzCodec::decompress(arena_ + entry.offset, entry.length, raw,
+                           Page::SIZE)) {
+    // Should not happen, but the file still has a good copy.
+    erase(it->second);
+    ++stats_.misses;
+    return false;
+  }
+  std::memcpy(&page.header_, raw, sizeof(page.header_));
+  page.data_.assign(raw + sizeof(page.header_), Page::DATA_SIZE);
+
+  erase(it->second);
+  ++stats_.hits;
+  return true;
+}
+
+void CompressedPageCache::remove(const File* file, const PageId pageNo) {
+  EntryMap::iterator it = index_.find(file->pageKey(pageNo));
+  if (it != index_.end()) {
+    erase(it->second);
+  }
+}
+
+void CompressedPageCache::removeFile(const File* file) {
+  // Keys of a file are contiguous since the file id is in the high bits.
+  const Key last = file->pageKey(~static_cast<PageId>(0));
+  EntryMap::iterator it = index_.lower_bound(file->pageKey(0));
+  while (it != index_.end() && it->first <= last) {
+    EntryList::iterator entry = it->second;
+    ++it;
+    erase(entry);
+  }
+}
+
+void CompressedPageCache::erase(EntryList::iterator entry) {
+  used_ -= entry->length;
+  index_.erase(entry->key);
+  entries_.erase(entry);
+}
+
+void CompressedPageCache::makeRoom(const std::size_t offset,
+                                   const std::size_t length) {
+  // Entries at or after the head are the oldest ones and sit in arena order at
+  // the front of the list, so only a prefix of the list can overlap.
+  while (!entries_.empty() && entries_.front().offset >= offset &&
+         entries_.front().offset < offset + length) {
+    erase(entries_.begin());
+    ++stats_.evictions;
+  }
+}
+
+}
@@ -0,0 +1,210 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <string>
+
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Class to maintain statistics of a second-tier page cache
+ */
+struct CacheStats
+{
+	/**
+   * Number of lookups satisfied by the cache
+	 */
+  int hits;
+
+	/**
+   * Number of lookups that had to fall through to the file
+	 */
+  int misses;
+
+	/**
+   * Number of pages accepted into the cache
+	 */
+  int inserts;
+
+	/**
+   * Number of pages pushed out of the cache to make room for newer ones
+	 */
+  int evictions;
+
+	/**
+   * Clear all values
+	 */
+  void clear()
+  {
+		hits = misses = inserts = evictions = 0;
+  }
+
+	/**
+   * Constructor of CacheStats class
+	 */
+  CacheStats()
+  {
+		clear();
+  }
+};
+
+/**
+ * @brief Victim cache holding compressed copies of pages evicted from the
+ *        buffer pool.
+ *
+ * Compressed pages are appended to a fixed-size ring arena, so the cache never
+ * allocates per page and the oldest pages are overwritten first.  The cache is
+ * exclusive: a page leaves the cache when it is handed back to the buffer pool,
+ * and the pool offers it again the next time it evicts it.
+ *
+ * Only clean pages may be inserted; the cache never writes anything to disk.
+ *
+ * @warning This class is not threadsafe.
+ */
+class CompressedPageCache {
+ public:
+  /**
+   * Constructs an empty cache.
+   *
+   * @param capacity  Size of the arena in bytes.
+   */
+  explicit CompressedPageCache(const std::size_t capacity);
+
+  /**
+   * Destructor of CompressedPageCache class
+   */
+  ~CompressedPageCache();
+
+  /**
+   * Compresses the page and stores it under (file, pageNo), replacing any
+   * previous copy.  Pages that do not compress below Page::SIZE are dropped.
+   *
+   * @param file    File object the page belongs to.
+   * @param pageNo  Page number in the file.
+   * @param page    Clean contents of the page.
+   */
+  void insert(const File* file, const PageId pageNo, const Page& page);
+
+  /**
+   * Looks up (file, pageNo).  On a hit the page is decompressed into <page>
+   * and removed from the cache.
+   *
+   * @param file    File object the page belongs to.
+   * @param pageNo  Page number in the file.
+   * @param page    Receives the page contents on a hit.
+   * @return  True on a hit.
+   */
+  bool lookup(const File* file, const PageId pageNo, Page& page);
+
+  /**
+   * Drops (file, pageNo) from the cache if it is present.
+   *
+   * @param file    File object the page belongs to.
+   * @param pageNo  Page number in the file.
+   */
+  void remove(const File* file, const PageId pageNo);
+
+  /**
+   * Drops every page of the file from the cache.
+   *
+   * @param file  File object.
+   */
+  void removeFile(const File* file);
+
+  /**
+   * Returns the number of arena bytes taken by live pages.
+   */
+  std::size_t bytesUsed() const { return used_; }
+
+  /**
+   * Returns the number of pages currently held.
+   */
+  std::size_t size() const { return index_.size(); }
+
+  /**
+   * Get cache usage statistics
+   */
+  const CacheStats& getStats() const { return stats_; }
+
+  /**
+   * Clear cache usage statistics
+   */
+  void clearStats() { stats_.clear(); }
+
+ private:
+  typedef PageKey Key;
+
+  /**
+   * Location of one compressed page in the arena.
+   */
+  struct Entry {
+    Key key;
+    std::size_t offset;
+    std::size_t length;
+  };
+
+  typedef std::list<Entry> EntryList;
+  typedef std::map<Key, EntryList::iterator> EntryMap;
+
+  /**
+   * Removes the entry from both the ring order and the index.
+   */
+  void erase(EntryList::iterator entry);
+
+  /**
+   * Evicts the oldest entries until [offset, offset + length) is free.
+   */
+  void makeRoom(const std::size_t offset, const std::size_t length);
+
+  /**
+   * Size of the arena in bytes.
+   */
+  std::size_t capacity_;
+
+  /**
+   * Ring arena holding the compressed pages.
+   */
+  char* arena_;
+
+  /**
+   * Offset at which the next page is appended.
+   */
+  std::size_t head_;
+
+  /**
+   * Bytes held by live entries.
+   */
+  std::size_t used_;
+
+  /**
+   * Entries in arena order, oldest first.
+   */
+  EntryList entries_;
+
+  /**
+   * Maps the key of each cached page to its entry.
+   */
+  EntryMap index_;
+
+  /**
+   * Scratch buffer reused by insert().
+   */
+  std::string scratch_;
+
+  /**
+   * Cache usage statistics.
+   */
+  CacheStats stats_;
+};
+
+}
@@ -0,0 +1,223 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BADGERDB_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+// Reflected Castagnoli polynomial.
+const std::uint32_t kPolynomial = 0x82f63b78;
+
+// tables[k][b] is the checksum of byte b followed by k zero bytes.
+struct Tables {
+  std::uint32_t entries[8][256];
+
+  Tables() {
+    for (std::uint32_t b = 0; b < 256; ++b) {
+      std::uint32_t crc = b;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (kPolynomial & (0 - (crc & 1)));
+      }
+      entries[0][b] = crc;
+    }
+    for (std::uint32_t b = 0; b < 256; ++b) {
+      for (int k = 1; k < 8; ++k) {
+        const std::uint32_t prev = entries[k - 1][b];
+        entries[k][b] = (prev >> 8) ^ entries[0][prev & 0xff];
+      }
+    }
+  }
+};
+
+const Tables kTables;
+
+#ifdef BADGERDB_CRC32C_SSE42
+// The crc32 instruction has a latency of three cycles but can start one per
+// cycle, so long inputs are split in three lanes run side by side, and the
+// lane checksums combined by shifting them over the bytes of the lanes after
+// them (multiplying by a power of x, done with tables like kTables).
+const std::size_t kLongLane = 2048;
+const std::size_t kShortLane = 256;
+
+std::uint32_t multiply(const std::uint32_t* matrix, std::uint32_t vector) {
+  std::uint32_t sum = 0;
+  while (vector != 0) {
+    if (vector & 1) {
+      sum ^= *matrix;
+    }
+    vector >>= 1;
+    ++matrix;
+  }
+  return sum;
+}
+
+void square(std::uint32_t* result, const std::uint32_t* matrix) {
+  for (int n = 0; n < 32; ++n) {
+    result[n] = multiply(matrix, matrix[n]);
+  }
+}
+
+// shift[k][b] is byte k of a checksum register holding b, advanced over
+// length zero bytes; length must be a power of two.
+struct ShiftTables {
+  std::uint32_t entries[4][256];
+
+  explicit ShiftTables(std::size_t length) {
+    // Operator for one zero bit, then squared up to length zero bytes.
+    std::uint32_t odd[32];
+    std::uint32_t even[32];
+    odd[0] = kPolynomial;
+    for (int n = 1; n < 32; ++n) {
+      odd[n] = 1u << (n - 1);
+    }
+    square(even, odd);
+    square(odd, even);
+    const std::uint32_t* op = odd;
+    for (;;) {
+      square(even, odd);
+      length >>= 1;
+      if (length == 0) {
+        op = even;
+        break;
+      }
+      square(odd, even);
+      length >>= 1;
+      if (length == 0) {
+        op = odd;
+        break;
+      }
+    }
+    for (std::uint32_t b = 0; b < 256; ++b) {
+      for (int k = 0; k < 4; ++k) {
+        entries[k][b] = multiply(op, b << (8 * k));
+      }
+    }
+  }
+
+  std::uint32_t shift(const std::uint32_t crc) const {
+    return entries[0][crc & 0xff] ^ entries[1][(crc >> 8) & 0xff] ^
+           entries[2][(crc >> 16) & 0xff] ^ entries[3][crc >> 24];
+  }
+};
+
+const ShiftTables kLongShift(kLongLane);
+const ShiftTables kShortShift(kShortLane);
+
+inline std::uint64_t load64(const unsigned char* bytes) {
+  std::uint64_t word;
+  std::memcpy(&word, bytes, sizeof(word));
+  return word;
+}
+
+__attribute__((target("sse4.2")))
+std::uint32_t extendLanes(std::uint32_t crc, const unsigned char*& bytes,
+                          std::size_t& length, const std::size_t lane,
+                          const ShiftTables& shift) {
+  while (length >= 3 * lane) {
+    std::uint64_t crc0 = crc;
+    std::uint64_t crc1 = 0;
+    std::uint64_t crc2 = 0;
+    const unsigned char* end = bytes + lane;
+    while (bytes < end) {
+      crc0 = _mm_crc32_u64(crc0, load64(bytes));
+      crc1 = _mm_crc32_u64(crc1, load64(bytes + lane));
+      crc2 = _mm_crc32_u64(crc2, load64(bytes + 2 * lane));
+      bytes += 8;
+    }
+    crc = shift.shift(static_cast<std::uint32_t>(crc0)) ^
+          static_cast<std::uint32_t>(crc1);
+    crc = shift.shift(crc) ^ static_cast<std::uint32_t>(crc2);
+    bytes += 2 * lane;
+    length -= 3 * lane;
+  }
+  return crc;
+}
+
+__attribute__((target("sse4.2")))
+std::uint32_t extendHardware(std::uint32_t crc, const void* data,
+                             std::size_t length) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  std::uint32_t value = ~crc;
+  value = extendLanes(value, bytes, length, kLongLane, kLongShift);
+  value = extendLanes(value, bytes, length, kShortLane, kShortShift);
+  std::uint64_t crc64 = value;
+  while (length >= 8) {
+    crc64 = _mm_crc32_u64(crc64, load64(bytes));
+    bytes += 8;
+    length -= 8;
+  }
+  value = static_cast<std::uint32_t>(crc64);
+  while (length > 0) {
+    value = _mm_crc32_u8(value, *bytes);
+    ++bytes;
+    --length;
+  }
+  return ~value;
+}
+
+bool detectHardware() {
+  // Needed since this runs during static initialization.
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+
+const bool kHardware = detectHardware();
+#else
+const bool kHardware = false;
+#endif
+
+}
+
+std::uint32_t Crc32c::extend(const std::uint32_t crc, const void* data,
+                             const std::size_t length) {
+#ifdef BADGERDB_CRC32C_SSE42
+  if (kHardware) {
+    return extendHardware(crc, data, length);
+  }
+#endif
+  return extendSoftware(crc, data, length);
+}
+
+std::uint32_t Crc32c::extendSoftware(const std::uint32_t crc, const void* data,
+                                     const std::size_t length) {
+  const std::uint32_t (*t)[256] = kTables.entries;
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  std::size_t left = length;
+  std::uint32_t value = ~crc;
+  while (left >= 8) {
+    // Little-endian: the low bytes of value line up with the first bytes.
+    const std::uint32_t low = value ^ (bytes[0] | bytes[1] << 8 |
+                                       bytes[2] << 16 |
+                                       static_cast<std::uint32_t>(bytes[3]) << 24);
+    value = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^
+            t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+            t[3][bytes[4]] ^ t[2][bytes[5]] ^ t[1][bytes[6]] ^ t[0][bytes[7]];
+    bytes += 8;
+    left -= 8;
+  }
+  while (left > 0) {
+    value = (value >> 8) ^ t[0][(value ^ *bytes) & 0xff];
+    ++bytes;
+    --left;
+  }
+  return ~value;
+}
+
+bool Crc32c::isHardware() {
+  return kHardware;
+}
+
+}
@@ -0,0 +1,49 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * @brief CRC-32C (Castagnoli) checksums.
+ *
+ * Uses the SSE4.2 crc32 instruction when the CPU has it, checked once at
+ * startup, and a table-driven software version (slicing by 8) otherwise.
+ * Both give the same result, so files can move between machines.
+ */
+class Crc32c {
+ public:
+  /**
+   * Extends a checksum over <length> more bytes.  Start a new checksum
+   * with crc 0.
+   *
+   * @param crc     Checksum of the bytes before data.
+   * @param data    Bytes to add.
+   * @param length  Number of bytes at data.
+   * @return  Checksum of all the bytes.
+   */
+  static std::uint32_t extend(const std::uint32_t crc, const void* data,
+                              const std::size_t length);
+
+  /**
+   * Same as extend(), always in software.
+   */
+  static std::uint32_t extendSoftware(const std::uint32_t crc,
+                                      const void* data,
+                                      const std::size_t length);
+
+  /**
+   * Returns true if extend() uses the SSE4.2 instruction.
+   */
+  static bool isHardware();
+};
+
+}
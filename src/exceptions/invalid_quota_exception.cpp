@@ -0,0 +1,22 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "invalid_quota_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+InvalidQuotaException::InvalidQuotaException(const std::string& nameIn, std::uint32_t minFramesIn, std::uint32_t maxFramesIn)
+    : BadgerDbException(""), name(nameIn), minFrames(minFramesIn), maxFrames(maxFramesIn) {
+  std::stringstream ss;
+  ss << "Frame quota can not be honoured. file: " << name << " min: " << minFrames << " max: " << maxFrames;
+  message_.assign(ss.str());
+}
+
+}
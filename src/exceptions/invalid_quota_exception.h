@@ -0,0 +1,44 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a frame quota can not be honoured by the buffer pool.
+ */
+class InvalidQuotaException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an invalid quota exception for the given file.
+   */
+  explicit InvalidQuotaException(const std::string& nameIn, std::uint32_t minFramesIn, std::uint32_t maxFramesIn);
+
+ protected:
+  /**
+   * Name of file that caused this exception.
+   */
+  const std::string& name;
+
+  /**
+   * Requested minimum number of frames
+   */
+  const std::uint32_t minFrames;
+
+  /**
+   * Requested maximum number of frames
+   */
+  const std::uint32_t maxFrames;
+};
+
+}
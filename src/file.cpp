@@ -7,31 +7,89 @@
 
 #include "file.h"
 
-#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <cstdio>
+#include <cstring>
 #include <cassert>
+#include <cerrno>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
 
+#include "exceptions/checksum_mismatch_exception.h"
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_format_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/io_error_exception.h"
 #include "file_iterator.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
+namespace {
+
+/**
+ * Header of files from before allocation bitmaps.  Used pages were linked in
+ * page order through PageHeader::next_page_number, free pages likewise.
+ */
+struct ListFileHeader {
+  PageId num_pages;
+  PageId first_used_page;
+  PageId num_free_pages;
+  PageId first_free_page;
+};
+
+/**
+ * Returns a copy of the header with the checksum of the page filled in.
+ */
+PageHeader sealHeader(const PageHeader& header, const char* data) {
+  PageHeader sealed = header;
+  sealed.checksum = Page::checksum(header, data);
+  return sealed;
+}
+
+/**
+ * Returns true if the format in a file header marks a compressed file.
+ */
+bool isCompressedFormat(const std::uint32_t format) {
+  return (format & ~PageCodec::MAX_ID) == FileHeader::COMPRESSED_FORMAT;
+}
+
+}
+
+File::FdMap File::open_fds_;
 File::CountMap File::open_counts_;
+File::HeaderMap File::open_headers_;
+File::IdMap File::open_ids_;
+File::ReservationMap File::reserved_pages_;
+File::TempMap File::temp_pages_;
+FileId File::next_id_ = 1;
+const std::chrono::milliseconds File::SYNC_BATCH_INTERVAL(100);
+std::recursive_mutex File::io_latch_;
 
-File File::create(const std::string& filename) {
-  return File(filename, true /* create_new */);
+File File::create(const std::string& filename, const bool direct) {
+  return File(filename, true /* create_new */, false /* temporary */, direct);
 }
 
-File File::open(const std::string& filename) {
-  return File(filename, false /* create_new */);
+File File::open(const std::string& filename, const bool direct) {
+  return File(filename, false /* create_new */, false /* temporary */, direct);
+}
+
+File File::createTemp(const std::string& filename) {
+  return File(filename, true /* create_new */, true /* temporary */);
+}
+
+File File::createCompressed(const std::string& filename,
+                            const PageCodec& codec) {
+  PageCodec::registerCodec(codec);
+  return File(filename, true /* create_new */, false /* temporary */,
+              false /* direct */, &codec);
 }
 
 void File::remove(const std::string& filename) {
@@ -52,28 +110,103 @@ bool File::isOpen(const std::string& filename) {
 }
 
 bool File::exists(const std::string& filename) {
-	std::fstream file(filename);
-	if(file)
-	{
-		file.close();
-		return true;
-	}
+  struct stat info;
+  return ::stat(filename.c_str(), &info) == 0;
+}
 
-	return false;
+bool File::convert(const std::string& filename) {
+  if (!exists(filename)) {
+    throw FileNotFoundException(filename);
+  }
+  if (isOpen(filename)) {
+    throw FileOpenException(filename);
+  }
+  const std::string converted = filename + ".convert";
+  {
+    FileDescriptor old_fd(filename, false /* create_new */);
+    FileHeader header;
+    old_fd.read(&header, sizeof(header), 0 /* pos */);
+    if (header.format == FileHeader::BITMAP_FORMAT ||
+        isCompressedFormat(header.format)) {
+      return false;
+    }
+    const bool unaligned =
+        header.format == FileHeader::UNCHECKED_BITMAP_FORMAT ||
+        header.format == FileHeader::UNALIGNED_BITMAP_FORMAT;
+    ListFileHeader old_header;
+    old_fd.read(&old_header, sizeof(old_header), 0 /* pos */);
+
+    // Free pages were cleared when deleted, so a page is in use exactly when
+    // it carries its own number; no need to walk the used list or read the
+    // old bitmap.
+    FileDescriptor new_fd(converted, true /* create_new */);
+    header.format = FileHeader::BITMAP_FORMAT;
+    header.num_pages = unaligned ? header.num_pages : old_header.num_pages;
+    header.num_free_pages = 0;
+    std::vector<unsigned char> bitmap;
+    std::vector<char> raw(Page::SIZE);
+    for (PageId page_number = 1; page_number < header.num_pages;
+         ++page_number) {
+      old_fd.read(&raw[0], raw.size(),
+                  unaligned
+                      ? pagePosition(page_number) -
+                            static_cast<off_t>(FileHeader::BITMAP_HEADER_SIZE -
+                                               sizeof(FileHeader))
+                      : static_cast<off_t>(sizeof(old_header) +
+                                          (page_number - 1) * Page::SIZE));
+      PageHeader page_header;
+      std::memcpy(&page_header, &raw[0], sizeof(page_header));
+      const std::size_t bit = page_number - 1;
+      bitmap.resize((bit / PAGES_PER_MAP + 1) * Page::SIZE, 0);
+      if (page_header.current_page_number == page_number) {
+        bitmap[bit / 8] |= 1 << (bit % 8);
+        page_header = sealHeader(page_header, &raw[sizeof(page_header)]);
+        std::memcpy(&raw[0], &page_header, sizeof(page_header));
+      } else {
+        ++header.num_free_pages;
+      }
+      new_fd.write(&raw[0], raw.size(), pagePosition(page_number));
+    }
+    for (std::size_t group = 0; group * Page::SIZE < bitmap.size(); ++group) {
+      new_fd.write(&bitmap[group * Page::SIZE], Page::SIZE,
+                   mapPosition(group));
+    }
+    new_fd.write(&header, sizeof(header), 0 /* pos */);
+    if (::fsync(new_fd.fd()) != 0) {
+      throw IoErrorException(filename, "fsync", errno);
+    }
+  }
+  if (std::rename(converted.c_str(), filename.c_str()) != 0) {
+    throw IoErrorException(filename, "rename", errno);
+  }
+  return true;
 }
 
 File::File(const File& other)
-  : filename_(other.filename_),
-    stream_(open_streams_[filename_]) {
+  : filename_(other.filename_) {
+  LatchGuard latch(io_latch_);
+  fd_ = open_fds_[filename_];
+  cached_header_ = open_headers_[filename_];
+  id_ = open_ids_[filename_];
+  temporary_ = other.temporary_;
   ++open_counts_[filename_];
 }
 
 File& File::operator=(const File& rhs) {
-  // This accounts for self-assignment and assignment of a File object for the
-  // same file.
+  if (this == &rhs) {
+    return *this;
+  }
+  // Take the new handle the way the copy constructor does before closing the
+  // old one, so assigning a handle of the same file never closes the file in
+  // between and loses its temporary pages, reservations or id.
+  LatchGuard latch(io_latch_);
+  ++open_counts_[rhs.filename_];
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
-  openIfNeeded(false /* create_new */);
+  fd_ = open_fds_[filename_];
+  cached_header_ = open_headers_[filename_];
+  id_ = open_ids_[filename_];
+  temporary_ = rhs.temporary_;
   return *this;
 }
 
@@ -82,73 +215,540 @@ File::~File() {
 }
 
 Page File::allocatePage() {
+  std::unique_lock<std::recursive_mutex> latch(io_latch_);
+  if (temporary_) {
+    return allocateTempPage();
+  }
   FileHeader header = readHeader();
+  std::set<PageId>& free_pages = cached_header_->free_pages;
   Page new_page;
-  Page existing_page;
-  if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
+  if (!free_pages.empty()) {
+    new_page.set_page_number(*free_pages.begin());
+    free_pages.erase(free_pages.begin());
     --header.num_free_pages;
+  } else {
+    new_page.set_page_number(nextAppendNumber(header));
+    extendTo(header, new_page.page_number());
+  }
+  // A reused page still holds what it had before, so clear it on disk too.
+  writePage(new_page.page_number(), new_page);
+  setAllocated(new_page.page_number(), 1, true);
+  writeHeader(header);
+  syncIfDue(latch);
 
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
+  return new_page;
+}
+
+std::vector<Page> File::allocatePages(const PageId num_pages) {
+  LatchGuard latch(io_latch_);
+  std::vector<Page> pages(num_pages);
+  if (num_pages == 0) {
+    return pages;
+  }
+  PageId first_page;
+  if (temporary_) {
+    first_page = temp_pages_[filename_].next_page;
+    temp_pages_[filename_].next_page += num_pages;
+  } else {
+    FileHeader header = readHeader();
+    first_page = nextAppendNumber(header);
+    extendTo(header, first_page, num_pages);
+    setAllocated(first_page, num_pages, true);
+    writeHeader(header);
+  }
+  // writePages() syncs if needed.
+  std::vector<const Page*> batch(num_pages);
+  for (PageId i = 0; i < num_pages; ++i) {
+    pages[i].set_page_number(first_page + i);
+    batch[i] = &pages[i];
+  }
+  if (!temporary_) {
+    writePages(batch);
+  }
+  return pages;
+}
+
+Page File::reservePage() {
+  LatchGuard latch(io_latch_);
+  if (temporary_) {
+    return allocateTempPage();
+  }
+  const FileHeader header = readHeader();
+  if (!cached_header_->free_pages.empty()) {
+    return allocatePage();
+  }
+  Page new_page;
+  new_page.set_page_number(nextAppendNumber(header));
+  reserved_pages_[filename_].insert(new_page.page_number());
+  return new_page;
+}
+
+bool File::isReserved(const PageId page_number) const {
+  LatchGuard latch(io_latch_);
+  ReservationMap::const_iterator reserved = reserved_pages_.find(filename_);
+  return reserved != reserved_pages_.end() &&
+         reserved->second.count(page_number) > 0;
+}
+
+Page File::allocateTempPage() {
+  TempPages& temp = temp_pages_[filename_];
+  Page new_page;
+  if (!temp.free_pages.empty()) {
+    new_page.set_page_number(*temp.free_pages.begin());
+    temp.free_pages.erase(temp.free_pages.begin());
+  } else {
+    new_page.set_page_number(temp.next_page++);
+  }
+  return new_page;
+}
+
+bool File::isTempPageInUse(const PageId page_number) const {
+  TempMap::const_iterator temp = temp_pages_.find(filename_);
+  return page_number != Page::INVALID_NUMBER &&
+         page_number < temp->second.next_page &&
+         temp->second.free_pages.count(page_number) == 0;
+}
+
+PageId File::nextAppendNumber(const FileHeader& header) const {
+  ReservationMap::const_iterator reserved = reserved_pages_.find(filename_);
+  if (reserved == reserved_pages_.end() || reserved->second.empty() ||
+      *reserved->second.rbegin() < header.num_pages) {
+    return header.num_pages;
+  }
+  return *reserved->second.rbegin() + 1;
+}
+
+void File::extendTo(FileHeader& header, const PageId page_number,
+                    const PageId num_pages) {
+  ReservationMap::const_iterator reserved = reserved_pages_.find(filename_);
+  for (PageId skipped = header.num_pages; skipped < page_number; ++skipped) {
+    if (reserved == reserved_pages_.end() ||
+        reserved->second.count(skipped) == 0) {
+      cached_header_->free_pages.insert(skipped);
+      ++header.num_free_pages;
+    }
+  }
+  if (header.num_pages < page_number + num_pages) {
+    header.num_pages = page_number + num_pages;
+  }
+  CachedHeader& cached = *cached_header_;
+  if (cached.codec == NULL && cached.extent_size > 0 &&
+      cached.preallocated_end < header.num_pages) {
+    // Whole extents from the end of the last one, enough for the new pages.
+    PageId end = cached.preallocated_end;
+    while (end < header.num_pages) {
+      end += cached.extent_size;
+    }
+    const off_t start = pagePosition(cached.preallocated_end);
+    fd_->preallocate(start, pagePosition(end) - start);
+    cached.preallocated_end = end;
+  }
+}
+
+void File::materializePage(const PageId page_number) {
+  FileHeader header = readHeader();
+  reserved_pages_[filename_].erase(page_number);
+  extendTo(header, page_number);
+  setAllocated(page_number, 1, true);
+  writeHeader(header);
+}
+
+bool File::isAllocated(const PageId page_number) const {
+  const std::vector<unsigned char>& bitmap = cached_header_->bitmap;
+  const std::size_t bit = page_number - 1;
+  return page_number != Page::INVALID_NUMBER &&
+         bit / 8 < bitmap.size() &&
+         (bitmap[bit / 8] & (1 << (bit % 8))) != 0;
+}
+
+void File::setAllocated(const PageId first_page, const PageId num_pages,
+                        const bool used) {
+  std::vector<unsigned char>& bitmap = cached_header_->bitmap;
+  const std::size_t first_bit = first_page - 1;
+  const std::size_t end_bit = first_bit + num_pages;
+  const PageId first_group = first_bit / PAGES_PER_MAP;
+  const PageId last_group = (end_bit - 1) / PAGES_PER_MAP;
+  if (bitmap.size() < (last_group + 1) * Page::SIZE) {
+    bitmap.resize((last_group + 1) * Page::SIZE, 0);
+  }
+  for (std::size_t bit = first_bit; bit < end_bit; ++bit) {
+    if (used) {
+      bitmap[bit / 8] |= 1 << (bit % 8);
     } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
+      bitmap[bit / 8] &= ~(1 << (bit % 8));
+    }
+  }
+  if (cached_header_->codec != NULL) {
+    // The directory records which pages are in use.
+    return;
+  }
+  for (PageId group = first_group; group <= last_group; ++group) {
+    fd_->write(&bitmap[group * Page::SIZE], Page::SIZE, mapPosition(group));
+    countWrite();
+  }
+}
+
+PageId File::nextUsedPage(const PageId page_number) const {
+  LatchGuard latch(io_latch_);
+  const std::vector<unsigned char>& bitmap = cached_header_->bitmap;
+  const std::size_t end = cached_header_->header.num_pages - 1;
+  // Bit of the page after page_number; page numbers start at 1.
+  std::size_t bit = page_number;
+  while (bit < end && bit / 8 < bitmap.size()) {
+    if (bit % 8 == 0 && bitmap[bit / 8] == 0) {
+      bit += 8;
+      continue;
+    }
+    if (bitmap[bit / 8] & (1 << (bit % 8))) {
+      return bit + 1;
+    }
+    ++bit;
+  }
+  return Page::INVALID_NUMBER;
+}
+
+void File::loadBitmap() {
+  const FileHeader& header = cached_header_->header;
+  std::vector<unsigned char>& bitmap = cached_header_->bitmap;
+  if (cached_header_->codec != NULL) {
+    loadDirectory();
+  } else if (header.num_pages > 1) {
+    const PageId groups = (header.num_pages - 2) / PAGES_PER_MAP + 1;
+    bitmap.resize(groups * Page::SIZE);
+    for (PageId group = 0; group < groups; ++group) {
+      fd_->read(&bitmap[group * Page::SIZE], Page::SIZE, mapPosition(group));
+    }
+  }
+  for (PageId page_number = 1; page_number < header.num_pages; ++page_number) {
+    if (!isAllocated(page_number)) {
+      cached_header_->free_pages.insert(page_number);
+    }
+  }
+}
+
+void File::loadDirectory() {
+  CachedHeader& cached = *cached_header_;
+  const PageId num_pages = cached.header.num_pages;
+  cached.slots.assign(std::max<PageId>(num_pages, 1), DirectoryEntry());
+  cached.slot_versions.assign(cached.slots.size(), 0);
+  // Everything in use, to find the free space in between afterwards.
+  std::vector<std::pair<off_t, off_t> > used;
+  std::vector<char> raw(Page::SIZE);
+  off_t position = sizeof(FileHeader);
+  while (position != 0) {
+    fd_->read(&raw[0], raw.size(), position);
+    const std::size_t index = cached.directories.size();
+    cached.directories.push_back(position);
+    used.push_back(std::make_pair(position, static_cast<off_t>(Page::SIZE)));
+    for (PageId entry = 0; entry < PAGES_PER_DIRECTORY; ++entry) {
+      const PageId page_number = index * PAGES_PER_DIRECTORY + entry + 1;
+      if (page_number >= num_pages) {
+        break;
+      }
+      DirectoryEntry slot;
+      std::memcpy(&slot, &raw[sizeof(std::uint64_t) + entry * sizeof(slot)],
+                  sizeof(slot));
+      if (slot.capacity != 0) {
+        cached.slots[page_number] = slot;
+        cached.slot_owners[slot.offset] = page_number;
+        setAllocated(page_number, 1, true);
+        used.push_back(std::make_pair(static_cast<off_t>(slot.offset),
+                                      static_cast<off_t>(slot.capacity)));
       }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
     }
+    std::uint64_t next;
+    std::memcpy(&next, &raw[0], sizeof(next));
+    position = next;
+  }
 
-    assert((header.num_free_pages == 0) ==
-           (header.first_free_page == Page::INVALID_NUMBER));
-  } else {
-    new_page.set_page_number(header.num_pages);
-    if (header.first_used_page == Page::INVALID_NUMBER) {
-      header.first_used_page = new_page.page_number();
-    } else {
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
+  std::sort(used.begin(), used.end());
+  off_t end = sizeof(FileHeader);
+  for (std::size_t i = 0; i < used.size(); ++i) {
+    if (used[i].first > end) {
+      cached.free_space[end] = used[i].first - end;
+    }
+    end = std::max(end, used[i].first + used[i].second);
+  }
+  cached.data_end = end;
+}
+
+void File::writeDirectory(const std::size_t index) {
+  CachedHeader& cached = *cached_header_;
+  const std::size_t known = cached.directories.size();
+  while (cached.directories.size() <= index) {
+    cached.directories.push_back(allocateSpace(Page::SIZE));
+  }
+  // Write new directory pages before the page that links to them, so the
+  // chain on disk never leads to garbage.
+  const std::size_t first = std::min(index, known - 1);
+  const std::size_t last =
+      cached.directories.size() > known ? cached.directories.size() - 1 : index;
+  std::vector<char> raw(Page::SIZE);
+  for (std::size_t i = last + 1; i-- > first;) {
+    std::fill(raw.begin(), raw.end(), 0);
+    const std::uint64_t next =
+        i + 1 < cached.directories.size() ? cached.directories[i + 1] : 0;
+    std::memcpy(&raw[0], &next, sizeof(next));
+    for (PageId entry = 0; entry < PAGES_PER_DIRECTORY; ++entry) {
+      const PageId page_number = i * PAGES_PER_DIRECTORY + entry + 1;
+      if (page_number >= cached.slots.size()) {
+        break;
       }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+      std::memcpy(&raw[sizeof(next) + entry * sizeof(DirectoryEntry)],
+                  &cached.slots[page_number], sizeof(DirectoryEntry));
     }
-    ++header.num_pages;
+    fd_->write(&raw[0], raw.size(), cached.directories[i]);
+    countWrite();
   }
-  writePage(new_page.page_number(), new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page);
+}
+
+void File::readCompressedPage(const PageId page_number, Page& page) const {
+  const CachedHeader& cached = *cached_header_;
+  std::vector<char> buffer;
+  char image[Page::SIZE];
+  for (;;) {
+    // Only the directory entry is taken under the latch.  The slot is read
+    // and decompressed without it, then the read starts over if the slot was
+    // written, moved or released in the meantime.
+    DirectoryEntry slot;
+    std::uint64_t version;
+    {
+      LatchGuard latch(io_latch_);
+      if (page_number >= cached.slots.size() ||
+          cached.slots[page_number].capacity == 0) {
+        return;
+      }
+      slot = cached.slots[page_number];
+      version = cached.slot_versions[page_number];
+    }
+    buffer.resize(slot.capacity);
+    fd_->read(&buffer[0], buffer.size(), slot.offset);
+
+    std::uint32_t length;
+    std::memcpy(&length, &buffer[0], sizeof(length));
+    const char* stored = &buffer[sizeof(length)];
+    bool intact = length <= buffer.size() - sizeof(length);
+    if (intact && length == Page::SIZE) {
+      std::memcpy(image, stored, Page::SIZE);
+    } else if (intact) {
+      intact = cached.codec->decompress(stored, length, image, Page::SIZE);
+    }
+
+    {
+      LatchGuard latch(io_latch_);
+      if (page_number >= cached.slot_versions.size() ||
+          cached.slot_versions[page_number] != version) {
+        continue;
+      }
+    }
+    if (!intact) {
+      throw ChecksumMismatchException(page_number, filename_);
+    }
+    std::memcpy(&page.header_, image, sizeof(page.header_));
+    page.data_.assign(image + sizeof(page.header_), Page::DATA_SIZE);
+    return;
   }
-  writeHeader(header);
+}
 
-  return new_page;
+bool File::writeCompressedPage(const PageId page_number,
+                               const PageHeader& header, const char* data) {
+  CachedHeader& cached = *cached_header_;
+  char image[Page::SIZE];
+  const PageHeader sealed = sealHeader(header, data);
+  std::memcpy(image, &sealed, sizeof(sealed));
+  std::memcpy(image + sizeof(sealed), data, Page::DATA_SIZE);
+
+  std::string compressed;
+  cached.codec->compress(image, Page::SIZE, compressed);
+  std::uint32_t length = compressed.size();
+  const char* stored = compressed.data();
+  if (length >= Page::SIZE) {
+    length = Page::SIZE;
+    stored = image;
+  }
+  const off_t needed = (sizeof(length) + length + SLOT_ALIGNMENT - 1) /
+                       SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+
+  if (cached.slots.size() <= page_number) {
+    cached.slots.resize(page_number + 1, DirectoryEntry());
+    cached.slot_versions.resize(page_number + 1, 0);
+  }
+  DirectoryEntry& slot = cached.slots[page_number];
+  ++cached.slot_versions[page_number];
+  bool moved = false;
+  if (static_cast<off_t>(slot.capacity) < needed) {
+    const std::size_t directory = (page_number - 1) / PAGES_PER_DIRECTORY;
+    if (cached.directories.size() <= directory) {
+      // Directory pages go before the slots they map, as reorganize() puts
+      // them.
+      writeDirectory(directory);
+    }
+    if (slot.capacity != 0) {
+      cached.slot_owners.erase(slot.offset);
+    }
+    releaseSpace(slot.offset, slot.capacity);
+    slot.offset = allocateSpace(needed);
+    slot.capacity = needed;
+    cached.slot_owners[slot.offset] = page_number;
+    moved = true;
+  }
+  struct iovec parts[2] = {
+    {&length, sizeof(length)},
+    {const_cast<char*>(stored), length}
+  };
+  fd_->writev(parts, 2, slot.offset);
+  countWrite();
+  return moved;
+}
+
+off_t File::allocateSpace(const off_t length) {
+  CachedHeader& cached = *cached_header_;
+  for (std::map<off_t, off_t>::iterator piece = cached.free_space.begin();
+       piece != cached.free_space.end(); ++piece) {
+    if (piece->second >= length) {
+      const off_t position = piece->first;
+      const off_t rest = piece->second - length;
+      cached.free_space.erase(piece);
+      if (rest > 0) {
+        cached.free_space[position + length] = rest;
+      }
+      return position;
+    }
+  }
+  const off_t position = cached.data_end;
+  cached.data_end += length;
+  return position;
+}
+
+void File::releaseSpace(off_t offset, off_t length) {
+  if (length == 0) {
+    return;
+  }
+  CachedHeader& cached = *cached_header_;
+  std::map<off_t, off_t>::iterator next = cached.free_space.lower_bound(offset);
+  if (next != cached.free_space.end() && next->first == offset + length) {
+    length += next->second;
+    cached.free_space.erase(next++);
+  }
+  if (next != cached.free_space.begin()) {
+    std::map<off_t, off_t>::iterator previous = next;
+    --previous;
+    if (previous->first + previous->second == offset) {
+      offset = previous->first;
+      length += previous->second;
+      cached.free_space.erase(previous);
+    }
+  }
+  if (offset + length == cached.data_end) {
+    cached.data_end = offset;
+  } else {
+    cached.free_space[offset] = length;
+  }
+}
+
+void File::takeSpace(const off_t offset, const off_t length) {
+  CachedHeader& cached = *cached_header_;
+  const off_t end = offset + length;
+  if (end > cached.data_end) {
+    const off_t old_end = cached.data_end;
+    cached.data_end = end;
+    if (offset > old_end) {
+      releaseSpace(old_end, offset - old_end);
+    }
+  }
+  std::map<off_t, off_t>::iterator piece = cached.free_space.upper_bound(offset);
+  if (piece != cached.free_space.begin()) {
+    --piece;
+  }
+  while (piece != cached.free_space.end() && piece->first < end) {
+    const off_t piece_start = piece->first;
+    const off_t piece_end = piece->first + piece->second;
+    if (piece_end <= offset) {
+      ++piece;
+      continue;
+    }
+    cached.free_space.erase(piece++);
+    if (piece_start < offset) {
+      cached.free_space[piece_start] = offset - piece_start;
+    }
+    if (piece_end > end) {
+      cached.free_space[end] = piece_end - end;
+    }
+  }
+}
+
+off_t File::relocate(const PageId page_number, const std::size_t directory,
+                     const off_t to) {
+  CachedHeader& cached = *cached_header_;
+  if (page_number == Page::INVALID_NUMBER) {
+    // Directory pages are written from memory.
+    const off_t from = cached.directories[directory];
+    takeSpace(to, Page::SIZE);
+    cached.directories[directory] = to;
+    writeDirectory(directory);
+    writeDirectory(directory - 1);
+    releaseSpace(from, Page::SIZE);
+    return Page::SIZE;
+  }
+  DirectoryEntry& slot = cached.slots[page_number];
+  ++cached.slot_versions[page_number];
+  const off_t from = slot.offset;
+  std::vector<char> buffer(slot.capacity);
+  fd_->read(&buffer[0], buffer.size(), from);
+  takeSpace(to, buffer.size());
+  fd_->write(&buffer[0], buffer.size(), to);
+  countWrite();
+  slot.offset = to;
+  cached.slot_owners.erase(from);
+  cached.slot_owners[to] = page_number;
+  writeDirectory((page_number - 1) / PAGES_PER_DIRECTORY);
+  releaseSpace(from, buffer.size());
+  return buffer.size();
+}
+
+off_t File::clearSpace(const off_t offset, const off_t length) {
+  CachedHeader& cached = *cached_header_;
+  const off_t end = offset + length;
+  std::vector<PageId> pages;
+  std::map<off_t, PageId>::const_iterator owner =
+      cached.slot_owners.lower_bound(offset);
+  if (owner != cached.slot_owners.begin()) {
+    --owner;
+    if (owner->first +
+            static_cast<off_t>(cached.slots[owner->second].capacity) <=
+        offset) {
+      ++owner;
+    }
+  }
+  for (; owner != cached.slot_owners.end() && owner->first < end; ++owner) {
+    pages.push_back(owner->second);
+  }
+  // Out of the way means past everything, and past the range itself.
+  off_t moved = 0;
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    moved += relocate(pages[i], 0, std::max(cached.data_end, end));
+  }
+  for (std::size_t i = 1; i < cached.directories.size(); ++i) {
+    if (cached.directories[i] < end &&
+        cached.directories[i] + static_cast<off_t>(Page::SIZE) > offset) {
+      moved += relocate(Page::INVALID_NUMBER, i,
+                        std::max(cached.data_end, end));
+    }
+  }
+  return moved;
 }
 
 Page File::readPage(const PageId page_number) const {
-  FileHeader header = readHeader();
-  if (page_number >= header.num_pages) {
+  // Positional reads need no latch; only the temporary page map does.
+  std::unique_lock<std::recursive_mutex> latch(io_latch_, std::defer_lock);
+  if (temporary_) {
+    latch.lock();
+    if (!isTempPageInUse(page_number)) {
+      throw InvalidPageException(page_number, filename_);
+    }
+    return readPage(page_number, false /* allow_free */);
+  }
+  if (page_number >= numPages()) {
     throw InvalidPageException(page_number, filename_);
   }
   return readPage(page_number, false /* allow_free */);
@@ -156,114 +756,596 @@ Page File::readPage(const PageId page_number) const {
 
 Page File::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
+  if (cached_header_->codec != NULL) {
+    readCompressedPage(page_number, page);
+  } else {
+    struct iovec parts[2] = {
+      {&page.header_, sizeof(page.header_)},
+      {&page.data_[0], Page::DATA_SIZE}
+    };
+    fd_->readv(parts, 2, pagePosition(page_number));
+  }
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
+  if (page.isUsed() &&
+      page.header_.checksum != Page::checksum(page.header_, page.data_.data())) {
+    throw ChecksumMismatchException(page_number, filename_);
+  }
 
   return page;
 }
 
+std::vector<Page> File::readPages(
+    const std::vector<PageId>& page_numbers) const {
+  std::vector<Page> pages(page_numbers.size());
+  if (cached_header_->codec != NULL) {
+    // Slots are not laid out in page order, so there are no runs to read.
+    for (std::size_t i = 0; i < page_numbers.size(); ++i) {
+      pages[i] = readPage(page_numbers[i]);
+    }
+    return pages;
+  }
+  std::unique_lock<std::recursive_mutex> latch(io_latch_, std::defer_lock);
+  if (temporary_) {
+    latch.lock();
+  }
+  const PageId num_pages = temporary_ ? temp_pages_[filename_].next_page
+                                      : numPages();
+  std::vector<char> buffer;
+
+  std::size_t run_start = 0;
+  while (run_start < page_numbers.size()) {
+    // Extend the run while page numbers stay consecutive and no bitmap page
+    // lies in between.
+    std::size_t run_end = run_start + 1;
+    while (run_end < page_numbers.size() &&
+           page_numbers[run_end] == page_numbers[run_end - 1] + 1 &&
+           (page_numbers[run_end] - 1) % PAGES_PER_MAP != 0) {
+      ++run_end;
+    }
+    const PageId last = page_numbers[run_end - 1];
+    if (page_numbers[run_start] == Page::INVALID_NUMBER ||
+        last >= num_pages) {
+      throw InvalidPageException(
+          last >= num_pages ? last : page_numbers[run_start], filename_);
+    }
+
+    const std::size_t run_length = run_end - run_start;
+    buffer.resize(run_length * Page::SIZE);
+    fd_->read(&buffer[0], buffer.size(), pagePosition(page_numbers[run_start]));
+
+    for (std::size_t i = 0; i < run_length; ++i) {
+      Page& page = pages[run_start + i];
+      const char* raw = &buffer[i * Page::SIZE];
+      std::memcpy(&page.header_, raw, sizeof(page.header_));
+      page.data_.assign(raw + sizeof(page.header_), Page::DATA_SIZE);
+      if (!page.isUsed() ||
+          (temporary_ && !isTempPageInUse(page_numbers[run_start + i]))) {
+        throw InvalidPageException(page_numbers[run_start + i], filename_);
+      }
+      if (page.header_.checksum !=
+          Page::checksum(page.header_, page.data_.data())) {
+        throw ChecksumMismatchException(page_numbers[run_start + i], filename_);
+      }
+    }
+    run_start = run_end;
+  }
+
+  return pages;
+}
+
 void File::writePage(const Page& new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
+  std::unique_lock<std::recursive_mutex> latch(io_latch_);
+  if (temporary_) {
+    if (!isTempPageInUse(new_page.page_number())) {
+      throw InvalidPageException(new_page.page_number(), filename_);
+    }
+  } else if (isReserved(new_page.page_number())) {
+    materializePage(new_page.page_number());
+  } else if (!isAllocated(new_page.page_number())) {
     // Page has been deleted since it was read.
     throw InvalidPageException(new_page.page_number(), filename_);
   }
-  // Page on disk may have had its next page pointer updated since it was read;
-  // we don't modify that, but we do keep all the other modifications to the
-  // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
-  writePage(new_page.page_number(), header, new_page);
+  writePage(new_page.page_number(), new_page);
+  syncIfDue(latch);
+}
+
+void File::writePages(const std::vector<const Page*>& pages) {
+  std::unique_lock<std::recursive_mutex> latch(io_latch_);
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    const PageId page_number = pages[i]->page_number();
+    if (temporary_) {
+      if (!isTempPageInUse(page_number)) {
+        throw InvalidPageException(page_number, filename_);
+      }
+    } else if (isReserved(page_number)) {
+      materializePage(page_number);
+    } else if (!isAllocated(page_number)) {
+      throw InvalidPageException(page_number, filename_);
+    }
+  }
+
+  if (cached_header_->codec != NULL) {
+    std::set<std::size_t> moved;
+    for (std::size_t i = 0; i < pages.size(); ++i) {
+      const PageId page_number = pages[i]->page_number();
+      if (writeCompressedPage(page_number, pages[i]->header_,
+                              pages[i]->data_.data())) {
+        moved.insert((page_number - 1) / PAGES_PER_DIRECTORY);
+      }
+    }
+    for (std::set<std::size_t>::const_iterator index = moved.begin();
+         index != moved.end(); ++index) {
+      writeDirectory(*index);
+    }
+    syncIfDue(latch);
+    return;
+  }
+
+  std::vector<char> buffer;
+
+  std::size_t run_start = 0;
+  while (run_start < pages.size()) {
+    std::size_t run_end = run_start + 1;
+    while (run_end < pages.size() &&
+           pages[run_end]->page_number() ==
+               pages[run_end - 1]->page_number() + 1 &&
+           (pages[run_end]->page_number() - 1) % PAGES_PER_MAP != 0) {
+      ++run_end;
+    }
+
+    buffer.resize((run_end - run_start) * Page::SIZE);
+    for (std::size_t i = run_start; i < run_end; ++i) {
+      char* raw = &buffer[(i - run_start) * Page::SIZE];
+      const PageHeader header =
+          sealHeader(pages[i]->header_, pages[i]->data_.data());
+      std::memcpy(raw, &header, sizeof(header));
+      std::memcpy(raw + sizeof(pages[i]->header_), pages[i]->data_.data(),
+                  Page::DATA_SIZE);
+    }
+
+    fd_->write(&buffer[0], buffer.size(),
+               pagePosition(pages[run_start]->page_number()));
+    countWrite();
+    run_start = run_end;
+  }
+  syncIfDue(latch);
+}
+
+bool File::readPageAsync(PageIoQueue& queue, const PageId page_number,
+                         Page& page, void* tag) const {
+  if (fd_->isDirect() || cached_header_->codec != NULL) {
+    // The queue's requests go straight to the device, unaligned, and know
+    // nothing of slots.
+    page = readPage(page_number);
+    return false;
+  }
+  std::unique_lock<std::recursive_mutex> latch(io_latch_, std::defer_lock);
+  if (temporary_) {
+    latch.lock();
+    if (!isTempPageInUse(page_number)) {
+      throw InvalidPageException(page_number, filename_);
+    }
+  } else if (page_number == Page::INVALID_NUMBER ||
+             page_number >= numPages()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  queue.queueRead(*fd_, pagePosition(page_number), &page.header_,
+                  &page.data_[0], &page, page_number, tag);
+  return true;
+}
+
+void File::writePageAsync(PageIoQueue& queue, const Page& new_page) {
+  LatchGuard latch(io_latch_);
+  if (fd_->isDirect() || cached_header_->codec != NULL ||
+      cached_header_->durability == STRICT_SYNC) {
+    // Strict files sync before returning, so the write can't wait in a queue.
+    writePage(new_page);
+    return;
+  }
+  if (temporary_) {
+    if (!isTempPageInUse(new_page.page_number())) {
+      throw InvalidPageException(new_page.page_number(), filename_);
+    }
+  } else if (isReserved(new_page.page_number())) {
+    materializePage(new_page.page_number());
+  } else if (!isAllocated(new_page.page_number())) {
+    throw InvalidPageException(new_page.page_number(), filename_);
+  }
+  queue.queueWrite(*fd_, pagePosition(new_page.page_number()),
+                   sealHeader(new_page.header_, new_page.data_.data()),
+                   new_page.data_.data());
+  countWrite();
 }
 
 void File::deletePage(const PageId page_number) {
+  std::unique_lock<std::recursive_mutex> latch(io_latch_);
+  if (temporary_) {
+    if (!isTempPageInUse(page_number)) {
+      throw InvalidPageException(page_number, filename_);
+    }
+    temp_pages_[filename_].free_pages.insert(page_number);
+    return;
+  }
+  FileHeader header = readHeader();
+  if (isReserved(page_number)) {
+    // Never reached the disk; the number goes back to the next reservation
+    // if nothing after it was written.
+    reserved_pages_[filename_].erase(page_number);
+    if (page_number >= header.num_pages) {
+      return;
+    }
+  } else {
+    if (!isAllocated(page_number)) {
+      throw InvalidPageException(page_number, filename_);
+    }
+    setAllocated(page_number, 1, false);
+    if (cached_header_->codec != NULL) {
+      DirectoryEntry& slot = cached_header_->slots[page_number];
+      ++cached_header_->slot_versions[page_number];
+      fd_->punchHole(slot.offset, slot.capacity);
+      cached_header_->slot_owners.erase(slot.offset);
+      releaseSpace(slot.offset, slot.capacity);
+      slot.offset = 0;
+      slot.capacity = 0;
+      writeDirectory((page_number - 1) / PAGES_PER_DIRECTORY);
+    } else if (!fd_->punchHole(pagePosition(page_number), Page::SIZE)) {
+      // The hole reads as zeros, so readers that check the page itself
+      // rather than the bitmap see the page as free.  Without holes, clear
+      // the page header on disk instead.
+      Page empty_page;
+      fd_->write(&empty_page.header_, sizeof(empty_page.header_),
+                 pagePosition(page_number));
+      countWrite();
+    }
+  }
+  cached_header_->free_pages.insert(page_number);
+  ++header.num_free_pages;
+  writeHeader(header);
+  syncIfDue(latch);
+}
+
+off_t File::compact() {
+  std::unique_lock<std::recursive_mutex> latch(io_latch_);
+  if (temporary_) {
+    return 0;
+  }
+  CachedHeader& cached = *cached_header_;
+  const off_t before = fd_->allocatedSize();
+
+  // Reserved pages are not free, so they stop the cut and keep their numbers.
   FileHeader header = readHeader();
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
-    header.first_used_page = existing_page.next_page_number();
+  std::set<PageId>& free_pages = cached.free_pages;
+  while (!free_pages.empty() && *free_pages.rbegin() == header.num_pages - 1) {
+    free_pages.erase(--free_pages.end());
+    --header.num_pages;
+    --header.num_free_pages;
+  }
+  if (header.num_pages != cached.header.num_pages) {
+    writeHeader(header);
+  }
+
+  off_t end;
+  if (cached.codec != NULL) {
+    cached.slots.resize(std::max<PageId>(header.num_pages, 1));
+    cached.slot_versions.resize(cached.slots.size());
+    for (std::map<off_t, off_t>::const_iterator piece =
+             cached.free_space.begin();
+         piece != cached.free_space.end(); ++piece) {
+      fd_->punchHole(piece->first, piece->second);
+    }
+    end = cached.data_end;
   } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
+    // Free pages deleted before holes could be punched, or skipped over by
+    // a reservation, still hold space.  Punch them in runs, each of which
+    // stops at a bitmap page.
+    std::set<PageId>::const_iterator page = free_pages.begin();
+    while (page != free_pages.end()) {
+      const PageId first = *page;
+      PageId count = 1;
+      while (++page != free_pages.end() && *page == first + count &&
+             (*page - 1) % PAGES_PER_MAP != 0) {
+        ++count;
+      }
+      fd_->punchHole(pagePosition(first), count * Page::SIZE);
+    }
+    end = header.num_pages > 1 ? pagePosition(header.num_pages - 1) + Page::SIZE
+                               : sizeof(FileHeader);
+    cached.preallocated_end = std::max<PageId>(header.num_pages, 1);
+  }
+  // Also drops space preallocated past the last page.
+  fd_->truncate(end);
+  countWrite();
+  syncIfDue(latch);
+
+  const off_t after = fd_->allocatedSize();
+  return before > after ? before - after : 0;
+}
+
+off_t File::reorganize(const off_t max_bytes_per_second) {
+  if (temporary_ || cached_header_->codec == NULL) {
+    // Pages of other files are stored in page order already.
+    return 0;
+  }
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  off_t moved = 0;
+  off_t target = sizeof(FileHeader) + Page::SIZE;
+  // Slots in page order, each directory page right before the slots it
+  // maps.  Each step takes the latch on its own, so the file stays in use; a
+  // page written meanwhile may move out of place again.
+  std::size_t directory = 1;
+  PageId page_number = 1;
+  for (;;) {
+    {
+      std::unique_lock<std::recursive_mutex> latch(io_latch_);
+      CachedHeader& cached = *cached_header_;
+      while (page_number < cached.slots.size() &&
+             cached.slots[page_number].capacity == 0) {
+        ++page_number;
+      }
+      const bool has_page = page_number < cached.slots.size();
+      const bool is_directory =
+          directory < cached.directories.size() &&
+          (!has_page || directory <= (page_number - 1) / PAGES_PER_DIRECTORY);
+      if (!is_directory && !has_page) {
         break;
       }
+      const off_t length = is_directory
+          ? static_cast<off_t>(Page::SIZE)
+          : static_cast<off_t>(cached.slots[page_number].capacity);
+      const off_t position = is_directory ? cached.directories[directory]
+                                          : cached.slots[page_number].offset;
+      if (position != target) {
+        // Whatever is in the way, the item itself included, goes to the end
+        // of the file first.
+        moved += clearSpace(target, length);
+        moved += is_directory
+            ? relocate(Page::INVALID_NUMBER, directory, target)
+            : relocate(page_number, 0, target);
+        syncIfDue(latch);
+      }
+      target += length;
+      if (is_directory) {
+        ++directory;
+      } else {
+        ++page_number;
+      }
+    }
+    if (max_bytes_per_second > 0) {
+      std::this_thread::sleep_until(
+          start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>(
+                          static_cast<double>(moved) / max_bytes_per_second)));
     }
   }
-  // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
-  existing_page.set_next_page_number(header.first_free_page);
-  header.first_free_page = page_number;
-  ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page);
+
+  std::unique_lock<std::recursive_mutex> latch(io_latch_);
+  // Items moved to the end on the way have all come back.
+  fd_->truncate(cached_header_->data_end);
+  countWrite();
+  syncIfDue(latch);
+  return moved;
+}
+
+ScanLocality File::scanLocality() const {
+  LatchGuard latch(io_latch_);
+  const CachedHeader& cached = *cached_header_;
+  ScanLocality locality = {0, 0, 0, 0, 0};
+  const std::set<off_t> directories(cached.directories.begin(),
+                                    cached.directories.end());
+  off_t start = 0;
+  off_t end = 0;
+  off_t previous_end = 0;
+  for (PageId page_number = nextUsedPage(Page::INVALID_NUMBER);
+       page_number != Page::INVALID_NUMBER;
+       page_number = nextUsedPage(page_number)) {
+    off_t position = pagePosition(page_number);
+    off_t length = Page::SIZE;
+    if (cached.codec != NULL) {
+      position = cached.slots[page_number].offset;
+      length = cached.slots[page_number].capacity;
+    }
+    // Bitmap and directory pages in between are not read, but kept in place.
+    while (locality.pages > 0 &&
+           (cached.codec != NULL
+                ? directories.count(previous_end) > 0
+                : previous_end == mapPosition(
+                      (previous_end - FileHeader::BITMAP_HEADER_SIZE) /
+                      ((PAGES_PER_MAP + 1) * Page::SIZE)))) {
+      previous_end += Page::SIZE;
+    }
+    if (locality.pages == 0) {
+      start = position;
+      end = position + length;
+      ++locality.sequential;
+    } else if (position == previous_end) {
+      ++locality.sequential;
+    } else if (position < previous_end) {
+      ++locality.backward;
+    }
+    start = std::min(start, position);
+    end = std::max(end, position + length);
+    previous_end = position + length;
+    ++locality.pages;
+    locality.bytes += length;
   }
-  writePage(page_number, existing_page);
-  writeHeader(header);
+  locality.span = end - start;
+  return locality;
+}
+
+void File::setExtentSize(const PageId num_pages) {
+  LatchGuard latch(io_latch_);
+  cached_header_->extent_size = num_pages;
+}
+
+PageId File::extentSize() const {
+  LatchGuard latch(io_latch_);
+  return cached_header_->extent_size;
+}
+
+void File::setDurability(const Durability durability) {
+  LatchGuard latch(io_latch_);
+  cached_header_->durability = durability;
+}
+
+File::Durability File::durability() const {
+  LatchGuard latch(io_latch_);
+  return cached_header_->durability;
+}
+
+void File::sync() const {
+  std::unique_lock<std::recursive_mutex> latch(io_latch_);
+  syncReleasing(latch);
+}
+
+std::uint64_t File::syncCount() const {
+  LatchGuard latch(io_latch_);
+  return cached_header_->syncs;
+}
+
+void File::countWrite() const {
+  ++cached_header_->writes;
+}
+
+void File::syncIfDue(std::unique_lock<std::recursive_mutex>& latch) {
+  const CachedHeader& cached = *cached_header_;
+  const std::uint64_t unsynced = cached.writes - cached.synced_writes;
+  if (cached.durability == NO_SYNC || unsynced == 0) {
+    return;
+  }
+  if (cached.durability == STRICT_SYNC ||
+      unsynced >= static_cast<std::uint64_t>(SYNC_BATCH_WRITES) ||
+      std::chrono::steady_clock::now() - cached.last_sync >=
+          SYNC_BATCH_INTERVAL) {
+    syncReleasing(latch);
+  }
+}
+
+void File::syncReleasing(std::unique_lock<std::recursive_mutex>& latch) const {
+  CachedHeader& cached = *cached_header_;
+  if (cached.durability == NO_SYNC || cached.writes == cached.synced_writes) {
+    return;
+  }
+  // Writes counted while the sync runs are left for the next one.
+  const std::uint64_t writes = cached.writes;
+  const std::shared_ptr<FileDescriptor> fd = fd_;
+  latch.unlock();
+  fd->sync();
+  latch.lock();
+  cached.synced_writes = std::max(cached.synced_writes, writes);
+  cached.last_sync = std::chrono::steady_clock::now();
+  ++cached.syncs;
 }
 
 FileIterator File::begin() {
-  const FileHeader& header = readHeader();
-  return FileIterator(this, header.first_used_page);
+  return FileIterator(this, nextUsedPage(Page::INVALID_NUMBER));
 }
 
 FileIterator File::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
-  openIfNeeded(create_new);
+File::File(const std::string& name, const bool create_new,
+           const bool temporary, const bool direct, const PageCodec* codec)
+    : filename_(name), temporary_(false) {
+  openIfNeeded(create_new, direct);
 
+  if (temporary) {
+    LatchGuard latch(io_latch_);
+    TempPages temp;
+    temp.next_page = 1;
+    temp_pages_[filename_] = temp;
+    temporary_ = true;
+    cached_header_->durability = NO_SYNC;
+  }
   if (create_new) {
     // File starts with 1 page (the header).
-    FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+    FileHeader header = {FileHeader::BITMAP_FORMAT, 1 /* num_pages */,
+                         0 /* num_free_pages */};
+    if (codec != NULL) {
+      LatchGuard latch(io_latch_);
+      header.format = FileHeader::COMPRESSED_FORMAT | codec->id();
+      cached_header_->codec = codec;
+      cached_header_->directories.push_back(sizeof(FileHeader));
+      cached_header_->data_end = sizeof(FileHeader) + Page::SIZE;
+      writeDirectory(0);
+    }
     writeHeader(header);
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
+void File::openIfNeeded(const bool create_new, const bool direct) {
+  LatchGuard latch(io_latch_);
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+    fd_ = open_fds_[filename_];
+    cached_header_ = open_headers_[filename_];
+    id_ = open_ids_[filename_];
+    temporary_ = temp_pages_.find(filename_) != temp_pages_.end();
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
       if (already_exists) {
         throw FileExistsException(filename_);
       }
-      // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
+    fd_.reset(new FileDescriptor(filename_, create_new, direct));
+    // The only read of the header and bitmaps from disk while the file is
+    // open; a new file reads as zeros until the constructor writes its header.
+    cached_header_ = std::make_shared<CachedHeader>();
+    fd_->read(&cached_header_->header, sizeof(FileHeader), 0 /* pos */);
+    const std::uint32_t format = cached_header_->header.format;
+    cached_header_->codec = NULL;
+    cached_header_->data_end = 0;
+    if (isCompressedFormat(format)) {
+      cached_header_->codec = PageCodec::find(format & PageCodec::MAX_ID);
+    }
+    if (!create_new && format != FileHeader::BITMAP_FORMAT &&
+        cached_header_->codec == NULL) {
+      fd_.reset();
+      cached_header_.reset();
+      throw FileFormatException(filename_);
+    }
+    loadBitmap();
+    cached_header_->num_pages = cached_header_->header.num_pages;
+    cached_header_->extent_size = DEFAULT_EXTENT_SIZE;
+    cached_header_->preallocated_end =
+        std::max<PageId>(cached_header_->header.num_pages, 1);
+    cached_header_->durability = BATCHED_SYNC;
+    cached_header_->writes = 0;
+    cached_header_->synced_writes = 0;
+    cached_header_->syncs = 0;
+    cached_header_->last_sync = std::chrono::steady_clock::now();
+    open_fds_[filename_] = fd_;
+    open_headers_[filename_] = cached_header_;
     open_counts_[filename_] = 1;
+    id_ = next_id_++;
+    open_ids_[filename_] = id_;
   }
 }
 
 void File::close() {
+  LatchGuard latch(io_latch_);
   --open_counts_[filename_];
-  stream_.reset();
+  fd_.reset();
+  cached_header_.reset();
   if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
+    open_fds_.erase(filename_);
+    open_headers_.erase(filename_);
     open_counts_.erase(filename_);
+    open_ids_.erase(filename_);
+    reserved_pages_.erase(filename_);
+    if (temp_pages_.erase(filename_) > 0) {
+      std::remove(filename_.c_str());
+    }
   }
 }
 
@@ -273,33 +1355,33 @@ void File::writePage(const PageId page_number, const Page& new_page) {
 
 void File::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
-                 Page::DATA_SIZE);
-  stream_->flush();
+  if (cached_header_->codec != NULL) {
+    LatchGuard latch(io_latch_);
+    if (writeCompressedPage(page_number, header, new_page.data_.data())) {
+      writeDirectory((page_number - 1) / PAGES_PER_DIRECTORY);
+    }
+    return;
+  }
+  PageHeader sealed = sealHeader(header, new_page.data_.data());
+  struct iovec parts[2] = {
+    {&sealed, sizeof(sealed)},
+    {const_cast<char*>(new_page.data_.data()), Page::DATA_SIZE}
+  };
+  fd_->writev(parts, 2, pagePosition(page_number));
+  countWrite();
 }
 
 FileHeader File::readHeader() const {
-  FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
-
-  return header;
+  LatchGuard latch(io_latch_);
+  return cached_header_->header;
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->flush();
-}
-
-PageHeader File::readPageHeader(PageId page_number) const {
-  PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
-
-  return header;
+  LatchGuard latch(io_latch_);
+  fd_->write(&header, sizeof(header), 0 /* pos */);
+  countWrite();
+  cached_header_->header = header;
+  cached_header_->num_pages.store(header.num_pages, std::memory_order_release);
 }
 
 }
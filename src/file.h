@@ -7,12 +7,19 @@
 
 #pragma once
 
-#include <fstream>
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
 
+#include "file_descriptor.h"
 #include "page.h"
+#include "page_codec.h"
+#include "page_io.h"
 
 namespace badgerdb {
 
@@ -23,24 +30,51 @@ class FileIterator;
  */
 struct FileHeader {
   /**
-   * Number of pages allocated in the file.
+   * Value of format in files laid out with allocation bitmaps.  Files from
+   * before, which linked their pages into used and free lists, start with
+   * num_pages instead; see File::convert().
    */
-  PageId num_pages;
+  static const std::uint32_t BITMAP_FORMAT = 0x42444234;
 
   /**
-   * Page number of the first used page in the file.
+   * Value of format in bitmap files from before page checksums, whose pages
+   * carry no checksum and follow right after the header; see File::convert().
    */
-  PageId first_used_page;
+  static const std::uint32_t UNCHECKED_BITMAP_FORMAT = 0x42444232;
 
   /**
-   * Number of free pages (allocated but unused) in the file.
+   * Value of format in bitmap files from before BITMAP_HEADER_SIZE, whose
+   * pages follow right after the header; see File::convert().
    */
-  PageId num_free_pages;
+  static const std::uint32_t UNALIGNED_BITMAP_FORMAT = 0x42444233;
+
+  /**
+   * Space the header takes at the start of files laid out with allocation
+   * bitmaps.  Pages and bitmap pages start on Page::SIZE boundaries, so they
+   * line up with filesystem blocks for direct I/O and hole punching.
+   */
+  static const std::size_t BITMAP_HEADER_SIZE = Page::SIZE;
+
+  /**
+   * Value of format in compressed files, with the identifier of their
+   * PageCodec in the low byte.
+   */
+  static const std::uint32_t COMPRESSED_FORMAT = 0x42444300;
 
   /**
-   * Page number of the first free (allocated but unused) page in the file.
+   * Marks the layout of the file, see BITMAP_FORMAT and COMPRESSED_FORMAT.
    */
-  PageId first_free_page;
+  std::uint32_t format;
+
+  /**
+   * Number of pages allocated in the file.
+   */
+  PageId num_pages;
+
+  /**
+   * Number of free pages (allocated but unused) in the file.
+   */
+  PageId num_free_pages;
 
   /**
    * Returns true if this file header is equal to the other.
@@ -49,48 +83,185 @@ struct FileHeader {
    * @return  True if the other header is equal to this one.
    */
   bool operator==(const FileHeader& rhs) const {
-    return num_pages == rhs.num_pages &&
-        num_free_pages == rhs.num_free_pages &&
-        first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+    return format == rhs.format &&
+        num_pages == rhs.num_pages &&
+        num_free_pages == rhs.num_free_pages;
   }
 };
 
+/**
+ * @brief Where on disk a scan of a file (see File::begin()) finds its pages,
+ *        see File::scanLocality().
+ */
+struct ScanLocality {
+  /**
+   * Number of pages in use, which a scan reads.
+   */
+  PageId pages;
+
+  /**
+   * Pages stored right where the page before them in scan order ends, or
+   * after bitmap or directory pages that follow it, or first in scan order.
+   * Equals pages if a scan is one sequential sweep.
+   */
+  PageId sequential;
+
+  /**
+   * Pages stored before the page before them in scan order, each a backward
+   * seek for a scan.
+   */
+  PageId backward;
+
+  /**
+   * Number of bytes a scan reads.
+   */
+  off_t bytes;
+
+  /**
+   * Number of bytes from the start of the first page read to the end of the
+   * last, counting gaps and bitmap or directory pages in between.
+   */
+  off_t span;
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps a file descriptor to an underlying file on disk.  Files
+ * contain fixed-sized pages.  Deleted pages keep their numbers, which are
+ * reused, but give their disk space back (see deletePage() and compact()).
+ * If multiple File objects refer to the same
+ * underlying file, they will share the descriptor in memory.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking in the open_fds_ map) and just returns a file object with
+ * the already opened descriptor for the file without actually opening the UNIX file again. 
+ *
+ * Pages are read and written with positional I/O (see FileDescriptor), one
+ * system call per page or run of pages, so plain page reads and writes from
+ * several threads proceed in parallel.  Operations that update the file
+ * header, the bitmaps or the maps below are serialized by one process-wide
+ * latch.
+ *
+ * The file header is read from disk once, when the file is opened, and then
+ * kept in memory, shared by all File objects for the file.  Changes are
+ * written through to disk right away, so the header on disk is always
+ * current.
  *
- * @warning This class is not threadsafe.
+ * Which pages are in use is recorded in bitmap pages, one bit per page.  The
+ * bitmap for a group of PAGES_PER_MAP pages sits on disk right before the
+ * group; bitmap pages have no page number, so page numbers stay dense.  The
+ * bitmaps are kept in memory as well, next to the header, so allocating or
+ * deleting a page writes one bitmap page and the header, and writing a page
+ * never reads anything first.
+ *
+ * Compressed files (see createCompressed()) store each page compressed, in a
+ * slot of its own size, instead of in a fixed place.  A chain of directory
+ * pages, starting right after the file header, maps page numbers to slots;
+ * a page is in use exactly when it has a slot, so these files have no bitmap
+ * pages.  The directory is kept in memory too.  Rewriting a page puts it back
+ * in its slot if it still fits; otherwise the page moves to free space, or to
+ * the end of the file, and its directory page is rewritten.
  */
 class File {
  public:
+  /**
+   * Number of pages whose allocation one bitmap page records.
+   */
+  static const PageId PAGES_PER_MAP = Page::SIZE * 8;
+
+  /**
+   * How soon writes to a file reach stable storage, see setDurability().
+   */
+  enum Durability {
+    /** Never synced; left to the kernel.  Used for temporary files */
+    NO_SYNC,
+    /** Synced after every SYNC_BATCH_WRITES writes or SYNC_BATCH_INTERVAL,
+     *  whichever comes first, and on sync() */
+    BATCHED_SYNC,
+    /** Synced at the end of every call that writes */
+    STRICT_SYNC
+  };
+
+  /**
+   * Number of writes after which a BATCHED_SYNC file is synced.
+   */
+  static const int SYNC_BATCH_WRITES = 256;
+
+  /**
+   * Time since the last sync after which the next write to a BATCHED_SYNC
+   * file syncs it.
+   */
+  static const std::chrono::milliseconds SYNC_BATCH_INTERVAL;
+
+  /**
+   * Number of pages by which files grow on disk unless setExtentSize() says
+   * otherwise.
+   */
+  static const PageId DEFAULT_EXTENT_SIZE = 64;
+
+  /**
+   * Granularity of the slots of compressed files, in bytes.  Slots are
+   * rounded up to it so a page that grows a little still fits.
+   */
+  static const std::size_t SLOT_ALIGNMENT = 256;
+
   /**
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param direct    True to bypass the kernel page cache, see isDirect().
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static File create(const std::string& filename);
+  static File create(const std::string& filename, const bool direct = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
+	 * It first checks if the file is already open. If so, then the new File object created uses the same file descriptor to read to or write fom
 	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the descriptor associated with this File object are inserted into the
+	 * open_fds_ map.
+   *
+   * The direct flag only counts if the file is not open yet; otherwise the
+   * descriptor is shared, and so is its mode.
    *
    * @param filename  Name of the file.
+   * @param direct    True to bypass the kernel page cache, see isDirect().
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileFormatException     If the file needs convert() first.
    */
-  static File open(const std::string& filename);
+  static File open(const std::string& filename, const bool direct = false);
+
+  /**
+   * Creates a temporary file for data that only lives as long as a query, such
+   * as sort runs and hash join partitions.  Page numbers are managed in memory
+   * only: allocating or deleting a page never touches the disk, and deleted
+   * page numbers are handed out again right away, lowest first.  Pages reach
+   * the disk only when written, and writes skip the header and list upkeep.
+   * Temporary files can not be iterated, and they are removed from disk once
+   * the last File object for them is closed.  Use BufMgr::discardFile() to drop their pages
+   * from the buffer pool without writing them.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileExistsException     If the requested file already exists.
+   */
+  static File createTemp(const std::string& filename);
+
+  /**
+   * Creates a new compressed file, whose pages are passed through <codec> on
+   * the way to and from disk.  Compressed files take less space and fewer
+   * bytes to read, at the cost of the codec's time.  Pages are read and
+   * written one at a time, under the latch, and the file can not be mapped
+   * with MappedFile.  The codec is registered with PageCodec::registerCodec(),
+   * and must be registered again before the file is opened in a later run.
+   *
+   * @param filename  Name of the file.
+   * @param codec     Codec to compress pages with.
+   * @throws  FileExistsException     If the requested file already exists.
+   */
+  static File createCompressed(
+      const std::string& filename,
+      const PageCodec& codec = PageCodec::defaultCodec());
 
   /**
    * Deletes an existing file.
@@ -101,6 +272,22 @@ class File {
    */
   static void remove(const std::string& filename);
 
+  /**
+   * Converts a file written before allocation bitmaps, whose pages are linked
+   * into used and free lists, or before page checksums or aligned pages, to
+   * the current layout.
+   * Page numbers and page contents are kept, and used pages get their
+   * checksums.  The converted file is written next to the old one and then
+   * renamed over it, so a crash leaves one or the other intact.
+   *
+   * @param filename  Name of the file.
+   * @return  True if the file was converted, false if it already had the
+   *          current layout or is compressed.
+   * @throws  FileNotFoundException   If the file doesn't exist.
+   * @throws  FileOpenException       If the file is currently open.
+   */
+  static bool convert(const std::string& filename);
+
   /**
    * Returns true if the file exists and is open.
    *
@@ -145,6 +332,39 @@ class File {
    */
   Page allocatePage();
 
+  /**
+   * Allocates a run of new pages with consecutive numbers at the end of the
+   * file, for bulk loads and sort runs.  The bitmap and the file header are
+   * written once for the whole run, and the empty pages with as few requests
+   * as possible.  Free pages are left alone, since they rarely form a run.
+   *
+   * @param num_pages   Number of pages to allocate.
+   * @return  The new pages, in page order.
+   */
+  std::vector<Page> allocatePages(const PageId num_pages);
+
+  /**
+   * Reserves a new page in the file without writing anything to disk.  The
+   * page number is taken from the end of the file and only held in memory; the
+   * first writePage() or writePages() of the page links it into the file and
+   * writes its contents in one go.  Until then the page can not be read back
+   * from the file, and deleting it just drops the reservation.  Reservations
+   * not written by the time the file is closed are lost.
+   *
+   * If the file has free pages one of them is allocated with allocatePage()
+   * instead, since taking it off the free list has to touch the disk anyway.
+   *
+   * @return The new page.
+   */
+  Page reservePage();
+
+  /**
+   * Returns true if the page is reserved by reservePage() and not written yet.
+   *
+   * @param page_number   Number of page.
+   */
+  bool isReserved(const PageId page_number) const;
+
   /**
    * Reads an existing page from the file.
    *
@@ -152,12 +372,27 @@ class File {
    * @return  The page.
    * @throws  InvalidPageException  If the page doesn't exist in the file or is
    *                                not currently used.
+   * @throws  ChecksumMismatchException  If the page read is damaged.
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads a batch of existing pages from the file.  Runs of consecutive page
+   * numbers are read with a single request, so callers should pass the numbers
+   * sorted.
+   *
+   * @param page_numbers  Numbers of pages to read.
+   * @return  The pages, in the same order as page_numbers.
+   * @throws  InvalidPageException  If any page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  ChecksumMismatchException  If any page read is damaged.
+   */
+  std::vector<Page> readPages(const std::vector<PageId>& page_numbers) const;
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
-   * must have been already allocated in this file by a call to allocatePage().
+   * must have been already allocated in this file by a call to allocatePage()
+   * or reservePage().
    *
    * @see allocatePage()
    * @param new_page  Page to write.
@@ -165,12 +400,91 @@ class File {
   void writePage(const Page& new_page);
 
   /**
-   * Deletes a page from the file.
+   * Writes a batch of pages into the file, like writePage() for each of them.
+   * Runs of consecutive page numbers are written with a single request, up to
+   * the end of the bitmap group they are in.
+   *
+   * @param pages   Pages to write.
+   * @throws  InvalidPageException  If any page has been deleted from the file.
+   */
+  void writePages(const std::vector<const Page*>& pages);
+
+  /**
+   * Queues a read of an existing page into <page>, like readPage().  The page
+   * must not be used until queue.submitAndWait() returns, which throws
+   * InvalidPageException if the page turned out not to be in use and
+   * ChecksumMismatchException if it is damaged.  A read with a tag is
+   * reported by queue.poll() instead.
+   *
+   * @param queue         Queue to read through.
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @param tag           Tag for queue.poll(), or NULL.
+   * @return  False if the page was read right away instead, as it is on
+   *          direct and compressed files; nothing is queued then.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  bool readPageAsync(PageIoQueue& queue, const PageId page_number,
+                     Page& page, void* tag = NULL) const;
+
+  /**
+   * Queues a write of a page, like writePage().  The page must stay unchanged
+   * until queue.submitAndWait() returns.  A reserved page is marked in use
+   * right away, before the write is submitted.
+   *
+   * @param queue     Queue to write through.
+   * @param new_page  Page to write.
+   * @throws  InvalidPageException  If the page has been deleted from the file.
+   */
+  void writePageAsync(PageIoQueue& queue, const Page& new_page);
+
+  /**
+   * Deletes a page from the file.  Deleted pages are handed out again by
+   * allocatePage(), lowest first.  The disk space of the page is given back
+   * with a hole punched where the page was, on filesystems that support it.
+   * Pages start on filesystem blocks (see FileHeader::BITMAP_HEADER_SIZE), so
+   * a lone page frees all of its space.
    *
    * @param page_number   Number of page to delete.
+   * @throws  InvalidPageException  If the page is not currently used.
    */
   void deletePage(const PageId page_number);
 
+  /**
+   * Gives disk space the file does not need back to the filesystem.  Free
+   * pages at the end of the file are cut off, along with space preallocated
+   * past them, and holes are punched where other free pages are (or, in
+   * compressed files, in the free space between slots).  Used pages keep
+   * their numbers.  Does nothing for temporary files.
+   *
+   * @return  Number of bytes of disk space reclaimed.
+   * @throws  IoErrorException  If the file can not be cut or examined.
+   */
+  off_t compact();
+
+  /**
+   * Moves the slots of a compressed file into page order, back to back with
+   * each directory page right before the slots it maps, so a scan reads the
+   * file front to back in one sweep.  Slots fall out of order as pages grow and move, or are deleted
+   * and allocated again.  Page numbers are kept.  The file stays in use while
+   * it is reorganized: each slot is moved under the latch on its own, and
+   * slots in the way are first moved to the end of the file, which is cut
+   * back when done.  Pages of other files are always stored in page order,
+   * so for them this does nothing; compact() gives back their free space.
+   *
+   * @param max_bytes_per_second  Bound on the bytes moved per second, each
+   *                              read once and written once; zero for none.
+   * @return  Number of bytes moved.
+   * @throws  IoErrorException  If the file can not be cut.
+   */
+  off_t reorganize(const off_t max_bytes_per_second = 0);
+
+  /**
+   * Returns where on disk a scan of the file finds its pages, from memory.
+   * Taken before and after reorganize() it shows what was gained.
+   */
+  ScanLocality scanLocality() const;
+
   /**
    * Returns the name of the file this object represents.
    *
@@ -178,6 +492,97 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns the identifier of the underlying file.  All File objects sharing a
+   * descriptor share the identifier; a file closed and opened again gets a new one.
+   *
+   * @return Identifier of file.
+   */
+  FileId id() const { return id_; }
+
+  /**
+   * Sets the number of pages by which the file grows on disk.  Whenever
+   * allocation passes the end of the space preallocated so far, the space for
+   * the next extent is preallocated in one go with fallocate(), which keeps
+   * the file in few pieces on disk.  Zero turns preallocation off, so the file
+   * grows as pages are written.  The setting is shared by all File objects for the
+   * file and lasts until it is closed.  Compressed files are not preallocated.
+   *
+   * @param num_pages   Number of pages per extent.
+   */
+  void setExtentSize(const PageId num_pages);
+
+  /**
+   * Returns the number of pages by which the file grows on disk.
+   */
+  PageId extentSize() const;
+
+  /**
+   * Sets how soon writes to the file reach stable storage.  Files start out
+   * BATCHED_SYNC, temporary files NO_SYNC.  Writes counted are page writes,
+   * bitmap and header writes; a batch of pages written as one run counts once.
+   * Batched files are only synced when written to, so callers that need a
+   * point of durability call sync().  The setting is shared by all File
+   * objects for the file and lasts until it is closed.
+   *
+   * On STRICT_SYNC files writePageAsync() writes right away.
+   *
+   * @param durability  Durability level.
+   */
+  void setDurability(const Durability durability);
+
+  /**
+   * Returns how soon writes to the file reach stable storage.
+   */
+  Durability durability() const;
+
+  /**
+   * Syncs all writes to the file so far to stable storage, unless the file is
+   * NO_SYNC.  Writes queued with writePageAsync() count once submitted and
+   * waited for.  Does nothing if nothing was written since the last sync.
+   *
+   * @throws  IoErrorException  If the data can not be synced.
+   */
+  void sync() const;
+
+  /**
+   * Returns the number of times the file was synced since it was opened.
+   * Shared by all File objects for the file.
+   */
+  std::uint64_t syncCount() const;
+
+  /**
+   * Returns true if the file was created with createTemp().
+   */
+  bool isTemporary() const { return temporary_; }
+
+  /**
+   * Returns true if the file does direct I/O, bypassing the kernel page cache
+   * so pages cached by a BufMgr are not cached twice.  Pages start on device
+   * blocks, but Page objects are not in aligned memory, so page transfers go
+   * through an aligned bounce buffer of the size of the page.  Falls
+   * back to buffered I/O, and returns false, on filesystems without O_DIRECT.
+   * readPageAsync() and writePageAsync() run synchronously on such files.
+   */
+  bool isDirect() const { return fd_->isDirect(); }
+
+  /**
+   * Returns the codec of a compressed file, or NULL if the file is not
+   * compressed.  readPageAsync() and writePageAsync() run synchronously on
+   * compressed files.
+   */
+  const PageCodec* codec() const { return cached_header_->codec; }
+
+  /**
+   * Returns the key of the given page of this file.
+   *
+   * @param page_number   Number of page.
+   * @return  Key of the page.
+   */
+  PageKey pageKey(const PageId page_number) const {
+    return makePageKey(id_, page_number);
+  }
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -201,8 +606,21 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  static off_t pagePosition(const PageId page_number) {
+    // One bitmap page precedes every group of PAGES_PER_MAP pages.
+    const off_t slot = (page_number - 1) + (page_number - 1) / PAGES_PER_MAP + 1;
+    return FileHeader::BITMAP_HEADER_SIZE + slot * Page::SIZE;
+  }
+
+  /**
+   * Returns the position of the bitmap page of the given group in the file.
+   *
+   * @param group   Number of group, counting from zero.
+   * @return  Position of bitmap page in file.
+   */
+  static off_t mapPosition(const PageId group) {
+    return FileHeader::BITMAP_HEADER_SIZE +
+           static_cast<off_t>(group) * (PAGES_PER_MAP + 1) * Page::SIZE;
   }
 
   /**
@@ -214,28 +632,38 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param temporary   Whether the file is temporary.
+   * @param direct      Whether to bypass the kernel page cache.
+   * @param codec       Codec to compress a new file with, or NULL.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileFormatException     If the underlying file needs convert()
+   *                                  first.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const bool temporary = false, const bool direct = false,
+       const PageCodec* codec = NULL);
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing descriptor.
    *
    * @param create_new  Whether to create a new file.
+   * @param direct      Whether a new descriptor bypasses the kernel page cache.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileFormatException     If the underlying file needs convert()
+   *                                  first.
    */
-  void openIfNeeded(const bool create_new);
+  void openIfNeeded(const bool create_new, const bool direct = false);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Closes the underlying file descriptor in <fd_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
@@ -245,14 +673,15 @@ class File {
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed; a page past the end of the file reads
+   * as zeros and is therefore not in use.
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
    * @return  The page.
    * @throws  InvalidPageException  If the page is free (unused) and
    *                                allow_free is false.
+   * @throws  ChecksumMismatchException  If the page is in use and damaged.
    */
   Page readPage(const PageId page_number, const bool allow_free) const;
 
@@ -279,51 +708,427 @@ class File {
                  const Page& new_page);
 
   /**
-   * Reads the header for this file from disk.
+   * Returns the header for this file, from memory.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Writes the given header to the disk as the header for this file, and
+   * keeps it in memory.
    *
    * @param header  File header to write.
    */
   void writeHeader(const FileHeader& header);
 
   /**
-   * Reads only the header of the given page from disk (not the record data
-   * or slot table).  No bounds checking is performed.
+   * Returns the number of pages in the file without taking the latch.
+   */
+  PageId numPages() const {
+    return cached_header_->num_pages.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Loads the bitmap pages of a newly opened file into the cached header and
+   * collects its free pages.  For compressed files the bitmap is built from
+   * the directory instead.
+   */
+  void loadBitmap();
+
+  /**
+   * Loads the directory of a newly opened compressed file into the cached
+   * header, marks the pages with slots in the bitmap and collects the free
+   * space between slots.
+   */
+  void loadDirectory();
+
+  /**
+   * Writes the directory page that records the given entry of the directory
+   * of a compressed file, adding directory pages to the chain as needed.
+   *
+   * @param index   Number of directory page, counting from zero.
+   */
+  void writeDirectory(const std::size_t index);
+
+  /**
+   * Reads a page of a compressed file into <page>.  A page without a slot
+   * reads as empty, like a page past the end of an uncompressed file.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @throws  ChecksumMismatchException  If the slot does not decompress.
+   */
+  void readCompressedPage(const PageId page_number, Page& page) const;
+
+  /**
+   * Compresses a page of a compressed file and writes it to its slot, moving
+   * it to a new slot if it no longer fits.  The directory is not written.
+   *
+   * @param page_number   Number of page whose contents to replace.
+   * @param header        Header of page to write.
+   * @param data          Data of page to write.
+   * @return  True if the page moved, so its directory page must be written.
+   */
+  bool writeCompressedPage(const PageId page_number, const PageHeader& header,
+                           const char* data);
+
+  /**
+   * Takes <length> bytes of space for a slot or directory page of a
+   * compressed file, from free space if there is a large enough piece,
+   * otherwise from the end of the file.
+   *
+   * @param length  Number of bytes needed.
+   * @return  Position of the space in the file.
+   */
+  off_t allocateSpace(const off_t length);
+
+  /**
+   * Returns space of a compressed file to free space.
+   *
+   * @param offset  Position of the space in the file.
+   * @param length  Number of bytes.
+   */
+  void releaseSpace(off_t offset, off_t length);
+
+  /**
+   * Takes a given range of free space of a compressed file, or space past
+   * its end.
+   *
+   * @param offset  Position of the space in the file.
+   * @param length  Number of bytes.
+   */
+  void takeSpace(const off_t offset, const off_t length);
+
+  /**
+   * Moves a slot or a directory page of a compressed file to a position
+   * whose space is free, and writes the directory that records it.
+   *
+   * @param page_number   Number of page whose slot to move, or
+   *                      Page::INVALID_NUMBER to move a directory page.
+   * @param directory     Number of directory page to move, counting from zero.
+   * @param to            New position.
+   * @return  Number of bytes moved.
+   */
+  off_t relocate(const PageId page_number, const std::size_t directory,
+                 const off_t to);
+
+  /**
+   * Moves every slot and directory page of a compressed file that overlaps a
+   * range to the end of the file, leaving the range free.
+   *
+   * @param offset  Position of the range in the file.
+   * @param length  Number of bytes.
+   * @return  Number of bytes moved.
+   */
+  off_t clearSpace(const off_t offset, const off_t length);
+
+  /**
+   * Returns true if the page is marked in use in the bitmap.
+   *
+   * @param page_number   Number of page.
+   */
+  bool isAllocated(const PageId page_number) const;
+
+  /**
+   * Marks a run of pages in use or free in the bitmap and writes the bitmap
+   * pages they are on, each once.  The file header is not written.
+   *
+   * @param first_page    Number of first page of the run.
+   * @param num_pages     Number of pages in the run.
+   * @param used          True to mark the pages in use.
+   */
+  void setAllocated(const PageId first_page, const PageId num_pages,
+                    const bool used);
+
+  /**
+   * Returns the number of the first used page after the given one, or
+   * Page::INVALID_NUMBER if there is none.
+   *
+   * @param page_number   Number of page to search after.
+   */
+  PageId nextUsedPage(const PageId page_number) const;
+
+  /**
+   * Grows the file in the header to take in a run of pages, preallocating the
+   * next extent on disk if needed.  Pages skipped over before the run that are
+   * not reserved become free pages.
+   *
+   * @param header        File header to update.
+   * @param page_number   Number of first page the file must take in.
+   * @param num_pages     Number of pages in the run.
+   */
+  void extendTo(FileHeader& header, const PageId page_number,
+                const PageId num_pages = 1);
+
+  /**
+   * Counts a write to the file towards the next sync.
+   */
+  void countWrite() const;
+
+  /**
+   * Syncs the file if its durability level calls for it after the writes
+   * counted so far.  Called at the end of every public call that writes.
+   *
+   * @param latch   Lock on the latch, released while the file is synced.
+   */
+  void syncIfDue(std::unique_lock<std::recursive_mutex>& latch);
+
+  /**
+   * Syncs the file as sync() does, with the latch released while the data
+   * goes to stable storage so other files are not held up.
+   *
+   * @param latch   Lock on the latch, held again on return.
+   */
+  void syncReleasing(std::unique_lock<std::recursive_mutex>& latch) const;
+
+  /**
+   * Marks a reserved page in use, updates the file header and drops the
+   * reservation.  The page itself is not written.
+   *
+   * @param page_number   Number of reserved page.
+   */
+  void materializePage(const PageId page_number);
+
+  /**
+   * Returns the number the next appended page gets: past the end of the file
+   * and past every outstanding reservation.
    *
-   * @param page_number   Number of page whose header is to be read.
-   * @return  Header of page.
+   * @param header  File header.
    */
-  PageHeader readPageHeader(const PageId page_number) const;
+  PageId nextAppendNumber(const FileHeader& header) const;
+
+  /**
+   * Hands out the lowest free page number of a temporary file.
+   *
+   * @return  Empty page with the number set.
+   */
+  Page allocateTempPage();
+
+  /**
+   * Returns true if the page of a temporary file is allocated.
+   *
+   * @param page_number   Number of page.
+   */
+  bool isTempPageInUse(const PageId page_number) const;
+
+  /**
+   * Number of pages each directory page of a compressed file maps.
+   */
+  static const PageId PAGES_PER_DIRECTORY =
+      (Page::SIZE - sizeof(std::uint64_t)) / (2 * sizeof(std::uint64_t));
+
+  /**
+   * Directory entry of a page of a compressed file, as stored on disk after
+   * the position of the next directory page.  The slot starts with the number
+   * of compressed bytes that follow, as a std::uint32_t; Page::SIZE means the
+   * page did not compress and is stored as is.
+   */
+  struct DirectoryEntry {
+    /**
+     * Position of the slot in the file.
+     */
+    std::uint64_t offset;
+
+    /**
+     * Size of the slot in bytes, a multiple of SLOT_ALIGNMENT; zero if the
+     * page is not in use.
+     */
+    std::uint64_t capacity;
+  };
+
+  /**
+   * In-memory page allocation of a temporary file.
+   */
+  struct TempPages {
+    /**
+     * Number handed out when no freed number is available.
+     */
+    PageId next_page;
+
+    /**
+     * Numbers of deleted pages, reused lowest first.
+     */
+    std::set<PageId> free_pages;
+  };
+
+  /**
+   * File header and allocation bitmaps of an open file, kept in memory.
+   */
+  struct CachedHeader {
+    /**
+     * Header as last written.  Only used under the latch.
+     */
+    FileHeader header;
+
+    /**
+     * Copy of header.num_pages for bounds checks outside the latch.
+     */
+    std::atomic<PageId> num_pages;
+
+    /**
+     * Contents of the bitmap pages, one after the other, as last written.
+     * Only used under the latch.
+     */
+    std::vector<unsigned char> bitmap;
+
+    /**
+     * Numbers of free pages, reused lowest first.  Only used under the latch.
+     */
+    std::set<PageId> free_pages;
+
+    /**
+     * Number of pages per extent, see setExtentSize().
+     */
+    PageId extent_size;
+
+    /**
+     * Number of the first page past the space preallocated on disk.
+     */
+    PageId preallocated_end;
+
+    /**
+     * Durability level, see setDurability().
+     */
+    Durability durability;
 
+    /**
+     * Number of writes counted since the file was opened.
+     */
+    std::uint64_t writes;
+
+    /**
+     * Number of writes counted when the last sync started; the writes past
+     * it are not synced yet.
+     */
+    std::uint64_t synced_writes;
+
+    /**
+     * Number of syncs since the file was opened, see syncCount().
+     */
+    std::uint64_t syncs;
+
+    /**
+     * Time of the last sync, or of opening the file.
+     */
+    std::chrono::steady_clock::time_point last_sync;
+
+    /**
+     * Codec of a compressed file, NULL for other files.
+     */
+    const PageCodec* codec;
+
+    /**
+     * Slots of the pages of a compressed file, by page number.  Only used
+     * under the latch.
+     */
+    std::vector<DirectoryEntry> slots;
+
+    /**
+     * Number of times the slot of each page of a compressed file was written,
+     * moved or released, by page number.  Pages are read outside the latch,
+     * and a changed version tells the reader it raced a writer.
+     */
+    std::vector<std::uint64_t> slot_versions;
+
+    /**
+     * Positions of the directory pages of a compressed file, in chain order.
+     */
+    std::vector<off_t> directories;
+
+    /**
+     * Free space between slots of a compressed file, by position, with the
+     * length of each piece.  Adjacent pieces are merged.
+     */
+    std::map<off_t, off_t> free_space;
+
+    /**
+     * Pages of a compressed file by the position of their slot.
+     */
+    std::map<off_t, PageId> slot_owners;
+
+    /**
+     * End of the space used by a compressed file.
+     */
+    off_t data_end;
+  };
+
+  typedef std::map<std::string,
+                   std::shared_ptr<FileDescriptor> > FdMap;
   typedef std::map<std::string,
-                   std::shared_ptr<std::fstream> > StreamMap;
+                   std::shared_ptr<CachedHeader> > HeaderMap;
   typedef std::map<std::string, int> CountMap;
+  typedef std::map<std::string, FileId> IdMap;
+  typedef std::map<std::string, std::set<PageId> > ReservationMap;
+  typedef std::map<std::string, TempPages> TempMap;
+  typedef std::lock_guard<std::recursive_mutex> LatchGuard;
 
   /**
-   * Streams for opened files.
+   * Descriptors for opened files.
    */
-  static StreamMap open_streams_;
+  static FdMap open_fds_;
 
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  /**
+   * Headers of opened files.
+   */
+  static HeaderMap open_headers_;
+
+  /**
+   * Identifiers of opened files.
+   */
+  static IdMap open_ids_;
+
+  /**
+   * Page numbers reserved by reservePage() and not yet written, per open file.
+   */
+  static ReservationMap reserved_pages_;
+
+  /**
+   * Page allocation of open temporary files.
+   */
+  static TempMap temp_pages_;
+
+  /**
+   * Identifier handed to the next file opened.  Identifiers are never reused.
+   */
+  static FileId next_id_;
+
+  /**
+   * Latch serializing multi-step file updates and updates of the maps above.  Recursive
+   * because multi-step operations such as allocatePage() hold it while calling
+   * the single-step ones.
+   */
+  static std::recursive_mutex io_latch_;
+
   /**
    * Name of the file this object represents.
    */
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Descriptor for underlying filesystem object.
+   */
+  std::shared_ptr<FileDescriptor> fd_;
+
+  /**
+   * Header of the underlying file, shared with other File objects for it.
+   */
+  std::shared_ptr<CachedHeader> cached_header_;
+
+  /**
+   * Identifier of the underlying file.
+   */
+  FileId id_;
+
+  /**
+   * True if the underlying file is temporary.
    */
-  std::shared_ptr<std::fstream> stream_;
+  bool temporary_;
 
   friend class FileIterator;
   friend class FileTest;
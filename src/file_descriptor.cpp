@@ -0,0 +1,313 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_descriptor.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "exceptions/io_error_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+// Drops the first done bytes from the buffers, for resuming a short transfer.
+void skipTransferred(std::vector<struct iovec>& buffers, std::size_t done) {
+  std::size_t skip = 0;
+  while (skip < buffers.size() && done >= buffers[skip].iov_len) {
+    done -= buffers[skip].iov_len;
+    ++skip;
+  }
+  buffers.erase(buffers.begin(), buffers.begin() + skip);
+  if (!buffers.empty()) {
+    buffers[0].iov_base = static_cast<char*>(buffers[0].iov_base) + done;
+    buffers[0].iov_len -= done;
+  }
+}
+
+std::size_t totalLength(const struct iovec* buffers, const int count) {
+  std::size_t length = 0;
+  for (int i = 0; i < count; ++i) {
+    length += buffers[i].iov_len;
+  }
+  return length;
+}
+
+bool isAligned(const struct iovec* buffers, const int count,
+               const off_t offset) {
+  const std::size_t alignment = FileDescriptor::DIRECT_ALIGNMENT;
+  if (offset % alignment != 0) {
+    return false;
+  }
+  for (int i = 0; i < count; ++i) {
+    if (reinterpret_cast<std::size_t>(buffers[i].iov_base) % alignment != 0 ||
+        buffers[i].iov_len % alignment != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Block-aligned span of the file covering a request, with memory to match.
+ */
+class AlignedSpan {
+ public:
+  AlignedSpan(const off_t offset, const std::size_t length)
+      : start_(offset - offset % FileDescriptor::DIRECT_ALIGNMENT),
+        data_(NULL) {
+    const std::size_t alignment = FileDescriptor::DIRECT_ALIGNMENT;
+    const off_t end = offset + length;
+    size_ = (end - start_ + alignment - 1) / alignment * alignment;
+    void* memory;
+    if (::posix_memalign(&memory, alignment, size_) != 0) {
+      throw std::bad_alloc();
+    }
+    data_ = static_cast<char*>(memory);
+  }
+
+  ~AlignedSpan() { std::free(data_); }
+
+  off_t start() const { return start_; }
+  std::size_t size() const { return size_; }
+  char* data() { return data_; }
+
+ private:
+  AlignedSpan(const AlignedSpan&);
+  AlignedSpan& operator=(const AlignedSpan&);
+
+  off_t start_;
+  std::size_t size_;
+  char* data_;
+};
+
+}
+
+FileDescriptor::FileDescriptor(const std::string& filename,
+                               const bool create_new, const bool direct)
+    : filename_(filename), direct_(direct) {
+  const int flags = O_RDWR | (create_new ? O_CREAT | O_TRUNC : 0);
+  fd_ = ::open(filename_.c_str(), flags | (direct ? O_DIRECT : 0), 0644);
+  if (fd_ < 0 && direct && errno == EINVAL) {
+    // Filesystem without direct I/O, such as tmpfs.
+    direct_ = false;
+    fd_ = ::open(filename_.c_str(), flags, 0644);
+  }
+  if (fd_ < 0) {
+    throw IoErrorException(filename_, "open", errno);
+  }
+}
+
+FileDescriptor::~FileDescriptor() {
+  ::close(fd_);
+}
+
+void FileDescriptor::read(void* buffer, const std::size_t length,
+                          const off_t offset) const {
+  struct iovec single = {buffer, length};
+  readv(&single, 1, offset);
+}
+
+void FileDescriptor::readv(const struct iovec* buffers, const int count,
+                           const off_t offset) const {
+  if (direct_ && !isAligned(buffers, count, offset) &&
+      readDirect(buffers, count, offset)) {
+    return;
+  }
+  std::vector<struct iovec> rest(buffers, buffers + count);
+  off_t position = offset;
+  while (!rest.empty()) {
+    const ssize_t done = ::preadv(fd_, &rest[0], rest.size(), position);
+    if (done < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EINVAL && direct_ && position == offset) {
+        disableDirect();
+        continue;
+      }
+      throw IoErrorException(filename_, "preadv", errno);
+    }
+    if (done == 0) {
+      // End of file: the rest reads as zeros.
+      for (std::size_t i = 0; i < rest.size(); ++i) {
+        std::memset(rest[i].iov_base, 0, rest[i].iov_len);
+      }
+      return;
+    }
+    position += done;
+    skipTransferred(rest, done);
+  }
+}
+
+void FileDescriptor::write(const void* buffer, const std::size_t length,
+                           const off_t offset) {
+  struct iovec single = {const_cast<void*>(buffer), length};
+  writev(&single, 1, offset);
+}
+
+void FileDescriptor::writev(const struct iovec* buffers, const int count,
+                            const off_t offset) {
+  if (direct_ && !isAligned(buffers, count, offset) &&
+      writeDirect(buffers, count, offset)) {
+    return;
+  }
+  std::vector<struct iovec> rest(buffers, buffers + count);
+  off_t position = offset;
+  while (!rest.empty()) {
+    const ssize_t done = ::pwritev(fd_, &rest[0], rest.size(), position);
+    if (done < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EINVAL && direct_ && position == offset) {
+        disableDirect();
+        continue;
+      }
+      throw IoErrorException(filename_, "pwritev", errno);
+    }
+    position += done;
+    skipTransferred(rest, done);
+  }
+}
+
+void FileDescriptor::preallocate(const off_t offset, const off_t length) {
+  while (::fallocate(fd_, 0 /* mode */, offset, length) != 0) {
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EOPNOTSUPP || errno == ENOSYS) {
+      // Space is then taken as pages are written.
+      return;
+    }
+    throw IoErrorException(filename_, "fallocate", errno);
+  }
+}
+
+bool FileDescriptor::punchHole(const off_t offset, const off_t length) {
+  while (::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset,
+                     length) != 0) {
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == EOPNOTSUPP || errno == ENOSYS) {
+      return false;
+    }
+    throw IoErrorException(filename_, "fallocate", errno);
+  }
+  return true;
+}
+
+void FileDescriptor::truncate(const off_t length) {
+  while (::ftruncate(fd_, length) != 0) {
+    if (errno != EINTR) {
+      throw IoErrorException(filename_, "ftruncate", errno);
+    }
+  }
+}
+
+off_t FileDescriptor::allocatedSize() const {
+  struct stat info;
+  if (::fstat(fd_, &info) != 0) {
+    throw IoErrorException(filename_, "fstat", errno);
+  }
+  // st_blocks counts 512-byte units whatever the block size.
+  return static_cast<off_t>(info.st_blocks) * 512;
+}
+
+void FileDescriptor::sync() {
+  while (::fdatasync(fd_) != 0) {
+    if (errno != EINTR) {
+      throw IoErrorException(filename_, "fdatasync", errno);
+    }
+  }
+}
+
+bool FileDescriptor::readDirect(const struct iovec* buffers, const int count,
+                                const off_t offset) const {
+  AlignedSpan span(offset, totalLength(buffers, count));
+  if (!transferAligned(false, span.data(), span.size(), span.start())) {
+    return false;
+  }
+  const char* source = span.data() + (offset - span.start());
+  for (int i = 0; i < count; ++i) {
+    std::memcpy(buffers[i].iov_base, source, buffers[i].iov_len);
+    source += buffers[i].iov_len;
+  }
+  return true;
+}
+
+bool FileDescriptor::writeDirect(const struct iovec* buffers, const int count,
+                                 const off_t offset) {
+  const std::size_t length = totalLength(buffers, count);
+  AlignedSpan span(offset, length);
+  // Blocks only partly covered by the request keep the bytes around it.
+  const std::size_t block = DIRECT_ALIGNMENT;
+  const bool partial_head = offset != span.start();
+  const bool partial_tail = (offset + length) % block != 0;
+  if (partial_head &&
+      !transferAligned(false, span.data(), block, span.start())) {
+    return false;
+  }
+  if (partial_tail && !(partial_head && span.size() == block) &&
+      !transferAligned(false, span.data() + span.size() - block, block,
+                       span.start() + span.size() - block)) {
+    return false;
+  }
+  char* target = span.data() + (offset - span.start());
+  for (int i = 0; i < count; ++i) {
+    std::memcpy(target, buffers[i].iov_base, buffers[i].iov_len);
+    target += buffers[i].iov_len;
+  }
+  return transferAligned(true, span.data(), span.size(), span.start());
+}
+
+bool FileDescriptor::transferAligned(const bool write, char* data,
+                                     const std::size_t length,
+                                     const off_t offset) const {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t result =
+        write ? ::pwrite(fd_, data + done, length - done, offset + done)
+              : ::pread(fd_, data + done, length - done, offset + done);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EINVAL && done == 0) {
+        disableDirect();
+        return false;
+      }
+      throw IoErrorException(filename_, write ? "pwrite" : "pread", errno);
+    }
+    if (!write && static_cast<std::size_t>(result) < length - done) {
+      // A short direct read only happens at the end of the file, and the
+      // rest could not be asked for at an unaligned offset anyway.
+      std::memset(data + done + result, 0, length - done - result);
+      return true;
+    }
+    done += result;
+  }
+  return true;
+}
+
+void FileDescriptor::disableDirect() const {
+  const int flags = ::fcntl(fd_, F_GETFL);
+  if (flags < 0 || ::fcntl(fd_, F_SETFL, flags & ~O_DIRECT) < 0) {
+    throw IoErrorException(filename_, "fcntl", errno);
+  }
+  direct_ = false;
+}
+
+}
@@ -0,0 +1,184 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace badgerdb {
+
+/**
+ * @brief Open file descriptor doing positional I/O on a file.
+ *
+ * Every request names its own offset (pread/pwrite and their vectored forms),
+ * so there is no shared seek position and one descriptor can serve any number
+ * of threads at once.  Requests are retried until complete; reads past the
+ * end of the file come back as zeros, like a hole in a sparse file.
+ *
+ * A descriptor opened for direct I/O bypasses the kernel page cache
+ * (O_DIRECT).  Direct transfers must cover whole blocks of DIRECT_ALIGNMENT
+ * bytes from aligned memory; requests that don't go through an aligned bounce
+ * buffer, and writes read back partial blocks at either end first.  Writes that share
+ * a block must therefore not run concurrently.  If the filesystem rejects
+ * O_DIRECT, at open or on the first transfer, the descriptor quietly falls
+ * back to buffered I/O.
+ */
+class FileDescriptor {
+ public:
+  /**
+   * Opens the file for reading and writing.
+   *
+   * @param filename    Name of the file.
+   * @param create_new  True to create the file, truncating any existing one.
+   * @param direct      True to bypass the kernel page cache if possible.
+   * @throws  IoErrorException  If the file can not be opened.
+   */
+  FileDescriptor(const std::string& filename, const bool create_new,
+                 const bool direct = false);
+
+  /**
+   * Closes the descriptor.
+   */
+  ~FileDescriptor();
+
+  /**
+   * Reads length bytes at the offset.
+   *
+   * @throws  IoErrorException  If the read fails.
+   */
+  void read(void* buffer, const std::size_t length, const off_t offset) const;
+
+  /**
+   * Reads into the buffers in order, starting at the offset, with as few
+   * system calls as possible (normally one).
+   *
+   * @throws  IoErrorException  If the read fails.
+   */
+  void readv(const struct iovec* buffers, const int count,
+             const off_t offset) const;
+
+  /**
+   * Writes length bytes at the offset.
+   *
+   * @throws  IoErrorException  If the write fails.
+   */
+  void write(const void* buffer, const std::size_t length, const off_t offset);
+
+  /**
+   * Writes the buffers in order, starting at the offset, with as few system
+   * calls as possible (normally one).
+   *
+   * @throws  IoErrorException  If the write fails.
+   */
+  void writev(const struct iovec* buffers, const int count,
+              const off_t offset);
+
+  /**
+   * Reserves disk space for length bytes at the offset, growing the file if
+   * needed, so later writes there neither fail for lack of space nor scatter
+   * the file over the disk.  The new space reads as zeros.  Does nothing on
+   * filesystems without fallocate().
+   *
+   * @throws  IoErrorException  If the space can not be reserved.
+   */
+  void preallocate(const off_t offset, const off_t length);
+
+  /**
+   * Gives the disk space of length bytes at the offset back to the
+   * filesystem (FALLOC_FL_PUNCH_HOLE), keeping the file size.  The range
+   * reads as zeros afterwards.  Only whole filesystem blocks are freed; parts
+   * of blocks at either end are zeroed in place.
+   *
+   * @return  False if the filesystem can not punch holes; the range is then
+   *          left as it was.
+   * @throws  IoErrorException  If the hole can not be punched.
+   */
+  bool punchHole(const off_t offset, const off_t length);
+
+  /**
+   * Cuts the file, or extends it with zeros, to the given size.
+   *
+   * @throws  IoErrorException  If the size can not be changed.
+   */
+  void truncate(const off_t length);
+
+  /**
+   * Returns the number of bytes of disk space the file takes up, which for
+   * files with holes or preallocated space differs from their size.
+   *
+   * @throws  IoErrorException  If the file can not be examined.
+   */
+  off_t allocatedSize() const;
+
+  /**
+   * Waits until everything written so far, and the file size, is on stable
+   * storage (fdatasync()).
+   *
+   * @throws  IoErrorException  If the data can not be synced.
+   */
+  void sync();
+
+  /**
+   * Returns the raw descriptor.
+   */
+  int fd() const { return fd_; }
+
+  /**
+   * Returns the name of the file.
+   */
+  const std::string& filename() const { return filename_; }
+
+  /**
+   * Returns true if transfers bypass the kernel page cache.  Requests through
+   * fd() must then be aligned to DIRECT_ALIGNMENT.
+   */
+  bool isDirect() const { return direct_; }
+
+  /**
+   * Alignment of offsets, lengths and memory for direct transfers; a multiple
+   * of the logical block size of common devices.
+   */
+  static const std::size_t DIRECT_ALIGNMENT = 4096;
+
+ private:
+  FileDescriptor(const FileDescriptor&);
+  FileDescriptor& operator=(const FileDescriptor&);
+
+  /**
+   * Reads or writes through an aligned bounce buffer covering the request.
+   *
+   * @return  False if the filesystem rejected direct I/O, which has been
+   *          turned off; nothing was transferred then.
+   */
+  bool readDirect(const struct iovec* buffers, const int count,
+                  const off_t offset) const;
+  bool writeDirect(const struct iovec* buffers, const int count,
+                   const off_t offset);
+
+  /**
+   * Reads or writes length aligned bytes at an aligned offset.  Reads past the
+   * end of the file fill with zeros.
+   *
+   * @return  False if the filesystem rejected direct I/O, as above.
+   */
+  bool transferAligned(const bool write, char* data, const std::size_t length,
+                       const off_t offset) const;
+
+  /**
+   * Switches the descriptor to buffered I/O for good.
+   */
+  void disableDirect() const;
+
+  std::string filename_;
+  int fd_;
+  mutable std::atomic<bool> direct_;
+};
+
+}
@@ -9,6 +9,7 @@
 
 #include <cassert>
 #include "file.h"
+#include "mapped_file.h"
 #include "page.h"
 #include "types.h"
 
@@ -18,7 +19,8 @@ namespace badgerdb {
  * @brief Iterator for iterating over the pages in a file.
  *
  * This class provides a forward-only iterator for iterating over all of the
- * pages in a file.
+ * pages in a file, either a File or a MappedFile.  Pages of a MappedFile can
+ * be walked without any copying through view().
  */
 class FileIterator {
  public:
@@ -27,6 +29,7 @@ class FileIterator {
    */
   FileIterator()
       : file_(NULL),
+        mapped_(NULL),
         current_page_number_(Page::INVALID_NUMBER) {
   }
 
@@ -37,10 +40,10 @@ class FileIterator {
    * @param file  File to iterate over.
    */
   FileIterator(File* file)
-      : file_(file) {
+      : file_(file),
+        mapped_(NULL) {
     assert(file_ != NULL);
-    const FileHeader& header = file_->readHeader();
-    current_page_number_ = header.first_used_page;
+    current_page_number_ = file_->nextUsedPage(Page::INVALID_NUMBER);
   }
 
   /**
@@ -52,6 +55,33 @@ class FileIterator {
    */
   FileIterator(File* file, PageId page_number)
       : file_(file),
+        mapped_(NULL),
+        current_page_number_(page_number) {
+  }
+
+  /**
+   * Constructs an iterator over the pages in a mapped file, starting at the
+   * first page.
+   *
+   * @param file  Mapped file to iterate over.
+   */
+  FileIterator(const MappedFile* file)
+      : file_(NULL),
+        mapped_(file) {
+    assert(mapped_ != NULL);
+    current_page_number_ = mapped_->nextUsedPage(Page::INVALID_NUMBER);
+  }
+
+  /**
+   * Constructs an iterator over the pages in a mapped file, starting at the
+   * given page number.
+   *
+   * @param file        Mapped file to iterate over.
+   * @param page_number Number of page to start iterator at.
+   */
+  FileIterator(const MappedFile* file, PageId page_number)
+      : file_(NULL),
+        mapped_(file),
         current_page_number_(page_number) {
   }
 
@@ -59,9 +89,7 @@ class FileIterator {
    * Advances the iterator to the next page in the file.
    */
 	inline FileIterator& operator++() {
-    assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    current_page_number_ = nextPageNumber();
 
 		return *this;
 	}
@@ -71,9 +99,7 @@ class FileIterator {
 	{
 		FileIterator tmp = *this;   // copy ourselves
 
-    assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    current_page_number_ = nextPageNumber();
 
 		return tmp;
 	}
@@ -85,12 +111,12 @@ class FileIterator {
    * @return    True if other iterator is equal to this one.
    */
 	inline bool operator==(const FileIterator& rhs) const {
-    return file_->filename() == rhs.file_->filename() &&
+    return filename() == rhs.filename() &&
         current_page_number_ == rhs.current_page_number_;
   }
 
 	inline bool operator!=(const FileIterator& rhs) const {
-    return (file_->filename() != rhs.file_->filename()) ||
+    return (filename() != rhs.filename()) ||
         (current_page_number_ != rhs.current_page_number_);
   }
 
@@ -100,15 +126,50 @@ class FileIterator {
    *
    * @return  Page in file.
    */
-	inline Page operator*() const
-  { return file_->readPage(current_page_number_); }
+	inline Page operator*() const {
+    return mapped_ != NULL ? mapped_->copyPage(current_page_number_)
+                           : file_->readPage(current_page_number_);
+  }
+
+  /**
+   * Returns a view of the current page of a mapped file, without copying it.
+   *
+   * @return  View of page in mapped file.
+   */
+  PageView view() const {
+    assert(mapped_ != NULL);
+    return mapped_->view(current_page_number_);
+  }
 
  private:
+  /**
+   * Returns the number of the page after the current one.
+   */
+  PageId nextPageNumber() const {
+    if (mapped_ != NULL) {
+      return mapped_->nextUsedPage(current_page_number_);
+    }
+    assert(file_ != NULL);
+    return file_->nextUsedPage(current_page_number_);
+  }
+
+  /**
+   * Returns the name of the file we're iterating over.
+   */
+  const std::string& filename() const {
+    return mapped_ != NULL ? mapped_->filename() : file_->filename();
+  }
+
   /**
    * File we're iterating over.
    */
   File* file_;
 
+  /**
+   * Mapped file we're iterating over, if not a File.
+   */
+  const MappedFile* mapped_;
+
   /**
    * Number of page in file iterator is currently pointing to.
    */
@@ -0,0 +1,142 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lock_free_page_table.h"
+
+#include "exceptions/hash_table_exception.h"
+
+namespace badgerdb {
+
+LockFreePageTable::LockFreePageTable(std::uint32_t maxEntries) {
+  std::uint32_t size = 2;
+  while (size < 2 * maxEntries) {
+    size <<= 1;
+  }
+  mask_ = size - 1;
+  keys_ = new std::atomic<PageKey>[size];
+  frames_ = new std::atomic<FrameId>[size];
+  versions_ = new std::atomic<std::uint32_t>[size];
+  for (std::uint32_t i = 0; i < size; ++i) {
+    keys_[i].store(EMPTY_KEY, std::memory_order_relaxed);
+    frames_[i].store(NO_FRAME, std::memory_order_relaxed);
+    versions_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+LockFreePageTable::~LockFreePageTable() {
+  delete[] keys_;
+  delete[] frames_;
+  delete[] versions_;
+}
+
+std::uint32_t LockFreePageTable::slotOf(const PageKey key) const {
+  // Same Fibonacci mix as BufHashTbl::hash.
+  return static_cast<std::uint32_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) &
+         mask_;
+}
+
+void LockFreePageTable::beginChange(const std::uint32_t slot) {
+  // Writers are serialized, so only this thread changes the version.
+  versions_[slot].store(versions_[slot].load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void LockFreePageTable::endChange(const std::uint32_t slot) {
+  versions_[slot].store(versions_[slot].load(std::memory_order_relaxed) + 1,
+                        std::memory_order_release);
+}
+
+bool LockFreePageTable::insert(const PageKey key, const FrameId frameNo) {
+  // Probe to the first empty slot so a live entry for the key is always
+  // found, taking the first tombstone on the way if there is one.
+  std::uint32_t slot = slotOf(key);
+  std::uint32_t target = 0;
+  bool haveTarget = false;
+  for (std::uint32_t probes = 0; probes <= mask_; ++probes) {
+    const PageKey current = keys_[slot].load(std::memory_order_relaxed);
+    if (current == key) {
+      return false;
+    }
+    if ((current == TOMBSTONE_KEY || current == EMPTY_KEY) && !haveTarget) {
+      target = slot;
+      haveTarget = true;
+    }
+    if (current == EMPTY_KEY) {
+      break;
+    }
+    slot = (slot + 1) & mask_;
+  }
+  if (!haveTarget) {
+    throw HashTableException();
+  }
+  // The frame is still NO_FRAME, so readers that see the key before the
+  // frame report a miss.
+  beginChange(target);
+  keys_[target].store(key, std::memory_order_release);
+  frames_[target].store(frameNo, std::memory_order_release);
+  endChange(target);
+  return true;
+}
+
+bool LockFreePageTable::find(const PageKey key, FrameId& frameNo) const {
+  std::uint32_t slot = slotOf(key);
+  for (std::uint32_t probes = 0; probes <= mask_; ++probes) {
+    const std::uint32_t version =
+        versions_[slot].load(std::memory_order_acquire);
+    const PageKey current = keys_[slot].load(std::memory_order_acquire);
+    if (current == key) {
+      const FrameId frame = frames_[slot].load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // An odd or changed version means the slot was being changed between
+      // the loads, so the frame may belong to another key.  NO_FRAME means
+      // the entry is being inserted or removed right now.
+      if ((version & 1) != 0 ||
+          versions_[slot].load(std::memory_order_relaxed) != version ||
+          frame == NO_FRAME) {
+        return false;
+      }
+      frameNo = frame;
+      return true;
+    }
+    if (current == EMPTY_KEY) {
+      return false;
+    }
+    slot = (slot + 1) & mask_;
+  }
+  return false;
+}
+
+bool LockFreePageTable::remove(const PageKey key) {
+  std::uint32_t slot = slotOf(key);
+  for (std::uint32_t probes = 0; probes <= mask_; ++probes) {
+    const PageKey current = keys_[slot].load(std::memory_order_relaxed);
+    if (current == key) {
+      beginChange(slot);
+      frames_[slot].store(NO_FRAME, std::memory_order_release);
+      keys_[slot].store(TOMBSTONE_KEY, std::memory_order_release);
+      endChange(slot);
+      // A probe that reaches this slot goes on to the empty one after it, so
+      // this tombstone and any run of them right before it end nothing.
+      if (keys_[(slot + 1) & mask_].load(std::memory_order_relaxed) ==
+          EMPTY_KEY) {
+        while (keys_[slot].load(std::memory_order_relaxed) == TOMBSTONE_KEY) {
+          keys_[slot].store(EMPTY_KEY, std::memory_order_release);
+          slot = (slot - 1) & mask_;
+        }
+      }
+      return true;
+    }
+    if (current == EMPTY_KEY) {
+      return false;
+    }
+    slot = (slot + 1) & mask_;
+  }
+  return false;
+}
+
+}
@@ -0,0 +1,122 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Open-addressed (file, page) to frame map whose lookups take no lock.
+ *
+ * Slots hold a packed PageKey, a frame number and a version in three arrays of
+ * atomics and are probed linearly.  find() never blocks or retries, so
+ * readers on a multi-threaded hit path do not contend with each other or with
+ * writers.
+ *
+ * Inserts and removes change the table and must be serialized by the caller,
+ * as BufMgr does under its latch; any number of find() calls may run
+ * alongside them.  An insert publishes the key and then the frame; a remove
+ * withdraws the frame and then turns the key into a tombstone that later
+ * inserts reuse.  Tombstones right before an empty slot end no probe
+ * sequence, so the remove turns them back into empty slots, and finds of
+ * missing keys stop early again.
+ *
+ * Writers make a slot's version odd while they change it and even again
+ * afterwards.  find() reads the version before the key and the frame and
+ * checks it is unchanged and even afterwards, so a slot removed and reused
+ * between its loads is a miss rather than another page's frame.  Slots live in
+ * fixed arrays that are never freed while the table exists, so no epoch-based
+ * reclamation is needed.  find() therefore returns a frame that held the page
+ * at some point during the call; the page may have left it since, so callers
+ * pin the frame and then check its descriptor, as they must anyway with an
+ * unlatched table.
+ */
+class LockFreePageTable {
+ public:
+  /**
+   * Constructs a table for up to the given number of entries.  The table is
+   * sized to the next power of two at least twice that, to keep probes short.
+   */
+  explicit LockFreePageTable(std::uint32_t maxEntries);
+
+  ~LockFreePageTable();
+
+  /**
+   * Maps the key to the frame.  Not to be called concurrently with insert()
+   * or remove().
+   *
+   * @return  True if inserted, false if the key was already present
+   * @throws  HashTableException If the table has no free slot
+   */
+  bool insert(const PageKey key, const FrameId frameNo);
+
+  /**
+   * Looks up the key without taking any lock.
+   *
+   * @param key     Key to look up
+   * @param frameNo Set to the frame if the key is present
+   * @return  True if the key is present
+   */
+  bool find(const PageKey key, FrameId& frameNo) const;
+
+  /**
+   * Removes the key.  Not to be called concurrently with insert() or
+   * remove().
+   *
+   * @return  True if the key was present
+   */
+  bool remove(const PageKey key);
+
+  /**
+   * Returns the number of slots.
+   */
+  std::uint32_t capacity() const { return mask_ + 1; }
+
+ private:
+  /**
+   * Key of a slot that has never been used.  Real keys carry a non-zero file
+   * id, so they never collide with it.
+   */
+  static const PageKey EMPTY_KEY = 0;
+
+  /**
+   * Key of a slot whose entry was removed.
+   */
+  static const PageKey TOMBSTONE_KEY = ~static_cast<PageKey>(0);
+
+  /**
+   * Frame of a slot whose entry is being inserted or removed.
+   */
+  static const FrameId NO_FRAME = ~static_cast<FrameId>(0);
+
+  std::uint32_t slotOf(const PageKey key) const;
+
+  /**
+   * Makes the version of the slot odd before a writer changes it.
+   */
+  void beginChange(const std::uint32_t slot);
+
+  /**
+   * Makes the version of the slot even again once the change is done.
+   */
+  void endChange(const std::uint32_t slot);
+
+  std::uint32_t mask_;
+  std::atomic<PageKey>* keys_;
+  std::atomic<FrameId>* frames_;
+  std::atomic<std::uint32_t>* versions_;
+
+  LockFreePageTable(const LockFreePageTable&);
+  LockFreePageTable& operator=(const LockFreePageTable&);
+};
+
+}
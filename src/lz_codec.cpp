@@ -0,0 +1,182 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lz_codec.h"
+
+#include <cstring>
+#include <stdint.h>
+
+namespace badgerdb {
+
+namespace {
+
+const int HASH_BITS = 12;
+const std::size_t MAX_OFFSET = 65535;
+// Bytes the decoder copies at once when the buffers have room to spare.
+const std::size_t WILD_COPY = 16;
+
+inline std::uint32_t read32(const char* p) {
+  std::uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline std::uint32_t hash32(const std::uint32_t v) {
+  return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+// Appends the continuation bytes of a length whose nibble was saturated.
+inline void putLength(std::size_t len, std::string& out) {
+  while (len >= 255) {
+    out.push_back(static_cast<char>(255));
+    len -= 255;
+  }
+  out.push_back(static_cast<char>(len));
+}
+
+inline void putBlock(const char* literals, const std::size_t num_literals,
+                     const std::size_t offset, const std::size_t match_len,
+                     std::string& out) {
+  const std::size_t lit_nibble = num_literals < 15 ? num_literals : 15;
+  std::size_t match_nibble = 0;
+  if (match_len > 0) {
+    const std::size_t extra = match_len - LzCodec::MIN_MATCH;
+    match_nibble = extra < 15 ? extra : 15;
+  }
+  out.push_back(static_cast<char>((lit_nibble << 4) | match_nibble));
+  if (lit_nibble == 15) {
+    putLength(num_literals - 15, out);
+  }
+  out.append(literals, num_literals);
+  if (match_len > 0) {
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (match_nibble == 15) {
+      putLength(match_len - LzCodec::MIN_MATCH - 15, out);
+    }
+  }
+}
+
+// Reads a saturated length back; returns false if the stream ends early.
+inline bool getLength(const unsigned char*& ip, const unsigned char* end,
+                      std::size_t& len) {
+  unsigned char b;
+  do {
+    if (ip >= end) {
+      return false;
+    }
+    b = *ip++;
+    len += b;
+  } while (b == 255);
+  return true;
+}
+
+}
+
+void LzCodec::compress(const char* src, const std::size_t length,
+                       std::string& out) {
+  out.clear();
+  out.reserve(length / 2 + 16);
+
+  std::uint32_t table[1 << HASH_BITS];
+  std::memset(table, 0, sizeof(table));
+
+  std::size_t anchor = 0;
+  std::size_t pos = 0;
+  // Leave room so read32 never runs off the end of the input.
+  const std::size_t limit = length >= MIN_MATCH ? length - MIN_MATCH : 0;
+
+  while (pos < limit) {
+    const std::uint32_t seq = read32(src + pos);
+    const std::uint32_t h = hash32(seq);
+    const std::size_t candidate = table[h];
+    table[h] = static_cast<std::uint32_t>(pos);
+
+    if (candidate < pos && pos - candidate <= MAX_OFFSET &&
+        read32(src + candidate) == seq) {
+      std::size_t match_len = MIN_MATCH;
+      while (pos + match_len < length &&
+             src[candidate + match_len] == src[pos + match_len]) {
+        ++match_len;
+      }
+      putBlock(src + anchor, pos - anchor, pos - candidate, match_len, out);
+      pos += match_len;
+      anchor = pos;
+    } else {
+      ++pos;
+    }
+  }
+  putBlock(src + anchor, length - anchor, 0, 0, out);
+}
+
+bool LzCodec::decompress(const char* src, const std::size_t length,
+                         char* dst, const std::size_t dst_length) {
+  const unsigned char* ip = reinterpret_cast<const unsigned char*>(src);
+  const unsigned char* const end = ip + length;
+  std::size_t op = 0;
+
+  while (ip < end) {
+    const unsigned char token = *ip++;
+    std::size_t num_literals = token >> 4;
+    if (num_literals == 15 && !getLength(ip, end, num_literals)) {
+      return false;
+    }
+    if (num_literals > static_cast<std::size_t>(end - ip) ||
+        num_literals > dst_length - op) {
+      return false;
+    }
+    if (num_literals <= WILD_COPY &&
+        static_cast<std::size_t>(end - ip) >= WILD_COPY &&
+        dst_length - op >= WILD_COPY) {
+      // Short runs, the common case, are copied with one fixed-size copy
+      // the compiler inlines; the bytes past the run are overwritten later.
+      std::memcpy(dst + op, ip, WILD_COPY);
+    } else {
+      std::memcpy(dst + op, ip, num_literals);
+    }
+    ip += num_literals;
+    op += num_literals;
+
+    if (ip == end) {
+      // Final literal-only block.
+      break;
+    }
+    if (end - ip < 2) {
+      return false;
+    }
+    const std::size_t offset = ip[0] | (static_cast<std::size_t>(ip[1]) << 8);
+    ip += 2;
+    std::size_t match_len = token & 0x0f;
+    if (match_len == 15 && !getLength(ip, end, match_len)) {
+      return false;
+    }
+    match_len += MIN_MATCH;
+    if (offset == 0 || offset > op || match_len > dst_length - op) {
+      return false;
+    }
+    // Copy in steps no longer than the offset, so that a match overlapping
+    // its own output only reads bytes already written.  Steps may run past
+    // the match as long as they stay inside dst.
+    const std::size_t step = offset >= WILD_COPY ? WILD_COPY
+                             : offset >= 8       ? 8
+                                                 : 1;
+    std::size_t i = 0;
+    if (step > 1) {
+      const std::size_t room = dst_length - op;
+      for (; i < match_len && room - i >= WILD_COPY; i += step) {
+        std::memcpy(dst + op + i, dst + op + i - offset, step);
+      }
+    }
+    for (; i < match_len; ++i) {
+      dst[op + i] = dst[op + i - offset];
+    }
+    op += match_len;
+  }
+  return op == dst_length;
+}
+
+}
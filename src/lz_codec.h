@@ -0,0 +1,61 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace badgerdb {
+
+/**
+ * @brief Small, fast LZ77-style byte codec.
+ *
+ * The encoded stream is a sequence of blocks.  Each block starts with a token
+ * byte whose high nibble is the number of literal bytes that follow and whose
+ * low nibble is the length of the match that follows them (minus MIN_MATCH).
+ * A nibble value of 15 means the length continues in extra bytes, each of which
+ * is added to the length until a byte smaller than 255 is seen.  The literals
+ * are copied verbatim and the match is a 2-byte little-endian backwards offset.
+ * The last block of a stream only carries literals.
+ *
+ * The codec favours speed over ratio: matches are found with a single-entry
+ * hash table over 4-byte sequences.  Pages full of zeros or repetitive text
+ * (the common case for freshly written record pages) shrink several times.
+ */
+class LzCodec {
+ public:
+  /**
+   * Shortest match the encoder will emit.
+   */
+  static const std::size_t MIN_MATCH = 4;
+
+  /**
+   * Compresses <length> bytes at <src>, replacing the contents of <out>.
+   *
+   * @param src     Bytes to compress.
+   * @param length  Number of bytes at src.
+   * @param out     Receives the compressed stream.
+   */
+  static void compress(const char* src, const std::size_t length,
+                       std::string& out);
+
+  /**
+   * Decompresses a stream produced by compress() into <dst>.
+   *
+   * @param src         Compressed stream.
+   * @param length      Number of bytes in the compressed stream.
+   * @param dst         Destination buffer.
+   * @param dst_length  Exact number of bytes the stream must expand to.
+   * @return  True if the stream was well formed and expanded to exactly
+   *          dst_length bytes.
+   */
+  static bool decompress(const char* src, const std::size_t length,
+                         char* dst, const std::size_t dst_length);
+};
+
+}
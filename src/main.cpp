@@ -2,16 +2,36 @@
 #include <stdlib.h>
 //#include <stdio.h>
 #include <cstring>
+#include <cstddef>
 #include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <csignal>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "page.h"
 #include "buffer.h"
+#include "partitioned_buffer.h"
+#include "buffer_async.h"
+#include "lock_free_page_table.h"
+#include "mapped_file.h"
 #include "file_iterator.h"
 #include "page_iterator.h"
+#include "crc32c.h"
+#include "exceptions/checksum_mismatch_exception.h"
+#include "exceptions/file_format_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/invalid_page_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/invalid_quota_exception.h"
+#include "exceptions/io_error_exception.h"
 
 #define PRINT_ERROR(str) \
 { \
@@ -22,6 +42,18 @@
 
 using namespace badgerdb;
 
+namespace badgerdb {
+
+/**
+ * Gives the tests below access to what File keeps to itself.
+ */
+class FileTest {
+ public:
+  static FileHeader header(const File& file) { return file.readHeader(); }
+};
+
+}
+
 const PageId num = 100;
 PageId pid[num], pageno1, pageno2, pageno3, i;
 RecordId rid[num], rid2, rid3;
@@ -36,6 +68,33 @@ void test3();
 void test4();
 void test5();
 void test6();
+void test7();
+void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+#if defined(__cpp_impl_coroutine)
+void test31();
+#endif
 void testBufMgr();
 
 int main() 
@@ -74,12 +133,14 @@ int main()
     for (FileIterator iter = new_file.begin();
          iter != new_file.end();
          ++iter) {
-      // Iterate through all records on the page.
-      for (PageIterator page_iter = (*iter).begin();
-           page_iter != (*iter).end();
+      // Iterate through all records on the page.  The iterator keeps a
+      // pointer to the page, so hold on to a copy for the whole loop.
+      Page curr_page = *iter;
+      for (PageIterator page_iter = curr_page.begin();
+           page_iter != curr_page.end();
            ++page_iter) {
         std::cout << "Found record: " << *page_iter
-            << " on page " << (*iter).page_number() << "\n";
+            << " on page " << curr_page.page_number() << "\n";
       }
     }
 
@@ -146,6 +207,33 @@ void testBufMgr()
 	test4();
 	test5();
 	test6();
+	test7();
+	test8();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
+#if defined(__cpp_impl_coroutine)
+	test31();
+#endif
 
 	//Close files before deleting them
 	file1.~File();
@@ -319,3 +407,2145 @@ void test6()
 
 	bufMgr->flushFile(file1ptr);
 }
+
+void test7()
+{
+	//Pages evicted from a tiny pool should come back from the compressed cache
+	BufMgr smallMgr(3);
+	smallMgr.enableCompressedCache(64 * 1024);
+
+	for (i = 0; i < num/10; i++)
+	{
+		smallMgr.allocPage(file4ptr, pid[i], page);
+		sprintf((char*)tmpbuf, "test.4 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		smallMgr.unPinPage(file4ptr, pid[i], true);
+	}
+
+	for (i = 0; i < num/10; i++)
+	{
+		smallMgr.readPage(file4ptr, pid[i], page);
+		sprintf((char*)&tmpbuf, "test.4 Page %d %7.1f", pid[i], (float)pid[i]);
+		if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		smallMgr.unPinPage(file4ptr, pid[i], false);
+	}
+
+	if (smallMgr.getCompressedCache()->getStats().hits == 0)
+	{
+		PRINT_ERROR("ERROR :: Evicted pages should have been served from the compressed cache.");
+	}
+
+	smallMgr.flushFile(file4ptr);
+	if (smallMgr.getCompressedCache()->size() != 0)
+	{
+		PRINT_ERROR("ERROR :: Flushing a file should drop its compressed pages.");
+	}
+
+	std::cout << "Test 7 passed" << "\n";
+}
+
+void test8()
+{
+	//Pages evicted from a tiny pool should come back from a cache file kept in another directory
+	const std::string cacheDir = "test.ssd";
+	mkdir(cacheDir.c_str(), 0755);
+	{
+		BufMgr smallMgr(2);
+		smallMgr.enableCacheFile(cacheDir + "/pages.cache", 4);
+
+		for (i = 0; i < num/10; i++)
+		{
+			smallMgr.allocPage(file4ptr, pid[i], page);
+			sprintf((char*)tmpbuf, "test.4 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			smallMgr.unPinPage(file4ptr, pid[i], true);
+		}
+
+		//Read back newest first so recently spilled pages are still cached
+		for (i = num/10; i-- > 0; )
+		{
+			smallMgr.readPage(file4ptr, pid[i], page);
+			sprintf((char*)&tmpbuf, "test.4 Page %d %7.1f", pid[i], (float)pid[i]);
+			if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			smallMgr.unPinPage(file4ptr, pid[i], false);
+		}
+
+		const CacheStats& stats = smallMgr.getCacheFile()->getStats();
+		if (stats.hits == 0 || stats.misses == 0 || stats.evictions == 0)
+		{
+			PRINT_ERROR("ERROR :: Cache file should have served recent pages and evicted old ones.");
+		}
+		if (smallMgr.getCacheFile()->size() > 4)
+		{
+			PRINT_ERROR("ERROR :: Cache file holds more pages than it has slots.");
+		}
+
+		smallMgr.flushFile(file4ptr);
+	}
+	if (File::exists(cacheDir + "/pages.cache"))
+	{
+		PRINT_ERROR("ERROR :: Cache file should be removed with the buffer manager.");
+	}
+
+	//A page the cache file has no room for is left out instead of cached in part
+	{
+		PageCacheFile cache(cacheDir + "/limited.cache", 4);
+		const Page first = file4ptr->readPage(pid[0]);
+		const Page second = file4ptr->readPage(pid[1]);
+		struct rlimit limit;
+		getrlimit(RLIMIT_FSIZE, &limit);
+		struct rlimit small = limit;
+		small.rlim_cur = Page::SIZE + Page::SIZE / 2;
+		void (*handler)(int) = signal(SIGXFSZ, SIG_IGN);
+		setrlimit(RLIMIT_FSIZE, &small);
+		cache.insert(file4ptr, pid[0], first);
+		cache.insert(file4ptr, pid[1], second);
+		setrlimit(RLIMIT_FSIZE, &limit);
+		signal(SIGXFSZ, handler);
+		Page copy;
+		if (!cache.lookup(file4ptr, pid[0], copy) || cache.lookup(file4ptr, pid[1], copy) ||
+				cache.size() != 1 || cache.getStats().inserts != 1)
+		{
+			PRINT_ERROR("ERROR :: Page that could not be written should not be cached.");
+		}
+	}
+	rmdir(cacheDir.c_str());
+
+	std::cout << "Test 8 passed" << "\n";
+}
+
+void test9()
+{
+	//Copies of a File share one identifier, so they must share buffer frames too
+	File file4copy = *file4ptr;
+	if (file4copy.id() != file4ptr->id())
+	{
+		PRINT_ERROR("ERROR :: Copies of a File should have the same id.");
+	}
+
+	bufMgr->allocPage(file4ptr, pageno1, page);
+	bufMgr->readPage(&file4copy, pageno1, page2);
+	if (page != page2)
+	{
+		PRINT_ERROR("ERROR :: Same page read through a File copy should map to the same frame.");
+	}
+	bufMgr->unPinPage(&file4copy, pageno1, true);
+	bufMgr->unPinPage(file4ptr, pageno1, false);
+	try
+	{
+		bufMgr->unPinPage(file4ptr, pageno1, false);
+		PRINT_ERROR("ERROR :: Page is already unpinned. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(PageNotPinnedException e)
+	{
+	}
+	bufMgr->flushFile(&file4copy);
+
+	std::cout << "Test 9 passed" << "\n";
+}
+
+void test10()
+{
+	//Batch read of file1 pages, some resident, some not, in no particular order and with a duplicate
+	BufMgr smallMgr(8);
+	smallMgr.readPage(file1ptr, 5, page);
+
+	std::vector<PageId> pageNos;
+	pageNos.push_back(7);
+	pageNos.push_back(3);
+	pageNos.push_back(5);
+	pageNos.push_back(4);
+	pageNos.push_back(7);
+	pageNos.push_back(20);
+	std::vector<Page*> pages;
+	smallMgr.readPages(file1ptr, pageNos, pages);
+
+	for (i = 0; i < pageNos.size(); i++)
+	{
+		sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pageNos[i], (float)pageNos[i]);
+		RecordId recordId = {pageNos[i], 1};
+		if(strncmp(pages[i]->getRecord(recordId).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	if (pages[0] != pages[4] || pages[2] != page)
+	{
+		PRINT_ERROR("ERROR :: Pages already in the pool should not get a second frame.");
+	}
+
+	//Not enough frames left for this batch; nothing should stay pinned by it
+	std::vector<PageId> tooMany;
+	for (i = 30; i < 40; i++)
+		tooMany.push_back(i);
+	try
+	{
+		smallMgr.readPages(file1ptr, tooMany, pages);
+		PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(BufferExceededException e)
+	{
+	}
+
+	for (i = 0; i < pageNos.size(); i++)
+		smallMgr.unPinPage(file1ptr, pageNos[i], false);
+	smallMgr.unPinPage(file1ptr, 5, false);
+	smallMgr.flushFile(file1ptr);
+
+	std::cout << "Test 10 passed" << "\n";
+}
+
+void test11()
+{
+	//Partitioned pool: pages spread over the partitions and survive eviction
+	PartitionedBufMgr partMgr(20, 4);
+	if (partMgr.numPartitions() != 4)
+	{
+		PRINT_ERROR("ERROR :: Partitioned pool should have 4 partitions.");
+	}
+	PartitionedBufMgr emptyMgr(0, 4);
+	if (emptyMgr.numPartitions() != 1)
+	{
+		PRINT_ERROR("ERROR :: Empty partitioned pool should have 1 partition.");
+	}
+	try
+	{
+		emptyMgr.allocPage(file3ptr, pageno3, page);
+		PRINT_ERROR("ERROR :: Empty partitioned pool should have no frame to allocate.");
+	}
+	catch(BufferExceededException e)
+	{
+	}
+	try
+	{
+		emptyMgr.readPage(file3ptr, 1, page);
+		PRINT_ERROR("ERROR :: Empty partitioned pool should have no frame to read into.");
+	}
+	catch(BufferExceededException e)
+	{
+	}
+
+	bool used[4] = {false, false, false, false};
+	for (i = 0; i < num/2; i++)
+	{
+		partMgr.allocPage(file3ptr, pid[i], page);
+		sprintf((char*)tmpbuf, "test.3 Page %d %7.1f", pid[i], (float)pid[i]);
+		rid[i] = page->insertRecord(tmpbuf);
+		partMgr.unPinPage(file3ptr, pid[i], true);
+		used[partMgr.partitionOf(file3ptr, pid[i])] = true;
+	}
+	if (!used[0] || !used[1] || !used[2] || !used[3])
+	{
+		PRINT_ERROR("ERROR :: Pages should be spread over all partitions.");
+	}
+	if (partMgr.getBufStats().diskreads != 0)
+	{
+		PRINT_ERROR("ERROR :: Allocating pages should not count as disk reads.");
+	}
+
+	for (i = 0; i < num/2; i++)
+	{
+		partMgr.readPage(file3ptr, pid[i], page);
+		sprintf((char*)&tmpbuf, "test.3 Page %d %7.1f", pid[i], (float)pid[i]);
+		if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		partMgr.unPinPage(file3ptr, pid[i], false);
+	}
+
+	BufStats stats = partMgr.getBufStats();
+	if (stats.accesses != (int) num || stats.diskwrites == 0)
+	{
+		PRINT_ERROR("ERROR :: Partition statistics should add up.");
+	}
+
+	//With lock-free page tables residency is checked without the partition latches
+	partMgr.enableLockFreeTable();
+	partMgr.readPage(file3ptr, pid[0], page);
+	if (!partMgr.isResident(file3ptr, pid[0]) || partMgr.isResident(file3ptr, pid[num/2 - 1] + 1000))
+	{
+		PRINT_ERROR("ERROR :: Residency of pages is wrong.");
+	}
+	std::atomic<bool> done(false);
+	std::atomic<int> errors(0);
+	std::vector<std::thread> checkers;
+	for (int t = 0; t < 4; t++)
+	{
+		checkers.push_back(std::thread([&partMgr, &done, &errors]() {
+			while (!done.load())
+			{
+				if (!partMgr.isResident(file3ptr, pid[0]))
+					errors++;
+			}
+		}));
+	}
+	for (int round = 0; round < 20; round++)
+	{
+		for (i = 1; i < num/2; i++)
+		{
+			partMgr.readPage(file3ptr, pid[i], page);
+			partMgr.unPinPage(file3ptr, pid[i], false);
+		}
+	}
+	done = true;
+	for (std::size_t t = 0; t < checkers.size(); t++)
+		checkers[t].join();
+	if (errors.load() != 0)
+	{
+		PRINT_ERROR("ERROR :: Pinned page was not resident to other threads.");
+	}
+	partMgr.unPinPage(file3ptr, pid[0], false);
+	partMgr.flushFile(file3ptr);
+
+	//The rest of the BufMgr API works per partition: batched reads, caches, async I/O and quotas
+	partMgr.enableAsyncIo(4, PageIoQueue::THREAD_POOL);
+	std::vector<PageId> batch;
+	std::vector<std::size_t> batchRecords;
+	std::uint32_t perPartition[4] = {0, 0, 0, 0};
+	for (i = 0; i < num/2 && batch.size() < 8; i++)
+	{
+		if (perPartition[partMgr.partitionOf(file3ptr, pid[i])]++ < 3)
+		{
+			batch.push_back(pid[i]);
+			batchRecords.push_back(i);
+		}
+	}
+	std::vector<Page*> batchPages;
+	partMgr.readPages(file3ptr, batch, batchPages);
+	for (std::size_t b = 0; b < batch.size(); b++)
+	{
+		sprintf((char*)&tmpbuf, "test.3 Page %d %7.1f", batch[b], (float)batch[b]);
+		if (strncmp(batchPages[b]->getRecord(rid[batchRecords[b]]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: Batched read over the partitions returned the wrong page.");
+		}
+	}
+	if (!partMgr.pinIfResident(file3ptr, batch[0], page) || page != batchPages[0])
+	{
+		PRINT_ERROR("ERROR :: Page read in a batch should be resident.");
+	}
+	partMgr.unPinPage(file3ptr, batch[0], false);
+	for (std::size_t b = 0; b < batch.size(); b++)
+		partMgr.unPinPage(file3ptr, batch[b], false);
+
+	//A failing batch leaves nothing pinned in the partitions read before
+	PageId missing = pid[num/2 - 1] + 1000;
+	while (partMgr.partitionOf(file3ptr, missing) != partMgr.numPartitions() - 1)
+		missing++;
+	batch.push_back(missing);
+	try
+	{
+		partMgr.readPages(file3ptr, batch, batchPages);
+		PRINT_ERROR("ERROR :: Batch with a missing page should fail.");
+	}
+	catch(InvalidPageException e)
+	{
+	}
+	partMgr.flushFile(file3ptr);
+
+	partMgr.setFileQuota(file3ptr, 8, 12);
+	try
+	{
+		partMgr.setFileQuota(file3ptr, 21, 0);
+		PRINT_ERROR("ERROR :: Reservations beyond a partition should be rejected.");
+	}
+	catch(InvalidQuotaException e)
+	{
+	}
+	for (i = 0; i < num/2; i++)
+	{
+		partMgr.readPage(file1ptr, i + 1, page);
+		partMgr.unPinPage(file1ptr, i + 1, false);
+		partMgr.readPage(file3ptr, pid[i], page);
+		partMgr.unPinPage(file3ptr, pid[i], false);
+	}
+	BufSnapshot quotaSnap = partMgr.snapshot();
+	if (quotaSnap.files[file3ptr->id()].resident > 12 || quotaSnap.files[file3ptr->id()].resident < 8)
+	{
+		PRINT_ERROR("ERROR :: Quota split over the partitions was not kept.");
+	}
+	partMgr.clearFileQuota(file3ptr);
+
+	partMgr.enableCompressedCache(1 << 20);
+	partMgr.enableCacheFile("test.pcache", 8);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		partMgr.clearBufStats();
+		for (i = 0; i < num/2; i++)
+		{
+			partMgr.readPage(file3ptr, pid[i], page);
+			partMgr.unPinPage(file3ptr, pid[i], false);
+		}
+	}
+	if (partMgr.getBufStats().diskreads != 0)
+	{
+		PRINT_ERROR("ERROR :: Evicted pages should have come back from the partitions' caches.");
+	}
+	partMgr.enableCacheFile("test.pcache", 0);
+	if (File::exists("test.pcache.0"))
+	{
+		PRINT_ERROR("ERROR :: Cache files of the partitions should be removed when disabled.");
+	}
+	partMgr.flushFile(file3ptr);
+	partMgr.flushFile(file1ptr);
+
+	std::cout << "Test 11 passed" << "\n";
+}
+
+void test12()
+{
+	//Evicting one dirty page should write its dirty neighbours in the same request
+	{
+		BufMgr smallMgr(10);
+		for (i = 0; i < 10; i++)
+		{
+			smallMgr.allocPage(file2ptr, pid[i], page);
+			sprintf((char*)tmpbuf, "test.2 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			smallMgr.unPinPage(file2ptr, pid[i], true);
+		}
+		smallMgr.clearBufStats();
+
+		//One eviction writes a run of dirty pages, the next few evictions find them clean
+		for (i = 1; i <= 5; i++)
+		{
+			smallMgr.readPage(file1ptr, i, page);
+			smallMgr.unPinPage(file1ptr, i, false);
+		}
+		const BufStats& stats = smallMgr.getBufStats();
+		if (stats.combinedwrites == 0 || stats.diskwrites <= 5)
+		{
+			PRINT_ERROR("ERROR :: Dirty neighbours of an evicted page should have been written with it.");
+		}
+		smallMgr.flushFile(file2ptr);
+		smallMgr.flushFile(file1ptr);
+	}
+
+	BufMgr checkMgr(10);
+	for (i = 0; i < 10; i++)
+	{
+		checkMgr.readPage(file2ptr, pid[i], page);
+		sprintf((char*)&tmpbuf, "test.2 Page %d %7.1f", pid[i], (float)pid[i]);
+		if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		checkMgr.unPinPage(file2ptr, pid[i], false);
+	}
+	checkMgr.flushFile(file2ptr);
+
+	std::cout << "Test 12 passed" << "\n";
+}
+
+void test13()
+{
+	//Snapshot counts frames per file and exports them as JSON
+	BufMgr smallMgr(10);
+	for (i = 1; i <= 3; i++)
+		smallMgr.readPage(file1ptr, i, page);
+	for (i = 0; i < 2; i++)
+	{
+		smallMgr.readPage(file2ptr, pid[i], page);
+		smallMgr.unPinPage(file2ptr, pid[i], true);
+	}
+
+	BufSnapshot snap = smallMgr.snapshot();
+	const FileFrameCounts& counts1 = snap.files[file1ptr->id()];
+	const FileFrameCounts& counts2 = snap.files[file2ptr->id()];
+	if (snap.frames != 10 || snap.valid != 5 || snap.pinned != 3 || snap.dirty != 2 || snap.files.size() != 2)
+	{
+		PRINT_ERROR("ERROR :: Snapshot totals do not match the buffer pool.");
+	}
+	if (counts1.resident != 3 || counts1.pinned != 3 || counts1.dirty != 0 ||
+			counts2.resident != 2 || counts2.pinned != 0 || counts2.dirty != 2)
+	{
+		PRINT_ERROR("ERROR :: Snapshot per-file counts do not match the buffer pool.");
+	}
+	if (snap.pinCounts.size() != 2 || snap.pinCounts[0] != 2 || snap.pinCounts[1] != 3 || snap.refbitRatio() != 1.0)
+	{
+		PRINT_ERROR("ERROR :: Snapshot distributions do not match the buffer pool.");
+	}
+
+	std::ostringstream json;
+	snap.writeJson(json);
+	if (json.str().find("\"name\":\"test.1\",\"resident\":3") == std::string::npos)
+	{
+		PRINT_ERROR("ERROR :: Snapshot JSON is missing the per-file counts.");
+	}
+
+	for (i = 1; i <= 3; i++)
+		smallMgr.unPinPage(file1ptr, i, false);
+	smallMgr.flushFile(file1ptr);
+	smallMgr.flushFile(file2ptr);
+
+	std::cout << "Test 13 passed" << "\n";
+}
+
+void test14()
+{
+	//A capped file replaces its own pages, a reserved file keeps its pages
+	BufMgr smallMgr(10);
+	smallMgr.setFileQuota(file1ptr, 0, 3);
+	smallMgr.setFileQuota(file2ptr, 4, 0);
+
+	for (i = 0; i < 4; i++)
+	{
+		smallMgr.readPage(file2ptr, pid[i], page);
+		smallMgr.unPinPage(file2ptr, pid[i], false);
+	}
+	for (i = 1; i <= 6; i++)
+	{
+		smallMgr.readPage(file1ptr, i, page);
+		smallMgr.unPinPage(file1ptr, i, false);
+	}
+	BufSnapshot snap = smallMgr.snapshot();
+	if (snap.files[file1ptr->id()].resident != 3 || smallMgr.getBufStats().quotaevictions != 3)
+	{
+		PRINT_ERROR("ERROR :: File should have been held to its frame cap.");
+	}
+
+	smallMgr.clearFileQuota(file1ptr);
+	for (i = 1; i <= 20; i++)
+	{
+		smallMgr.readPage(file1ptr, i, page);
+		smallMgr.unPinPage(file1ptr, i, false);
+	}
+	snap = smallMgr.snapshot();
+	if (snap.files[file2ptr->id()].resident != 4 || snap.files[file1ptr->id()].resident != 6)
+	{
+		PRINT_ERROR("ERROR :: Reserved frames should not have been taken by another file.");
+	}
+
+	try
+	{
+		smallMgr.setFileQuota(file3ptr, 7, 0);
+		PRINT_ERROR("ERROR :: Reservations beyond the pool size should be rejected.");
+	}
+	catch(InvalidQuotaException e)
+	{
+	}
+
+	smallMgr.flushFile(file1ptr);
+	smallMgr.flushFile(file2ptr);
+
+	std::cout << "Test 14 passed" << "\n";
+}
+
+void test15()
+{
+	//Snapshot readers keep the old page while writers and flushFile proceed
+	BufMgr smallMgr(5);
+	smallMgr.readPage(file2ptr, pid[0], page);
+	const std::uint16_t freeSpace = page->getFreeSpace();
+	smallMgr.unPinPage(file2ptr, pid[0], false);
+	PageSnapshot snap = smallMgr.readSnapshot(file2ptr, pid[0]);
+	if (snap.isCopy())
+	{
+		PRINT_ERROR("ERROR :: Snapshot of an unpinned page should not be copied until it is read.");
+	}
+
+	smallMgr.readPage(file2ptr, pid[0], page);
+	page->insertRecord("written after the snapshot");
+	smallMgr.unPinPage(file2ptr, pid[0], true);
+	if (!snap.isCopy() || snap->getFreeSpace() != freeSpace || page->getFreeSpace() == freeSpace)
+	{
+		PRINT_ERROR("ERROR :: Snapshot should have kept the page as it was.");
+	}
+
+	smallMgr.enableSnapshotArena(2);
+	PageSnapshot snap2 = smallMgr.readSnapshot(file2ptr, pid[1]);
+	smallMgr.flushFile(file2ptr);
+	sprintf((char*)&tmpbuf, "test.2 Page %d %7.1f", pid[1], (float)pid[1]);
+	if (smallMgr.getSnapshotArena()->inUse() != 1 || strncmp(snap2->getRecord(rid[1]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+	{
+		PRINT_ERROR("ERROR :: Snapshot should have been copied into the arena by flushFile.");
+	}
+	snap2.reset();
+	if (smallMgr.getSnapshotArena()->inUse() != 0)
+	{
+		PRINT_ERROR("ERROR :: Released snapshot should have returned its arena page.");
+	}
+
+	smallMgr.readPage(file2ptr, pid[2], page);
+	smallMgr.readPage(file2ptr, pid[2], page);
+	PageSnapshot snap3 = smallMgr.readSnapshot(file2ptr, pid[2]);
+	smallMgr.unPinPage(file2ptr, pid[2], false);
+	if (snap3.isCopy())
+	{
+		PRINT_ERROR("ERROR :: Snapshot of a pinned page should not be copied while it is pinned.");
+	}
+	smallMgr.unPinPage(file2ptr, pid[2], false);
+	if (!snap3.isCopy() || smallMgr.getBufStats().snapshotcopies != 3)
+	{
+		PRINT_ERROR("ERROR :: Snapshot of a pinned page should be copied at the last unpin.");
+	}
+	smallMgr.flushFile(file2ptr);
+
+	//Snapshots read in other threads keep their page while writers pin it and other pages evict it,
+	//and a page a writer is changing is never copied halfway through
+	PartitionedBufMgr partMgr(12, 2);
+	partMgr.enableSnapshotArena(4);
+	partMgr.readPage(file2ptr, pid[9], page);
+	const RecordId first = page->insertRecord("round 000000");
+	const RecordId second = page->insertRecord("round 000000");
+	partMgr.unPinPage(file2ptr, pid[9], true);
+	std::atomic<bool> done(false);
+	std::atomic<int> errors(0);
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; t++)
+	{
+		readers.push_back(std::thread([&partMgr, &done, &errors, &first, &second, t]() {
+			char expected[100];
+			for (int n = 0; !done.load(); n++)
+			{
+				const int k = (t + n) % 4;
+				PageSnapshot view = partMgr.readSnapshot(file2ptr, pid[k]);
+				sprintf(expected, "test.2 Page %d %7.1f", pid[k], (float)pid[k]);
+				for (int r = 0; r < 20; r++)
+				{
+					if (strncmp(view->getRecord(rid[k]).c_str(), expected, strlen(expected)) != 0)
+						errors++;
+				}
+				PageSnapshot written = partMgr.readSnapshot(file2ptr, pid[9]);
+				if (written->getRecord(first) != written->getRecord(second))
+					errors++;
+			}
+		}));
+	}
+	for (int round = 0; round < 200; round++)
+	{
+		for (PageId k = 0; k < 9; k++)
+		{
+			partMgr.readPage(file2ptr, pid[k], page);
+			partMgr.unPinPage(file2ptr, pid[k], true);
+		}
+		partMgr.readPage(file2ptr, pid[9], page);
+		sprintf(tmpbuf, "round %06d", round + 1);
+		page->updateRecord(first, tmpbuf);
+		std::this_thread::yield();
+		page->updateRecord(second, tmpbuf);
+		partMgr.unPinPage(file2ptr, pid[9], true);
+		for (PageId p = 1; p <= 20; p++)
+		{
+			partMgr.readPage(file1ptr, p, page);
+			partMgr.unPinPage(file1ptr, p, false);
+		}
+	}
+	done = true;
+	for (std::size_t t = 0; t < readers.size(); t++)
+		readers[t].join();
+	if (errors.load() != 0)
+	{
+		PRINT_ERROR("ERROR :: Snapshot readers saw their page change.");
+	}
+	partMgr.readPage(file2ptr, pid[9], page);
+	page->deleteRecord(second);
+	page->deleteRecord(first);
+	partMgr.unPinPage(file2ptr, pid[9], true);
+	partMgr.flushFile(file2ptr);
+	partMgr.flushFile(file1ptr);
+
+	std::cout << "Test 15 passed" << "\n";
+}
+
+void test16()
+{
+	//Lock-free page table: map semantics, and readers see stable entries while a writer churns
+	LockFreePageTable table(64);
+	FrameId frame;
+	if (!table.insert(file1ptr->pageKey(1), 7) || table.insert(file1ptr->pageKey(1), 8) ||
+			!table.find(file1ptr->pageKey(1), frame) || frame != 7 || table.find(file2ptr->pageKey(1), frame))
+	{
+		PRINT_ERROR("ERROR :: Lock-free page table insert/find failed.");
+	}
+	if (!table.remove(file1ptr->pageKey(1)) || table.remove(file1ptr->pageKey(1)) || table.find(file1ptr->pageKey(1), frame))
+	{
+		PRINT_ERROR("ERROR :: Lock-free page table remove failed.");
+	}
+
+	for (i = 1; i <= 32; i++)
+		table.insert(file1ptr->pageKey(i), i);
+
+	std::atomic<bool> done(false);
+	std::atomic<int> errors(0);
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; t++)
+	{
+		readers.push_back(std::thread([&table, &done, &errors]() {
+			while (!done.load())
+			{
+				for (PageId p = 1; p <= 32; p++)
+				{
+					FrameId f;
+					if (!table.find(file1ptr->pageKey(p), f) || f != p)
+						errors++;
+				}
+			}
+		}));
+	}
+	for (int round = 0; round < 2000; round++)
+	{
+		for (PageId p = 1; p <= 16; p++)
+			table.insert(file2ptr->pageKey(p), 100 + p);
+		for (PageId p = 1; p <= 16; p++)
+			table.remove(file2ptr->pageKey(p));
+	}
+	done = true;
+	for (std::size_t t = 0; t < readers.size(); t++)
+		readers[t].join();
+	if (errors.load() != 0)
+	{
+		PRINT_ERROR("ERROR :: Readers of the lock-free page table missed stable entries.");
+	}
+
+	//A small table churned with ever new keys: removes turn tombstones back into empty slots
+	LockFreePageTable small(4);
+	for (PageId p = 1; p <= 1000; p++)
+	{
+		if (!small.insert(file1ptr->pageKey(p), p) || !small.find(file1ptr->pageKey(p), frame) || frame != p)
+		{
+			PRINT_ERROR("ERROR :: Lock-free page table lost an entry under churn.");
+		}
+		if (p > 3 && !small.remove(file1ptr->pageKey(p - 3)))
+		{
+			PRINT_ERROR("ERROR :: Lock-free page table lost an entry under churn.");
+		}
+	}
+	for (PageId p = 1; p <= 1000; p++)
+	{
+		if (small.find(file1ptr->pageKey(p), frame) != (p > 997))
+		{
+			PRINT_ERROR("ERROR :: Lock-free page table has the wrong entries after churn.");
+		}
+	}
+
+	//Keys that take turns in one slot: a lookup never returns the frame of the other key
+	LockFreePageTable shared(1);
+	std::atomic<bool> stop(false);
+	std::atomic<int> wrong(0);
+	std::vector<std::thread> lookups;
+	for (int t = 0; t < 4; t++)
+	{
+		lookups.push_back(std::thread([&shared, &stop, &wrong]() {
+			FrameId found;
+			while (!stop.load())
+			{
+				for (PageId p = 1; p <= 2; p++)
+				{
+					if (shared.find(file1ptr->pageKey(p), found) && found != p)
+						wrong++;
+				}
+			}
+		}));
+	}
+	for (int round = 0; round < 200000; round++)
+	{
+		for (PageId p = 1; p <= 2; p++)
+		{
+			shared.insert(file1ptr->pageKey(p), p);
+			shared.remove(file1ptr->pageKey(p));
+		}
+	}
+	stop = true;
+	for (std::size_t t = 0; t < lookups.size(); t++)
+		lookups[t].join();
+	if (wrong.load() != 0)
+	{
+		PRINT_ERROR("ERROR :: Lock-free page table returned the frame of another key.");
+	}
+
+	std::cout << "Test 16 passed" << "\n";
+}
+
+void test17()
+{
+	//allocPage only reserves the page; it reaches the disk once, when written back
+	const std::string filename6 = "test.6";
+	{
+		File file6 = File::create(filename6);
+		BufMgr smallMgr(3);
+		for (i = 0; i < 3; i++)
+		{
+			smallMgr.allocPage(&file6, pid[i], page);
+			sprintf((char*)tmpbuf, "test.6 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			smallMgr.unPinPage(&file6, pid[i], false);
+		}
+		if (!file6.isReserved(pid[2]))
+		{
+			PRINT_ERROR("ERROR :: Allocated page should only be reserved until written back.");
+		}
+		try
+		{
+			file6.readPage(pid[2]);
+			PRINT_ERROR("ERROR :: Reserved page should not be readable from the file.");
+		}
+		catch(InvalidPageException e)
+		{
+		}
+
+		smallMgr.disposePage(&file6, pid[1]);
+		smallMgr.clearBufStats();
+		smallMgr.flushFile(&file6);
+		if (smallMgr.getBufStats().diskwrites != 2 || file6.isReserved(pid[0]) || file6.isReserved(pid[1]))
+		{
+			PRINT_ERROR("ERROR :: Flushing should have written each remaining page once.");
+		}
+
+		//The dropped reservation became a free page once pid[2] was written,
+		//and reserved pages written out of order still end up in page order
+		Page first = file6.reservePage();
+		Page second = file6.reservePage();
+		if (first.page_number() != pid[1])
+		{
+			PRINT_ERROR("ERROR :: Page skipped by a dropped reservation was not reused.");
+		}
+		file6.writePage(second);
+		file6.writePage(first);
+
+		std::vector<PageId> expected;
+		expected.push_back(pid[0]);
+		expected.push_back(first.page_number());
+		expected.push_back(pid[2]);
+		expected.push_back(second.page_number());
+		std::vector<PageId> found;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter)
+			found.push_back((*iter).page_number());
+		if (found != expected)
+		{
+			PRINT_ERROR("ERROR :: Materialized pages are not linked in page order.");
+		}
+
+		Page check = file6.readPage(pid[2]);
+		sprintf((char*)&tmpbuf, "test.6 Page %d %7.1f", pid[2], (float)pid[2]);
+		if(strncmp(check.getRecord(rid[2]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	File::remove(filename6);
+
+	std::cout << "Test 17 passed" << "\n";
+}
+
+void test18()
+{
+	//Temporary file: pages spill only on eviction, numbers are reused, discard drops the file
+	const std::string tempname = "test.tmp";
+	{
+		File tempFile = File::createTemp(tempname);
+		BufMgr smallMgr(3);
+		for (i = 0; i < 6; i++)
+		{
+			smallMgr.allocPage(&tempFile, pid[i], page);
+			sprintf((char*)tmpbuf, "test.tmp Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			smallMgr.unPinPage(&tempFile, pid[i], true);
+		}
+		if (smallMgr.getBufStats().diskwrites != 3)
+		{
+			PRINT_ERROR("ERROR :: Temporary pages should only be written when evicted.");
+		}
+		for (i = 0; i < 6; i++)
+		{
+			smallMgr.readPage(&tempFile, pid[i], page);
+			sprintf((char*)&tmpbuf, "test.tmp Page %d %7.1f", pid[i], (float)pid[i]);
+			if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			smallMgr.unPinPage(&tempFile, pid[i], false);
+		}
+
+		smallMgr.disposePage(&tempFile, pid[1]);
+		smallMgr.allocPage(&tempFile, pageno1, page);
+		smallMgr.unPinPage(&tempFile, pageno1, true);
+		if (pageno1 != pid[1])
+		{
+			PRINT_ERROR("ERROR :: Freed temporary page number should be reused right away.");
+		}
+
+		//Assigning a handle to itself or to another handle of the file keeps the file and its pages
+		const FileId tempId = tempFile.id();
+		File& sameFile = tempFile;
+		tempFile = sameFile;
+		File otherHandle = tempFile;
+		tempFile = otherHandle;
+		if (!File::exists(tempname) || tempFile.id() != tempId)
+		{
+			PRINT_ERROR("ERROR :: Assigning a temporary file to itself should keep it.");
+		}
+		for (i = 0; i < 6; i++)
+		{
+			if (i == 1)
+				continue;
+			smallMgr.readPage(&tempFile, pid[i], page);
+			sprintf((char*)&tmpbuf, "test.tmp Page %d %7.1f", pid[i], (float)pid[i]);
+			if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: Temporary pages should survive assigning the file.");
+			}
+			smallMgr.unPinPage(&tempFile, pid[i], false);
+		}
+
+		smallMgr.clearBufStats();
+		smallMgr.discardFile(&tempFile);
+		if (smallMgr.getBufStats().diskwrites != 0 || smallMgr.snapshot().valid != 0)
+		{
+			PRINT_ERROR("ERROR :: Discarding a file should drop its pages without writing them.");
+		}
+	}
+	if (File::exists(tempname))
+	{
+		PRINT_ERROR("ERROR :: Temporary file should be removed once closed.");
+	}
+
+	std::cout << "Test 18 passed" << "\n";
+}
+
+void test19()
+{
+	//Positional I/O: threads read pages of one file concurrently while another writes
+	const std::string filename7 = "test.7";
+	{
+		File file7 = File::create(filename7);
+		std::vector<Page> pages;
+		for (i = 0; i < 32; i++)
+		{
+			Page newPage = file7.allocatePage();
+			sprintf((char*)tmpbuf, "test.7 Page %d", newPage.page_number());
+			rid[i] = newPage.insertRecord(tmpbuf);
+			file7.writePage(newPage);
+			pages.push_back(newPage);
+		}
+
+		std::atomic<int> errors(0);
+		std::vector<std::thread> readers;
+		for (int t = 0; t < 4; t++)
+		{
+			readers.push_back(std::thread([&file7, &pages, &errors]() {
+				for (int round = 0; round < 50; round++)
+				{
+					for (std::size_t p = 0; p < pages.size(); p++)
+					{
+						Page read = file7.readPage(pages[p].page_number());
+						if (read.getRecord(rid[p]) != pages[p].getRecord(rid[p]))
+							errors++;
+					}
+				}
+			}));
+		}
+		for (int round = 0; round < 50; round++)
+		{
+			for (std::size_t p = 0; p < pages.size(); p++)
+				file7.writePage(pages[p]);
+		}
+		for (std::size_t t = 0; t < readers.size(); t++)
+			readers[t].join();
+		if (errors.load() != 0)
+		{
+			PRINT_ERROR("ERROR :: Concurrent readers saw the wrong page contents.");
+		}
+	}
+	File::remove(filename7);
+
+	std::cout << "Test 19 passed" << "\n";
+}
+
+void test20()
+{
+	//Asynchronous I/O: flush and batched reads through each queue backend
+	const std::string filename8 = "test.8";
+	const PageIoQueue::Backend backends[] = {PageIoQueue::IO_URING, PageIoQueue::THREAD_POOL};
+	for (int b = 0; b < 2; b++)
+	{
+		BufMgr mgr(16);
+		try
+		{
+			mgr.enableAsyncIo(8, backends[b]);
+		}
+		catch(IoErrorException e)
+		{
+			// No io_uring on this system; the thread pool still gets tested
+			continue;
+		}
+
+		{
+			File file8 = File::create(filename8);
+			std::vector<PageId> pageNos;
+			for (i = 0; i < 48; i++)
+			{
+				mgr.allocPage(&file8, pid[i], page);
+				sprintf((char*)tmpbuf, "test.8 Page %d %7.1f", pid[i], (float)pid[i]);
+				rid[i] = page->insertRecord(tmpbuf);
+				mgr.unPinPage(&file8, pid[i], true);
+				pageNos.push_back(pid[i]);
+			}
+			mgr.flushFile(&file8);
+
+			for (i = 0; i < 48; i += 12)
+			{
+				std::vector<PageId> batch(pageNos.begin() + i, pageNos.begin() + i + 12);
+				std::vector<Page*> pages;
+				mgr.readPages(&file8, batch, pages);
+				for (PageId j = 0; j < 12; j++)
+				{
+					sprintf((char*)tmpbuf, "test.8 Page %d %7.1f", pid[i + j], (float)pid[i + j]);
+					if (strncmp(pages[j]->getRecord(rid[i + j]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+					{
+						PRINT_ERROR("ERROR :: Contents of pages read through the I/O queue do not match.");
+					}
+					mgr.unPinPage(&file8, batch[j], false);
+				}
+			}
+			mgr.flushFile(&file8);
+
+			// A failed read is reported once the batch completes, and rolled back
+			file8.deletePage(pid[5]);
+			try
+			{
+				std::vector<PageId> batch(pageNos.begin(), pageNos.begin() + 8);
+				std::vector<Page*> pages;
+				mgr.readPages(&file8, batch, pages);
+				PRINT_ERROR("ERROR :: Reading a deleted page through the I/O queue should fail.");
+			}
+			catch(InvalidPageException e)
+			{
+			}
+			if (mgr.snapshot().pinned != 0 || mgr.snapshot().valid != 0)
+			{
+				PRINT_ERROR("ERROR :: Failed asynchronous read left frames behind.");
+			}
+			mgr.flushFile(&file8);
+
+			// Tagged reads come back from poll() one by one, each with its own error
+			PageIoQueue* queue = PageIoQueue::create(4, backends[b]);
+			std::vector<Page> images(8);
+			for (i = 0; i < 8; i++)
+			{
+				file8.readPageAsync(*queue, pid[i], images[i], &images[i]);
+			}
+			std::vector<PageIoQueue::Completion> done;
+			while (queue->taggedInFlight() > 0)
+			{
+				queue->poll(done, true);
+			}
+			queue->poll(done, true);
+			if (done.size() != 8)
+			{
+				PRINT_ERROR("ERROR :: Every tagged read should be polled exactly once.");
+			}
+			for (std::size_t d = 0; d < done.size(); d++)
+			{
+				i = static_cast<Page*>(done[d].tag) - &images[0];
+				if (i == 5)
+				{
+					try
+					{
+						if (done[d].error)
+							std::rethrow_exception(done[d].error);
+						PRINT_ERROR("ERROR :: Polled read of a deleted page should carry an error.");
+					}
+					catch(InvalidPageException e)
+					{
+					}
+					continue;
+				}
+				sprintf((char*)tmpbuf, "test.8 Page %d %7.1f", pid[i], (float)pid[i]);
+				if (done[d].error || strncmp(images[i].getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+				{
+					PRINT_ERROR("ERROR :: Contents of pages polled from the I/O queue do not match.");
+				}
+			}
+			delete queue;
+		}
+		File::remove(filename8);
+	}
+
+	std::cout << "Test 20 passed" << "\n";
+}
+
+void test21()
+{
+	//Direct I/O: pages written and read around the page cache match buffered I/O
+	const std::string filename9 = "test.9";
+	{
+		File file9 = File::create(filename9, true /* direct */);
+		BufMgr mgr(8);
+		for (i = 0; i < 24; i++)
+		{
+			mgr.allocPage(&file9, pid[i], page);
+			sprintf((char*)tmpbuf, "test.9 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			mgr.unPinPage(&file9, pid[i], true);
+		}
+		mgr.flushFile(&file9);
+
+		// Neighbouring pages share device blocks; rewriting one keeps the others
+		Page middle = file9.readPage(pid[10]);
+		rid2 = middle.insertRecord("rewritten");
+		file9.writePage(middle);
+		file9.deletePage(pid[11]);
+
+		std::vector<PageId> run(pid + 12, pid + 20);
+		std::vector<Page> pages = file9.readPages(run);
+		for (i = 0; i < 8; i++)
+		{
+			sprintf((char*)tmpbuf, "test.9 Page %d %7.1f", pid[12 + i], (float)pid[12 + i]);
+			if (strncmp(pages[i].getRecord(rid[12 + i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: Contents of pages read with direct I/O do not match.");
+			}
+		}
+	}
+	{
+		File file9 = File::open(filename9);
+		if (file9.isDirect())
+		{
+			PRINT_ERROR("ERROR :: File opened for buffered I/O reports direct I/O.");
+		}
+		for (i = 0; i < 24; i++)
+		{
+			if (i == 11)
+				continue;
+			Page read = file9.readPage(pid[i]);
+			sprintf((char*)tmpbuf, "test.9 Page %d %7.1f", pid[i], (float)pid[i]);
+			if (strncmp(read.getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: Pages written with direct I/O read back wrong.");
+			}
+		}
+		if (file9.readPage(pid[10]).getRecord(rid2) != "rewritten")
+		{
+			PRINT_ERROR("ERROR :: Rewritten page lost its new record.");
+		}
+		try
+		{
+			file9.readPage(pid[11]);
+			PRINT_ERROR("ERROR :: Page deleted with direct I/O can still be read.");
+		}
+		catch(InvalidPageException e)
+		{
+		}
+	}
+	File::remove(filename9);
+
+	std::cout << "Test 21 passed" << "\n";
+}
+
+void test22()
+{
+	//Memory-mapped file: pages and records are walked as views into the mapping
+	const std::string filename10 = "test.10";
+	{
+		File file10 = File::create(filename10);
+		for (i = 0; i < 20; i++)
+		{
+			Page newPage = file10.allocatePage();
+			pid[i] = newPage.page_number();
+			sprintf((char*)tmpbuf, "test.10 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = newPage.insertRecord(tmpbuf);
+			newPage.insertRecord("second");
+			file10.writePage(newPage);
+		}
+		file10.deletePage(pid[7]);
+	}
+	{
+		MappedFile mapped(filename10);
+		mapped.advise(MappedFile::SEQUENTIAL);
+		int pagesSeen = 0, recordsSeen = 0;
+		for (FileIterator iter = mapped.begin(); iter != mapped.end(); ++iter)
+		{
+			const PageView view = iter.view();
+			for (PageIterator record = view.begin(); record != view.end(); ++record)
+			{
+				if (record.record().toString() != *record)
+				{
+					PRINT_ERROR("ERROR :: Record view of mapped page does not match its copy.");
+				}
+				recordsSeen++;
+			}
+			pagesSeen++;
+		}
+		if (pagesSeen != 19 || recordsSeen != 38)
+		{
+			PRINT_ERROR("ERROR :: Iterating over the mapped file saw the wrong pages.");
+		}
+
+		mapped.advise(pid[3], 4, MappedFile::RANDOM);
+		for (i = 0; i < 20; i++)
+		{
+			if (i == 7)
+				continue;
+			sprintf((char*)tmpbuf, "test.10 Page %d %7.1f", pid[i], (float)pid[i]);
+			const RecordView record = mapped.readPage(pid[i]).getRecord(rid[i]);
+			if (record.length != strlen(tmpbuf) || strncmp(record.data, tmpbuf, record.length) != 0)
+			{
+				PRINT_ERROR("ERROR :: Record viewed in mapped file does not match.");
+			}
+		}
+		try
+		{
+			mapped.readPage(pid[7]);
+			PRINT_ERROR("ERROR :: Deleted page can be read from the mapped file.");
+		}
+		catch(InvalidPageException e)
+		{
+		}
+	}
+	File::remove(filename10);
+
+	std::cout << "Test 22 passed" << "\n";
+}
+
+void test23()
+{
+	//Cached file header: shared by copies, written through to disk
+	const std::string filename11 = "test.11";
+	{
+		File file11 = File::create(filename11);
+		File copy = file11;
+		File reopened = File::open(filename11);
+		for (i = 0; i < 10; i++)
+		{
+			Page newPage = file11.allocatePage();
+			pid[i] = newPage.page_number();
+			rid[i] = newPage.insertRecord("test.11");
+			file11.writePage(newPage);
+		}
+		// Bounds checks of the other objects see the new pages at once
+		copy.readPage(pid[9]);
+		reopened.readPage(pid[9]);
+		copy.deletePage(pid[4]);
+
+		MappedFile onDisk(filename11);
+		if (onDisk.header().num_pages != 11 || onDisk.header().num_free_pages != 1)
+		{
+			PRINT_ERROR("ERROR :: File header on disk is behind the cached one.");
+		}
+		int pagesSeen = 0;
+		for (FileIterator iter = reopened.begin(); iter != reopened.end(); ++iter)
+			pagesSeen++;
+		if (pagesSeen != 9)
+		{
+			PRINT_ERROR("ERROR :: Iterating with the cached header saw the wrong pages.");
+		}
+	}
+	{
+		// Opened afresh, the header comes from disk again
+		File file11 = File::open(filename11);
+		Page newPage = file11.allocatePage();
+		if (newPage.page_number() != pid[4])
+		{
+			PRINT_ERROR("ERROR :: Free page list lost when the file was reopened.");
+		}
+		try
+		{
+			file11.readPage(11);
+			PRINT_ERROR("ERROR :: Page past the end of the reopened file can be read.");
+		}
+		catch(InvalidPageException e)
+		{
+		}
+	}
+	File::remove(filename11);
+
+	std::cout << "Test 23 passed" << "\n";
+}
+
+void test24()
+{
+	//Allocation bitmaps: old list-linked files are refused until converted
+	const std::string filename12 = "test.12";
+	const std::string oldname = "test.12.old";
+	{
+		File file12 = File::create(filename12);
+		for (i = 0; i < 3; i++)
+		{
+			Page newPage = file12.allocatePage();
+			pid[i] = newPage.page_number();
+			sprintf((char*)tmpbuf, "test.12 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = newPage.insertRecord(tmpbuf);
+			file12.writePage(newPage);
+		}
+		file12.deletePage(pid[1]);
+	}
+	{
+		// Rebuild the file in the old layout: a four-field header with the used
+		// and free lists, then the pages with no bitmap page in front of them.
+		std::ifstream in(filename12.c_str(), std::ios::binary);
+		std::ofstream out(oldname.c_str(), std::ios::binary);
+		const PageId oldHeader[4] = {4 /* num_pages */, pid[0] /* first_used_page */,
+		                             1 /* num_free_pages */, pid[1] /* first_free_page */};
+		out.write((const char*)oldHeader, sizeof(oldHeader));
+		std::vector<char> raw(Page::SIZE);
+		for (i = 0; i < 3; i++)
+		{
+			in.seekg(FileHeader::BITMAP_HEADER_SIZE + pid[i] * Page::SIZE);
+			in.read(&raw[0], raw.size());
+			out.write(&raw[0], raw.size());
+		}
+	}
+	File::remove(filename12);
+
+	try
+	{
+		File old = File::open(oldname);
+		PRINT_ERROR("ERROR :: File in the old layout was opened without conversion.");
+	}
+	catch(FileFormatException e)
+	{
+	}
+	if (!File::convert(oldname) || File::convert(oldname))
+	{
+		PRINT_ERROR("ERROR :: File should be converted exactly once.");
+	}
+	{
+		File converted = File::open(oldname);
+		std::vector<PageId> found;
+		for (FileIterator iter = converted.begin(); iter != converted.end(); ++iter)
+			found.push_back((*iter).page_number());
+		if (found.size() != 2 || found[0] != pid[0] || found[1] != pid[2])
+		{
+			PRINT_ERROR("ERROR :: Converted file has the wrong pages in use.");
+		}
+		for (i = 0; i < 3; i += 2)
+		{
+			sprintf((char*)tmpbuf, "test.12 Page %d %7.1f", pid[i], (float)pid[i]);
+			if (converted.readPage(pid[i]).getRecord(rid[i]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		if (converted.allocatePage().page_number() != pid[1])
+		{
+			PRINT_ERROR("ERROR :: Free page of the converted file was not reused.");
+		}
+		converted.deletePage(pid[0]);
+		try
+		{
+			converted.deletePage(pid[0]);
+			PRINT_ERROR("ERROR :: Free page can be deleted again.");
+		}
+		catch(InvalidPageException e)
+		{
+		}
+	}
+	File::remove(oldname);
+
+	std::cout << "Test 24 passed" << "\n";
+}
+
+void test25()
+{
+	//Extents: files grow on disk in preallocated runs, pages can be allocated in runs
+	const std::string filename13 = "test.13";
+	{
+		File file13 = File::create(filename13);
+		if (file13.extentSize() != File::DEFAULT_EXTENT_SIZE)
+		{
+			PRINT_ERROR("ERROR :: New file does not use the default extent size.");
+		}
+		file13.setExtentSize(16);
+		Page first = file13.allocatePage();
+		// Header, one bitmap page and the first extent of 16 pages
+		struct stat info;
+		if (stat(filename13.c_str(), &info) != 0 ||
+		    info.st_size < (off_t)(FileHeader::BITMAP_HEADER_SIZE + 17 * Page::SIZE))
+		{
+			PRINT_ERROR("ERROR :: First extent was not preallocated.");
+		}
+
+		std::vector<Page> run = file13.allocatePages(20);
+		if (run.size() != 20)
+		{
+			PRINT_ERROR("ERROR :: Wrong number of pages allocated in a run.");
+		}
+		for (i = 0; i < 20; i++)
+		{
+			if (run[i].page_number() != first.page_number() + 1 + i)
+			{
+				PRINT_ERROR("ERROR :: Pages allocated in a run are not consecutive.");
+			}
+			rid[i] = run[i].insertRecord("test.13");
+		}
+		std::vector<const Page*> batch;
+		for (i = 0; i < 20; i++)
+			batch.push_back(&run[i]);
+		file13.writePages(batch);
+		if (FileTest::header(file13).num_free_pages != 0)
+		{
+			PRINT_ERROR("ERROR :: Pages allocated in a run were counted as free.");
+		}
+		if (file13.allocatePage().page_number() != run[19].page_number() + 1)
+		{
+			PRINT_ERROR("ERROR :: Page allocated after a run is not past it.");
+		}
+	}
+	{
+		File file13 = File::open(filename13);
+		int pagesSeen = 0;
+		for (FileIterator iter = file13.begin(); iter != file13.end(); ++iter)
+			pagesSeen++;
+		if (pagesSeen != 22)
+		{
+			PRINT_ERROR("ERROR :: Pages allocated in a run are not all in use.");
+		}
+		Page last = file13.readPage(rid[19].page_number);
+		if (last.getRecord(rid[19]) != "test.13")
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	File::remove(filename13);
+
+	std::cout << "Test 25 passed" << "\n";
+}
+
+void test26()
+{
+	//Durability levels: files start batched, temporary files are never synced
+	const std::string filename14 = "test.14";
+	{
+		File file14 = File::create(filename14);
+		File temp = File::createTemp("test.14.tmp");
+		if (file14.durability() != File::BATCHED_SYNC || temp.durability() != File::NO_SYNC)
+		{
+			PRINT_ERROR("ERROR :: Files do not start with the right durability level.");
+		}
+		File copy = file14;
+		copy.setDurability(File::STRICT_SYNC);
+		if (file14.durability() != File::STRICT_SYNC)
+		{
+			PRINT_ERROR("ERROR :: Durability level is not shared by File objects for the file.");
+		}
+
+		//Strict files write queued pages right away
+		BufMgr syncMgr(4);
+		syncMgr.enableAsyncIo(2, PageIoQueue::THREAD_POOL);
+		for (i = 0; i < 8; i++)
+		{
+			syncMgr.allocPage(&file14, pid[i], page);
+			sprintf((char*)tmpbuf, "test.14 Page %d %7.1f", pid[i], (float)pid[i]);
+			rid[i] = page->insertRecord(tmpbuf);
+			syncMgr.unPinPage(&file14, pid[i], true);
+		}
+		syncMgr.flushFile(&file14);
+
+		//Strict files sync once per call that writes, batched files once per
+		//SYNC_BATCH_WRITES writes unless SYNC_BATCH_INTERVAL passes first
+		Page rewritten = file14.readPage(pid[0]);
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::uint64_t syncs = file14.syncCount();
+		file14.writePage(rewritten);
+		if (file14.syncCount() != syncs + 1)
+		{
+			PRINT_ERROR("ERROR :: Strict file was not synced once by a write.");
+		}
+		file14.setDurability(File::BATCHED_SYNC);
+		syncs = file14.syncCount();
+		for (int w = 0; w < File::SYNC_BATCH_WRITES - 1; w++)
+		{
+			file14.writePage(rewritten);
+		}
+		const std::uint64_t before_batch = file14.syncCount();
+		file14.writePage(rewritten);
+		if (std::chrono::steady_clock::now() - start < File::SYNC_BATCH_INTERVAL &&
+				(before_batch != syncs || file14.syncCount() != syncs + 1))
+		{
+			PRINT_ERROR("ERROR :: Batched file was not synced once per batch of writes.");
+		}
+
+		//Flushing from a partitioned buffer pool syncs once, not per partition
+		PartitionedBufMgr partMgr(8, 4);
+		for (i = 0; i < 4; i++)
+		{
+			partMgr.readPage(&file14, pid[i], page);
+			partMgr.unPinPage(&file14, pid[i], true);
+		}
+		syncs = file14.syncCount();
+		partMgr.flushFile(&file14);
+		if (file14.syncCount() != syncs + 1)
+		{
+			PRINT_ERROR("ERROR :: Partitioned flush did not sync the file once.");
+		}
+		file14.deletePage(pid[7]);
+		file14.sync();
+		syncs = file14.syncCount();
+		file14.sync();
+		if (file14.syncCount() != syncs)
+		{
+			PRINT_ERROR("ERROR :: File was synced with nothing written.");
+		}
+	}
+	{
+		File file14 = File::open(filename14);
+		if (file14.durability() != File::BATCHED_SYNC)
+		{
+			PRINT_ERROR("ERROR :: Reopened file does not start batched.");
+		}
+		for (i = 0; i < 7; i++)
+		{
+			sprintf((char*)tmpbuf, "test.14 Page %d %7.1f", pid[i], (float)pid[i]);
+			if (file14.readPage(pid[i]).getRecord(rid[i]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+	}
+	File::remove(filename14);
+
+	std::cout << "Test 26 passed" << "\n";
+}
+
+void test27()
+{
+	//Page checksums: a damaged page is caught on every read path
+	const char* check = "123456789";
+	if (Crc32c::extend(0, check, 9) != 0xe3069283 || Crc32c::extendSoftware(0, check, 9) != 0xe3069283)
+	{
+		PRINT_ERROR("ERROR :: CRC-32C of the check string is wrong.");
+	}
+	//Long inputs take the three-lane path where the CPU has SSE4.2
+	std::vector<char> block(Page::SIZE);
+	for (std::size_t j = 0; j < block.size(); j++)
+	{
+		block[j] = static_cast<char>(j * 7 + (j >> 8));
+	}
+	const std::size_t offsets[] = {0, 1, 3, 8, 13};
+	const std::size_t lengths[] = {0, 7, 64, 767, 768, 769, 3000, 8000};
+	for (std::size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++)
+	{
+		for (std::size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+		{
+			if (Crc32c::extend(0x1234, &block[offsets[o]], lengths[l]) !=
+					Crc32c::extendSoftware(0x1234, &block[offsets[o]], lengths[l]))
+			{
+				PRINT_ERROR("ERROR :: CRC-32C paths disagree.");
+			}
+		}
+	}
+	if (Crc32c::extend(0, &block[0], Page::SIZE) != Crc32c::extendSoftware(0, &block[0], Page::SIZE))
+	{
+		PRINT_ERROR("ERROR :: CRC-32C paths disagree on a whole page.");
+	}
+
+	const std::string filename15 = "test.15";
+	{
+		File file15 = File::create(filename15);
+		for (i = 0; i < 4; i++)
+		{
+			Page newPage = file15.allocatePage();
+			pid[i] = newPage.page_number();
+			rid[i] = newPage.insertRecord("test.15");
+			file15.writePage(newPage);
+		}
+	}
+	{
+		// Flip one bit in the record of the third page
+		std::fstream raw(filename15.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		const std::streamoff pos = FileHeader::BITMAP_HEADER_SIZE + pid[2] * Page::SIZE + Page::SIZE - 1;
+		char byte;
+		raw.seekg(pos);
+		raw.get(byte);
+		raw.seekp(pos);
+		raw.put(byte ^ 1);
+	}
+	{
+		File file15 = File::open(filename15);
+		file15.readPage(pid[1]);
+		try
+		{
+			file15.readPage(pid[2]);
+			PRINT_ERROR("ERROR :: Damaged page was read without error.");
+		}
+		catch(ChecksumMismatchException e)
+		{
+		}
+		try
+		{
+			std::vector<PageId> batch(pid, pid + 4);
+			file15.readPages(batch);
+			PRINT_ERROR("ERROR :: Damaged page was read in a batch without error.");
+		}
+		catch(ChecksumMismatchException e)
+		{
+		}
+		MappedFile mapped(filename15);
+		mapped.readPage(pid[3]);
+		try
+		{
+			mapped.readPage(pid[2]);
+			PRINT_ERROR("ERROR :: Damaged page was viewed without error.");
+		}
+		catch(ChecksumMismatchException e)
+		{
+		}
+		file15.deletePage(pid[2]);
+	}
+
+	//Bitmap files from before checksums have to be converted first
+	{
+		// Pages followed right after the header, and the checksum was unused
+		std::ifstream in(filename15.c_str(), std::ios::binary);
+		std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		in.close();
+		bytes.erase(sizeof(FileHeader), FileHeader::BITMAP_HEADER_SIZE - sizeof(FileHeader));
+		const std::uint32_t format = FileHeader::UNCHECKED_BITMAP_FORMAT;
+		const std::uint32_t next_page = 0;
+		std::memcpy(&bytes[0], &format, sizeof(format));
+		std::memcpy(&bytes[sizeof(FileHeader) + pid[1] * Page::SIZE + offsetof(PageHeader, checksum)],
+		            &next_page, sizeof(next_page));
+		std::ofstream out(filename15.c_str(), std::ios::binary | std::ios::trunc);
+		out.write(bytes.data(), bytes.size());
+	}
+	try
+	{
+		File file15 = File::open(filename15);
+		PRINT_ERROR("ERROR :: File from before checksums was opened.");
+	}
+	catch(FileFormatException e)
+	{
+	}
+	if (!File::convert(filename15) || File::convert(filename15))
+	{
+		PRINT_ERROR("ERROR :: File from before checksums was not converted once.");
+	}
+	{
+		File file15 = File::open(filename15);
+		for (i = 0; i < 4; i++)
+		{
+			if (i != 2 && file15.readPage(pid[i]).getRecord(rid[i]) != "test.15")
+			{
+				PRINT_ERROR("ERROR :: Converted page does not match.");
+			}
+		}
+	}
+	File::remove(filename15);
+
+	std::cout << "Test 27 passed" << "\n";
+}
+
+void test28()
+{
+	//Compressed files: pages live in variable-size slots found through the directory
+	const std::string filename16 = "test.16";
+	const PageId count = 2 * 511 + 10;	//spans three directory pages
+	std::vector<PageId> pages;
+	std::string noise(3000, ' ');
+	unsigned int seed = 28;
+	for (std::size_t j = 0; j < noise.size(); j++)
+	{
+		seed = seed * 1103515245 + 12345;
+		noise[j] = static_cast<char>(seed >> 16);
+	}
+	{
+		File file16 = File::createCompressed(filename16);
+		for (PageId n = 0; n < count; n++)
+		{
+			Page newPage = file16.allocatePage();
+			sprintf(tmpbuf, "test.16 Page %u %7.1f", newPage.page_number(), (float)newPage.page_number());
+			newPage.insertRecord(tmpbuf);
+			file16.writePage(newPage);
+			pages.push_back(newPage.page_number());
+		}
+		struct stat info;
+		::stat(filename16.c_str(), &info);
+		if (info.st_size >= static_cast<off_t>(count * Page::SIZE / 4))
+		{
+			PRINT_ERROR("ERROR :: Compressed file is not much smaller than its pages.");
+		}
+
+		// Outgrows its slot and has to move.
+		Page grown = file16.readPage(pages[5]);
+		rid[0] = grown.insertRecord(noise);
+		file16.writePage(grown);
+
+		file16.deletePage(pages[7]);
+		if (file16.allocatePage().page_number() != pages[7])
+		{
+			PRINT_ERROR("ERROR :: Deleted page of a compressed file was not reused.");
+		}
+		file16.deletePage(pages[7]);
+	}
+	{
+		File file16 = File::open(filename16);
+		if (file16.codec() == NULL || file16.codec()->id() != LzPageCodec::ID)
+		{
+			PRINT_ERROR("ERROR :: Compressed file lost its codec.");
+		}
+		PageId found = 0;
+		for (FileIterator iter = file16.begin(); iter != file16.end(); ++iter)
+		{
+			Page page = *iter;
+			sprintf(tmpbuf, "test.16 Page %u %7.1f", page.page_number(), (float)page.page_number());
+			if (*page.begin() != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Contents of compressed page do not match.");
+			}
+			found++;
+		}
+		if (found != count - 1)
+		{
+			PRINT_ERROR("ERROR :: Wrong number of pages in compressed file.");
+		}
+		if (file16.readPage(pages[5]).getRecord(rid[0]) != noise)
+		{
+			PRINT_ERROR("ERROR :: Page that moved to a new slot does not match.");
+		}
+
+		// Pages are read outside the latch, so reads must notice a slot that
+		// is rewritten, moved or released under them.  One page is rewritten
+		// in place; the deleted one is brought back, outgrows its slot and is
+		// deleted again.
+		Page grown = file16.readPage(pages[5]);
+		Page shrunk = grown;
+		shrunk.deleteRecord(rid[0]);
+		std::string first[2];
+		for (int k = 0; k < 2; k++)
+		{
+			sprintf(tmpbuf, "test.16 Page %u %7.1f", pages[5 + 2 * k], (float)pages[5 + 2 * k]);
+			first[k] = tmpbuf;
+		}
+		std::atomic<bool> done(false);
+		std::atomic<int> failures(0);
+		std::vector<std::thread> readers;
+		for (int t = 0; t < 4; t++)
+		{
+			readers.push_back(std::thread([&, t]() {
+				const int k = t % 2;
+				while (!done)
+				{
+					try
+					{
+						// A page just brought back is empty until written.
+						Page page = file16.readPage(pages[5 + 2 * k]);
+						if (page.begin() != page.end() && *page.begin() != first[k])
+						{
+							failures++;
+						}
+					}
+					catch (InvalidPageException&)
+					{
+					}
+					catch (BadgerDbException&)
+					{
+						failures++;
+					}
+				}
+			}));
+		}
+		for (int round = 0; round < 500; round++)
+		{
+			file16.writePage(round % 2 == 0 ? shrunk : grown);
+			Page back = file16.allocatePage();
+			if (back.page_number() != pages[7])
+			{
+				PRINT_ERROR("ERROR :: Deleted page of a compressed file was not reused.");
+			}
+			back.insertRecord(first[1]);
+			file16.writePage(back);
+			back.insertRecord(noise);
+			file16.writePage(back);
+			file16.deletePage(pages[7]);
+		}
+		file16.writePage(grown);
+		done = true;
+		for (std::size_t t = 0; t < readers.size(); t++)
+		{
+			readers[t].join();
+		}
+		if (failures != 0)
+		{
+			PRINT_ERROR("ERROR :: Compressed page read during a write came back torn.");
+		}
+		std::vector<PageId> batch(pages.begin() + 500, pages.begin() + 520);
+		if (file16.readPages(batch)[19].page_number() != pages[519])
+		{
+			PRINT_ERROR("ERROR :: Batch read from compressed file is wrong.");
+		}
+		try
+		{
+			file16.readPage(pages[7]);
+			PRINT_ERROR("ERROR :: Deleted page of a compressed file was read.");
+		}
+		catch(InvalidPageException e)
+		{
+		}
+		try
+		{
+			MappedFile mapped(filename16);
+			PRINT_ERROR("ERROR :: Compressed file was mapped.");
+		}
+		catch(FileFormatException e)
+		{
+		}
+	}
+	if (File::convert(filename16))
+	{
+		PRINT_ERROR("ERROR :: Compressed file was converted.");
+	}
+	File::remove(filename16);
+
+	std::cout << "Test 28 passed" << "\n";
+}
+
+void test29()
+{
+	//Hole punching and compaction: deleted pages give their space back, free tail pages are cut off
+	const std::string filename17 = "test.17";
+	const std::string filename18 = "test.18";
+	struct stat info;
+	// Incompressible, so compressed pages take most of a page too
+	std::string noise(3000, ' ');
+	unsigned int seed = 29;
+	for (std::size_t j = 0; j < noise.size(); j++)
+	{
+		seed = seed * 1103515245 + 12345;
+		noise[j] = static_cast<char>(seed >> 16);
+	}
+	{
+		File file17 = File::create(filename17);
+		File file18 = File::createCompressed(filename18);
+		File* files[2] = {&file17, &file18};
+		for (int f = 0; f < 2; f++)
+		{
+			std::vector<Page> pages = files[f]->allocatePages(40);
+			std::vector<const Page*> batch;
+			for (i = 0; i < 40; i++)
+			{
+				sprintf(tmpbuf, "test.17 Page %d %7.1f", i + 1, (float)(i + 1));
+				pages[i].insertRecord(tmpbuf);
+				pages[i].insertRecord(noise);
+				batch.push_back(&pages[i]);
+			}
+			files[f]->writePages(batch);
+			if (f == 0)
+			{
+				// Pages start on filesystem blocks, so a lone deleted page
+				// gives back all its space where holes can be punched
+				::stat(filename17.c_str(), &info);
+				const blkcnt_t blocks = info.st_blocks;
+				files[f]->deletePage(11);
+				::stat(filename17.c_str(), &info);
+				const off_t freed = (blocks - info.st_blocks) * 512;
+				if (freed != 0 && freed != static_cast<off_t>(Page::SIZE))
+				{
+					PRINT_ERROR("ERROR :: Deleted page did not give back all its space.");
+				}
+			}
+			// Pages 11 to 30 in the middle, 35 to 40 at the end
+			for (PageId n = f == 0 ? 12 : 11; n <= 40; n++)
+			{
+				if (n <= 30 || n >= 35)
+				{
+					files[f]->deletePage(n);
+				}
+			}
+			try
+			{
+				files[f]->readPage(20);
+				PRINT_ERROR("ERROR :: Deleted page was read.");
+			}
+			catch(InvalidPageException e)
+			{
+			}
+			if (files[f]->compact() == 0)
+			{
+				PRINT_ERROR("ERROR :: Compaction reclaimed nothing.");
+			}
+			if (files[f]->compact() != 0)
+			{
+				PRINT_ERROR("ERROR :: Second compaction reclaimed space.");
+			}
+		}
+		::stat(filename17.c_str(), &info);
+		if (info.st_size != static_cast<off_t>(FileHeader::BITMAP_HEADER_SIZE + 35 * Page::SIZE))
+		{
+			PRINT_ERROR("ERROR :: Free pages at the end of the file were not cut off.");
+		}
+	}
+	const std::string* names[2] = {&filename17, &filename18};
+	for (int f = 0; f < 2; f++)
+	{
+		File file = File::open(*names[f]);
+		int found = 0;
+		for (FileIterator iter = file.begin(); iter != file.end(); ++iter)
+		{
+			Page page = *iter;
+			sprintf(tmpbuf, "test.17 Page %u %7.1f", page.page_number(), (float)page.page_number());
+			if (*page.begin() != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Page changed by compaction.");
+			}
+			found++;
+		}
+		if (found != 14)
+		{
+			PRINT_ERROR("ERROR :: Wrong number of pages after compaction.");
+		}
+		if (file.allocatePage().page_number() != 11)
+		{
+			PRINT_ERROR("ERROR :: Punched page was not reused.");
+		}
+		PageId next = 0;
+		for (i = 0; i < 20; i++)
+		{
+			next = file.allocatePage().page_number();
+		}
+		if (next != 35)
+		{
+			PRINT_ERROR("ERROR :: Page numbers cut off were not handed out again.");
+		}
+	}
+	File::remove(filename17);
+	File::remove(filename18);
+
+	std::cout << "Test 29 passed" << "\n";
+}
+
+void test30()
+{
+	//Reorganizing a compressed file puts its slots back in scan order
+	const std::string filename19 = "test.19";
+	const PageId count = 1100;	//three directory pages, the later two among the slots
+	std::string noise(2000, ' ');
+	unsigned int seed = 30;
+	for (std::size_t j = 0; j < noise.size(); j++)
+	{
+		seed = seed * 1103515245 + 12345;
+		noise[j] = static_cast<char>(seed >> 16);
+	}
+	{
+		File file19 = File::createCompressed(filename19);
+		for (PageId n = 1; n <= count; n++)
+		{
+			Page newPage = file19.allocatePage();
+			sprintf(tmpbuf, "test.19 Page %u %7.1f", n, (float)n);
+			newPage.insertRecord(tmpbuf);
+			file19.writePage(newPage);
+		}
+		if (file19.reorganize() != 0)
+		{
+			PRINT_ERROR("ERROR :: Compressed file written in order was reorganized.");
+		}
+		// Grown pages move to the end, pages allocated again land in free space
+		for (PageId n = 1; n <= count; n += 3)
+		{
+			Page page = file19.readPage(n);
+			page.insertRecord(noise);
+			file19.writePage(page);
+		}
+		for (PageId n = 2; n <= count; n += 50)
+		{
+			file19.deletePage(n);
+		}
+		for (PageId n = 2; n <= count; n += 50)
+		{
+			Page newPage = file19.allocatePage();
+			sprintf(tmpbuf, "test.19 Page %u %7.1f", newPage.page_number(), (float)newPage.page_number());
+			newPage.insertRecord(tmpbuf);
+			file19.writePage(newPage);
+		}
+		ScanLocality before = file19.scanLocality();
+		if (before.pages != count || before.sequential == count || before.backward == 0)
+		{
+			PRINT_ERROR("ERROR :: Churned compressed file is still in scan order.");
+		}
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		const off_t rate = 20 << 20;
+		const off_t moved = file19.reorganize(rate);
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		ScanLocality after = file19.scanLocality();
+		if (moved == 0 || after.pages != count || after.sequential != count ||
+				after.backward != 0 || after.span != after.bytes + static_cast<off_t>(2 * Page::SIZE))
+		{
+			PRINT_ERROR("ERROR :: Reorganized compressed file is not in scan order.");
+		}
+		if (elapsed < 0.9 * moved / rate)
+		{
+			PRINT_ERROR("ERROR :: Reorganizing moved data faster than allowed.");
+		}
+		struct stat info;
+		::stat(filename19.c_str(), &info);
+		if (info.st_size != static_cast<off_t>(sizeof(FileHeader) + 3 * Page::SIZE) + after.bytes)
+		{
+			PRINT_ERROR("ERROR :: Reorganized compressed file is not cut back.");
+		}
+		ScanLocality locality = file1ptr->scanLocality();
+		if (file1ptr->reorganize() != 0 || locality.sequential + locality.backward > locality.pages)
+		{
+			PRINT_ERROR("ERROR :: Plain file was reorganized.");
+		}
+	}
+	{
+		File file19 = File::open(filename19);
+		PageId found = 0;
+		for (FileIterator iter = file19.begin(); iter != file19.end(); ++iter)
+		{
+			Page page = *iter;
+			sprintf(tmpbuf, "test.19 Page %u %7.1f", page.page_number(), (float)page.page_number());
+			PageIterator record = page.begin();
+			if (*record != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Page changed by reorganizing.");
+			}
+			const bool grown = page.page_number() % 3 == 1 && page.page_number() % 50 != 2;
+			if (grown && *++record != noise)
+			{
+				PRINT_ERROR("ERROR :: Grown page changed by reorganizing.");
+			}
+			found++;
+		}
+		if (found != count || file19.scanLocality().sequential != count)
+		{
+			PRINT_ERROR("ERROR :: Reorganized file read back wrong.");
+		}
+	}
+	File::remove(filename19);
+
+	std::cout << "Test 30 passed" << "\n";
+}
+
+#if defined(__cpp_impl_coroutine)
+template <class Manager>
+AsyncTask asyncLookups(Manager& asyncMgr, File* file, const PageId first, const PageId last, std::atomic<int>& errors)
+{
+	char expected[100];
+	for (PageId n = first; n <= last; n += 4)
+	{
+		PageHandle handle = co_await asyncMgr.readPageAsync(file, n);
+		sprintf(expected, "test.20 Page %u", n);
+		if (*handle->begin() != expected)
+			errors++;
+	}
+}
+
+AsyncTask asyncMissingPage(BufMgr& asyncMgr, File* file, const PageId pageNo)
+{
+	PageHandle handle = co_await asyncMgr.readPageAsync(file, pageNo);
+}
+
+void test31()
+{
+	//Coroutines park their misses and resume as their reads through the I/O queue finish
+	const std::string filename20 = "test.20";
+	const PageId count = 64;
+	{
+		File file20 = File::create(filename20);
+		for (PageId n = 1; n <= count; n++)
+		{
+			Page newPage = file20.allocatePage();
+			sprintf(tmpbuf, "test.20 Page %u", newPage.page_number());
+			newPage.insertRecord(tmpbuf);
+			file20.writePage(newPage);
+		}
+
+		BufMgr asyncMgr(count);
+		std::atomic<int> errors(0);
+		AsyncScheduler scheduler(8, PageIoQueue::THREAD_POOL);
+		for (PageId c = 1; c <= 4; c++)
+			scheduler.spawn(asyncLookups(asyncMgr, &file20, c, count, errors));
+		scheduler.run();
+		BufStats stats = asyncMgr.getBufStats();
+		if (errors != 0 || stats.accesses != (int) count || stats.diskreads != (int) count)
+		{
+			PRINT_ERROR("ERROR :: Coroutines read the wrong pages.");
+		}
+		//Each coroutine has one read in flight at a time, so it takes part in count/4 starts
+		const std::size_t batches = scheduler.batches();
+		if (batches < count / 4 || batches > count)
+		{
+			PRINT_ERROR("ERROR :: Misses of the coroutines were not started on the I/O queue.");
+		}
+
+		//Resident pages are pinned without a read; every handle gave its pin back
+		scheduler.spawn(asyncLookups(asyncMgr, &file20, 1, count, errors));
+		scheduler.run();
+		if (errors != 0 || scheduler.batches() != batches)
+		{
+			PRINT_ERROR("ERROR :: Resident pages should not have been read again.");
+		}
+		asyncMgr.flushFile(&file20);
+
+		//Coroutines missing on the same page share one read
+		{
+			BufMgr sharedMgr(count);
+			AsyncScheduler shared(8, PageIoQueue::THREAD_POOL);
+			shared.spawn(asyncLookups(sharedMgr, &file20, 1, count, errors));
+			shared.spawn(asyncLookups(sharedMgr, &file20, 1, count, errors));
+			shared.run();
+			stats = sharedMgr.getBufStats();
+			if (errors != 0 || stats.diskreads != (int) count / 4 || stats.accesses != (int) count / 2)
+			{
+				PRINT_ERROR("ERROR :: Coroutines waiting on the same page should share its read.");
+			}
+			sharedMgr.flushFile(&file20);
+		}
+
+		//Misses in the second-tier caches are not read from disk
+		{
+			BufMgr cachedMgr(4);
+			cachedMgr.enableCompressedCache(1 << 20);
+			AsyncScheduler cached(8, PageIoQueue::THREAD_POOL);
+			cached.spawn(asyncLookups(cachedMgr, &file20, 1, count, errors));
+			cached.run();
+			cachedMgr.clearBufStats();
+			cached.spawn(asyncLookups(cachedMgr, &file20, 1, count, errors));
+			cached.run();
+			if (errors != 0 || cachedMgr.getBufStats().diskreads != 0)
+			{
+				PRINT_ERROR("ERROR :: Coroutines should have found evicted pages in the caches.");
+			}
+			cachedMgr.flushFile(&file20);
+		}
+
+		//A failed read is rethrown by run() and leaves no page pinned
+		scheduler.spawn(asyncMissingPage(asyncMgr, &file20, count + 100));
+		scheduler.spawn(asyncLookups(asyncMgr, &file20, 2, count, errors));
+		try
+		{
+			scheduler.run();
+			PRINT_ERROR("ERROR :: Reading a missing page from a coroutine should fail.");
+		}
+		catch(InvalidPageException e)
+		{
+		}
+		if (errors != 0)
+		{
+			PRINT_ERROR("ERROR :: Coroutines next to a failed read read the wrong pages.");
+		}
+		asyncMgr.flushFile(&file20);
+
+		//Threads with a scheduler each share a partitioned pool
+		PartitionedBufMgr partMgr(count / 2, 2);
+		std::vector<std::thread> threads;
+		for (PageId t = 1; t <= 4; t++)
+		{
+			threads.push_back(std::thread([&partMgr, &file20, &errors, t]() {
+				AsyncScheduler own(4, PageIoQueue::THREAD_POOL);
+				own.spawn(asyncLookups(partMgr, &file20, t, count, errors));
+				own.spawn(asyncLookups(partMgr, &file20, t, count, errors));
+				own.run();
+			}));
+		}
+		for (std::size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+		if (errors != 0 || partMgr.getBufStats().accesses != (int) (2 * count))
+		{
+			PRINT_ERROR("ERROR :: Coroutines read the wrong pages through the partitioned pool.");
+		}
+		partMgr.flushFile(&file20);
+	}
+	File::remove(filename20);
+
+	std::cout << "Test 31 passed" << "\n";
+}
+#endif
@@ -0,0 +1,176 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "exceptions/checksum_mismatch_exception.h"
+#include "exceptions/file_format_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/io_error_exception.h"
+#include "file_iterator.h"
+
+namespace badgerdb {
+
+namespace {
+
+int adviceFor(const MappedFile::AccessHint hint) {
+  switch (hint) {
+    case MappedFile::SEQUENTIAL:
+      return MADV_SEQUENTIAL;
+    case MappedFile::RANDOM:
+      return MADV_RANDOM;
+    case MappedFile::WILLNEED:
+      return MADV_WILLNEED;
+    case MappedFile::DONTNEED:
+      return MADV_DONTNEED;
+    default:
+      return MADV_NORMAL;
+  }
+}
+
+}
+
+MappedFile::MappedFile(const std::string& filename)
+    : filename_(filename), base_(NULL), length_(0), mapped_pages_(0) {
+  const int fd = ::open(filename_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      throw FileNotFoundException(filename_);
+    }
+    throw IoErrorException(filename_, "open", errno);
+  }
+  struct stat info;
+  if (::fstat(fd, &info) != 0) {
+    const int error = errno;
+    ::close(fd);
+    throw IoErrorException(filename_, "fstat", error);
+  }
+  length_ = info.st_size;
+  if (length_ < sizeof(FileHeader)) {
+    ::close(fd);
+    throw IoErrorException(filename_, "mmap", EINVAL);
+  }
+  void* mapping = ::mmap(NULL, length_, PROT_READ, MAP_SHARED, fd, 0);
+  const int error = errno;
+  // The mapping keeps the file referenced.
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throw IoErrorException(filename_, "mmap", error);
+  }
+  base_ = static_cast<char*>(mapping);
+
+  std::memcpy(&header_, base_, sizeof(header_));
+  if (header_.format != FileHeader::BITMAP_FORMAT) {
+    ::munmap(base_, length_);
+    throw FileFormatException(filename_);
+  }
+  // Count the page slots in the mapping, less the bitmap pages among them.
+  const std::size_t slots =
+      length_ > FileHeader::BITMAP_HEADER_SIZE
+          ? (length_ - FileHeader::BITMAP_HEADER_SIZE) / Page::SIZE
+          : 0;
+  const std::size_t maps = (slots + File::PAGES_PER_MAP) /
+                           (File::PAGES_PER_MAP + 1);
+  mapped_pages_ = slots - maps + 1;
+  if (mapped_pages_ > header_.num_pages) {
+    mapped_pages_ = header_.num_pages;
+  }
+}
+
+MappedFile::~MappedFile() {
+  ::munmap(base_, length_);
+}
+
+PageView MappedFile::readPage(const PageId page_number) const {
+  if (page_number == Page::INVALID_NUMBER || page_number >= mapped_pages_) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  if (!isAllocated(page_number)) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const char* raw = base_ + pagePosition(page_number);
+  const PageHeader* header = reinterpret_cast<const PageHeader*>(raw);
+  if (header->checksum != Page::checksum(*header, raw + sizeof(PageHeader))) {
+    throw ChecksumMismatchException(page_number, filename_);
+  }
+  return view(page_number);
+}
+
+void MappedFile::advise(const AccessHint hint) {
+  if (::madvise(base_, length_, adviceFor(hint)) != 0) {
+    throw IoErrorException(filename_, "madvise", errno);
+  }
+}
+
+void MappedFile::advise(const PageId first_page, const PageId num_pages,
+                        const AccessHint hint) {
+  if (num_pages == 0 || first_page == Page::INVALID_NUMBER ||
+      first_page >= mapped_pages_) {
+    return;
+  }
+  // madvise() works on whole OS pages, so round the range out to them.
+  const std::size_t os_page = ::sysconf(_SC_PAGESIZE);
+  const std::size_t start = pagePosition(first_page) / os_page * os_page;
+  const PageId last_page = num_pages < mapped_pages_ - first_page
+                               ? first_page + num_pages - 1
+                               : mapped_pages_ - 1;
+  std::size_t end = pagePosition(last_page) + Page::SIZE;
+  end = end < length_ ? end : length_;
+  if (::madvise(base_ + start, end - start, adviceFor(hint)) != 0) {
+    throw IoErrorException(filename_, "madvise", errno);
+  }
+}
+
+FileIterator MappedFile::begin() const {
+  return FileIterator(this);
+}
+
+FileIterator MappedFile::end() const {
+  return FileIterator(this, Page::INVALID_NUMBER);
+}
+
+bool MappedFile::isAllocated(const PageId page_number) const {
+  const std::size_t bit = page_number - 1;
+  const unsigned char* bitmap = reinterpret_cast<const unsigned char*>(
+      base_ + mapPosition(bit / File::PAGES_PER_MAP));
+  const std::size_t byte = bit % File::PAGES_PER_MAP / 8;
+  return (bitmap[byte] & (1 << (bit % 8))) != 0;
+}
+
+PageId MappedFile::nextUsedPage(const PageId page_number) const {
+  // Pages appended since the file was mapped are out of reach.
+  for (PageId next = page_number + 1; next < mapped_pages_; ++next) {
+    if (isAllocated(next)) {
+      return next;
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
+PageView MappedFile::view(const PageId page_number) const {
+  const char* page = base_ + pagePosition(page_number);
+  return PageView(reinterpret_cast<const PageHeader*>(page),
+                  page + sizeof(PageHeader));
+}
+
+Page MappedFile::copyPage(const PageId page_number) const {
+  const char* raw = base_ + pagePosition(page_number);
+  Page page;
+  std::memcpy(&page.header_, raw, sizeof(page.header_));
+  page.data_.assign(raw + sizeof(page.header_), Page::DATA_SIZE);
+  return page;
+}
+
+}
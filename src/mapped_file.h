@@ -0,0 +1,194 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "file.h"
+#include "page.h"
+
+namespace badgerdb {
+
+class FileIterator;
+
+/**
+ * @brief Read-only access to a file of pages through a memory mapping.
+ *
+ * Pages are handed out as views into the mapping, so reading a page takes
+ * neither a system call nor a copy; the kernel faults pages in on first
+ * touch, steered by advise().  Meant for files that are only read, such as
+ * analytic tables: the file header and size are taken when the file is
+ * mapped, so pages added afterwards are not visible, and pages changed
+ * through a File while mapped may be seen half-written.
+ *
+ * Views stay valid as long as the MappedFile.
+ */
+class MappedFile {
+ public:
+  /**
+   * Access patterns for advise(), passed on to madvise().
+   */
+  enum AccessHint {
+    /** No particular pattern */
+    NORMAL,
+    /** Pages are read in order, so read ahead aggressively */
+    SEQUENTIAL,
+    /** Pages are read in no particular order, so don't read ahead */
+    RANDOM,
+    /** Pages will be needed soon, so start reading them in */
+    WILLNEED,
+    /** Pages won't be needed soon, so the kernel may drop them */
+    DONTNEED
+  };
+
+  /**
+   * Maps an existing file.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException  If the file doesn't exist.
+   * @throws  FileFormatException    If the file needs File::convert() first,
+   *                                 or is compressed.
+   * @throws  IoErrorException       If the file can not be mapped.
+   */
+  explicit MappedFile(const std::string& filename);
+
+  /**
+   * Unmaps the file.
+   */
+  ~MappedFile();
+
+  /**
+   * Returns a view of an existing page.
+   *
+   * @param page_number   Number of page to read.
+   * @return  View of the page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  ChecksumMismatchException  If the page is damaged.
+   */
+  PageView readPage(const PageId page_number) const;
+
+  /**
+   * Tells the kernel how the whole file will be read.
+   *
+   * @param hint  Expected access pattern.
+   */
+  void advise(const AccessHint hint);
+
+  /**
+   * Tells the kernel how a range of pages will be read.
+   *
+   * @param first_page  Number of first page of the range.
+   * @param num_pages   Number of pages in the range.
+   * @param hint        Expected access pattern.
+   */
+  void advise(const PageId first_page, const PageId num_pages,
+              const AccessHint hint);
+
+  /**
+   * Returns the header of the file as it was when mapped.
+   */
+  const FileHeader& header() const { return header_; }
+
+  /**
+   * Returns the name of the file.
+   */
+  const std::string& filename() const { return filename_; }
+
+  /**
+   * Returns an iterator at the first page in the file.  Dereferencing it
+   * copies the page; use FileIterator::view() to walk without copying.
+   *
+   * @return  Iterator at first page of file.
+   */
+  FileIterator begin() const;
+
+  /**
+   * Returns an iterator representing the page after the last page in the file.
+   * This iterator should not be dereferenced.
+   *
+   * @return  Iterator representing page after the last page in the file.
+   */
+  FileIterator end() const;
+
+ private:
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+
+  /**
+   * Returns a view of the page with the given number.  No checks are
+   * performed.
+   */
+  PageView view(const PageId page_number) const;
+
+  /**
+   * Returns a copy of the page with the given number.  No checks are
+   * performed.
+   */
+  Page copyPage(const PageId page_number) const;
+
+  /**
+   * Returns true if the page is marked in use in the mapped bitmap.  No bounds
+   * checking is performed.
+   */
+  bool isAllocated(const PageId page_number) const;
+
+  /**
+   * Returns the number of the first used page after the given one that lies
+   * inside the mapping, or Page::INVALID_NUMBER if there is none.
+   */
+  PageId nextUsedPage(const PageId page_number) const;
+
+  /**
+   * Returns the offset of the page with the given number in the file, past
+   * the bitmap pages before it; see File.
+   */
+  static std::size_t pagePosition(const PageId page_number) {
+    const std::size_t slot =
+        (page_number - 1) + (page_number - 1) / File::PAGES_PER_MAP + 1;
+    return FileHeader::BITMAP_HEADER_SIZE + slot * Page::SIZE;
+  }
+
+  /**
+   * Returns the offset of the bitmap page of the given group in the file.
+   */
+  static std::size_t mapPosition(const PageId group) {
+    return FileHeader::BITMAP_HEADER_SIZE +
+           static_cast<std::size_t>(group) * (File::PAGES_PER_MAP + 1) *
+               Page::SIZE;
+  }
+
+  /**
+   * Name of the file.
+   */
+  std::string filename_;
+
+  /**
+   * Start of the mapping.
+   */
+  char* base_;
+
+  /**
+   * Length of the mapping in bytes.
+   */
+  std::size_t length_;
+
+  /**
+   * Header of the file when it was mapped.
+   */
+  FileHeader header_;
+
+  /**
+   * Number of pages that lie wholly inside the mapping.
+   */
+  PageId mapped_pages_;
+
+  friend class FileIterator;
+};
+
+}
@@ -7,6 +7,7 @@
 
 #include <cassert>
 
+#include "crc32c.h"
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
 #include "exceptions/invalid_slot_exception.h"
@@ -20,13 +21,20 @@ Page::Page() {
   initialize();
 }
 
+std::uint32_t Page::checksum(const PageHeader& header, const char* data) {
+  PageHeader unsealed = header;
+  unsealed.checksum = 0;
+  const std::uint32_t crc = Crc32c::extend(0, &unsealed, sizeof(unsealed));
+  return Crc32c::extend(crc, data, DATA_SIZE);
+}
+
 void Page::initialize() {
   header_.free_space_lower_bound = 0;
   header_.free_space_upper_bound = DATA_SIZE;
   header_.num_slots = 0;
   header_.num_free_slots = 0;
   header_.current_page_number = INVALID_NUMBER;
-  header_.next_page_number = INVALID_NUMBER;
+  header_.checksum = 0;
   data_.assign(DATA_SIZE, char());
 }
 
@@ -202,4 +210,26 @@ PageIterator Page::end() {
   return PageIterator(this, end_record_id);
 }
 
+RecordView PageView::getRecord(const RecordId& record_id) const {
+  // Same checks as Page::validateRecordId().
+  if (record_id.page_number != page_number()) {
+    throw InvalidRecordException(record_id, page_number());
+  }
+  const PageSlot& slot = getSlot(record_id.slot_number);
+  if (!slot.used) {
+    throw InvalidRecordException(record_id, page_number());
+  }
+  const RecordView record = {data_ + slot.item_offset, slot.item_length};
+  return record;
+}
+
+PageIterator PageView::begin() const {
+  return PageIterator(*this);
+}
+
+PageIterator PageView::end() const {
+  const RecordId& end_record_id = {page_number(), Page::INVALID_SLOT};
+  return PageIterator(*this, end_record_id);
+}
+
 }
@@ -20,7 +20,7 @@ namespace badgerdb {
  * @brief Header metadata in a page.
  *
  * Header metadata in each page which tracks where space has been used and
- * contains a pointer to the next page in the file.
+ * holds a checksum of the page as written to disk.
  */
 struct PageHeader {
   /**
@@ -53,9 +53,11 @@ struct PageHeader {
   PageId current_page_number;
 
   /**
-   * Number of the next used page in the file.
+   * CRC-32C of the page as last written to disk, see Page::checksum().  This
+   * field held the number of the next used page in files from before
+   * allocation bitmaps; File::convert() fills it in.
    */
-  PageId next_page_number;
+  std::uint32_t checksum;
 
   /**
    * Returns true if this page header is equal to the other.
@@ -66,8 +68,7 @@ struct PageHeader {
   bool operator==(const PageHeader& rhs) const {
     return num_slots == rhs.num_slots &&
         num_free_slots == rhs.num_free_slots &&
-        current_page_number == rhs.current_page_number &&
-        next_page_number == rhs.next_page_number;
+        current_page_number == rhs.current_page_number;
   }
 };
 
@@ -94,6 +95,110 @@ struct PageSlot {
 
 class PageIterator;
 
+/**
+ * @brief Bytes of a record inside a page, not copied.
+ *
+ * Valid only as long as the memory of the page it points into.
+ */
+struct RecordView {
+  /**
+   * First byte of the record.
+   */
+  const char* data;
+
+  /**
+   * Length of the record in bytes.
+   */
+  std::size_t length;
+
+  /**
+   * Returns a copy of the record.
+   */
+  std::string toString() const { return std::string(data, length); }
+};
+
+/**
+ * @brief Read-only view of a page image held elsewhere, such as in a Page or
+ *        in the mapping of a MappedFile.
+ *
+ * Views are cheap to copy and never copy the page.  They are valid only as
+ * long as the memory they point into.
+ */
+class PageView {
+ public:
+  /**
+   * Constructs an empty view.
+   */
+  PageView()
+      : header_(NULL),
+        data_(NULL) {
+  }
+
+  /**
+   * Constructs a view of the page with the given header and data area.
+   *
+   * @param header  Header of the page.
+   * @param data    Data area of the page, Page::DATA_SIZE bytes.
+   */
+  PageView(const PageHeader* header, const char* data)
+      : header_(header),
+        data_(data) {
+  }
+
+  /**
+   * Returns the record with the given ID without copying it.
+   *
+   * @param record_id  ID of the record to return.
+   * @return  The record.
+   * @throws  InvalidRecordException  Thrown if the ID has a bad page or slot
+   *                                  number.
+   */
+  RecordView getRecord(const RecordId& record_id) const;
+
+  /**
+   * Returns the page's number in its file.
+   */
+  PageId page_number() const { return header_->current_page_number; }
+
+  /**
+   * Returns the number of slots allocated on the page.
+   */
+  SlotId num_slots() const { return header_->num_slots; }
+
+  /**
+   * Returns the slot with the given number, allocated or not.
+   *
+   * @param slot_number   Number of slot to retrieve.
+   * @return  The slot.
+   */
+  const PageSlot& getSlot(const SlotId slot_number) const {
+    return *reinterpret_cast<const PageSlot*>(
+        data_ + (slot_number - 1) * sizeof(PageSlot));
+  }
+
+  /**
+   * Returns an iterator at the first record in the page.
+   */
+  PageIterator begin() const;
+
+  /**
+   * Returns an iterator representing the record after the last record in the
+   * page.  This iterator should not be dereferenced.
+   */
+  PageIterator end() const;
+
+ private:
+  /**
+   * Header of the page.
+   */
+  const PageHeader* header_;
+
+  /**
+   * Data area of the page.
+   */
+  const char* data_;
+};
+
 /**
  * @brief Class which represents a fixed-size database page containing records.
  *
@@ -127,6 +232,18 @@ class Page {
    */
   static const SlotId INVALID_SLOT = 0;
 
+  /**
+   * Returns the checksum of a page image: the CRC-32C of the header, with its
+   * checksum field taken as zero, followed by the data.  File stores it in
+   * the header of every page it writes and checks it on every read of a used
+   * page.
+   *
+   * @param header  Header of the page.
+   * @param data    DATA_SIZE bytes of page data.
+   * @return  Checksum of the page.
+   */
+  static std::uint32_t checksum(const PageHeader& header, const char* data);
+
   /**
    * Constructs a new, uninitialized page.
    */
@@ -193,11 +310,12 @@ class Page {
   PageId page_number() const { return header_.current_page_number; }
 
   /**
-   * Returns the number of the next used page this page in its file.
+   * Returns a read-only view of this page.  The view is invalidated when the
+   * page is destroyed or assigned to.
    *
-   * @return  Page number of next used page in file.
+   * @return  View of the page.
    */
-  PageId next_page_number() const { return header_.next_page_number; }
+  PageView view() const { return PageView(&header_, data_.data()); }
 
   /**
    * Returns an iterator at the first record in the page.
@@ -229,15 +347,6 @@ class Page {
     header_.current_page_number = new_page_number;
   }
 
-  /**
-   * Sets the number of the next used page after this page in its file.
-   *
-   * @param next_page_number  Page number of next used page in file.
-   */
-  void set_next_page_number(const PageId new_next_page_number) {
-    header_.next_page_number = new_next_page_number;
-  }
-
   /**
    * Deletes the record with the given ID.  Page is compacted upon delete to
    * ensure that data of all records is contiguous.  Slot array is compacted if
@@ -333,6 +442,9 @@ class Page {
   std::string data_;
 
   friend class File;
+  friend class MappedFile;
+  friend class CompressedPageCache;
+  friend class PageCacheFile;
   friend class PageIterator;
   friend class PageTest;
   friend class BufferTest;
@@ -0,0 +1,123 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_cache_file.h"
+
+#include <cstdio>
+
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+
+PageCacheFile::PageCacheFile(const std::string& path,
+                             const std::uint32_t numSlots)
+    : path_(path),
+      numSlots_(numSlots),
+      stream_(path.c_str(), std::fstream::in | std::fstream::out |
+                                std::fstream::binary | std::fstream::trunc),
+      slotKeys_(numSlots) {
+  if (!stream_) {
+    throw FileNotFoundException(path_);
+  }
+  freeSlots_.reserve(numSlots);
+  // Hand out low slots first so a lightly used cache file stays small.
+  for (std::uint32_t slot = numSlots; slot > 0; --slot) {
+    freeSlots_.push_back(slot - 1);
+  }
+}
+
+PageCacheFile::~PageCacheFile() {
+  stream_.close();
+  std::remove(path_.c_str());
+}
+
+void PageCacheFile::insert(const File* file, const PageId pageNo,
+                           const Page& page) {
+  if (numSlots_ == 0) {
+    return;
+  }
+  const Key key = file->pageKey(pageNo);
+  EntryMap::iterator it = index_.find(key);
+  std::uint32_t slot;
+  if (it != index_.end()) {
+    // Overwrite the old copy in place.
+    slot = it->second.slot;
+    lru_.splice(lru_.end(), lru_, it->second.lru);
+  } else {
+    if (freeSlots_.empty()) {
+      erase(index_.find(slotKeys_[lru_.front()]));
+      ++stats_.evictions;
+    }
+    slot = freeSlots_.back();
+    freeSlots_.pop_back();
+    Entry entry = {slot, lru_.insert(lru_.end(), slot)};
+    index_.insert(std::make_pair(key, entry));
+    slotKeys_[slot] = key;
+  }
+
+  stream_.seekp(slotPosition(slot), std::ios::beg);
+  stream_.write(reinterpret_cast<const char*>(&page.header_),
+                sizeof(page.header_));
+  stream_.write(page.data_.data(), Page::DATA_SIZE);
+  stream_.flush();
+  if (!stream_) {
+    // Out of space or similar; the slot may hold part of a page, so forget
+    // it.  The data file still has a good copy.
+    stream_.clear();
+    erase(index_.find(key));
+    return;
+  }
+  ++stats_.inserts;
+}
+
+bool PageCacheFile::lookup(const File* file, const PageId pageNo,
+                           Page& page) {
+  EntryMap::iterator it = index_.find(file->pageKey(pageNo));
+  if (it == index_.end()) {
+    ++stats_.misses;
+    return false;
+  }
+
+  stream_.seekg(slotPosition(it->second.slot), std::ios::beg);
+  stream_.read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
+  stream_.read(&page.data_[0], Page::DATA_SIZE);
+  if (!stream_) {
+    // Lost the slot somehow; the data file still has a good copy.
+    stream_.clear();
+    erase(it);
+    ++stats_.misses;
+    return false;
+  }
+
+  lru_.splice(lru_.end(), lru_, it->second.lru);
+  ++stats_.hits;
+  return true;
+}
+
+void PageCacheFile::remove(const File* file, const PageId pageNo) {
+  EntryMap::iterator it = index_.find(file->pageKey(pageNo));
+  if (it != index_.end()) {
+    erase(it);
+  }
+}
+
+void PageCacheFile::removeFile(const File* file) {
+  // Keys of a file are contiguous since the file id is in the high bits.
+  const Key last = file->pageKey(~static_cast<PageId>(0));
+  EntryMap::iterator it = index_.lower_bound(file->pageKey(0));
+  while (it != index_.end() && it->first <= last) {
+    erase(it++);
+  }
+}
+
+void PageCacheFile::erase(EntryMap::iterator entry) {
+  freeSlots_.push_back(entry->second.slot);
+  lru_.erase(entry->second.lru);
+  index_.erase(entry);
+}
+
+}
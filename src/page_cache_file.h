@@ -0,0 +1,181 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <fstream>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "compressed_cache.h"
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Second-tier page cache kept in a fixed-size scratch file.
+ *
+ * Meant to live on fast local storage while the data files sit on slower
+ * storage.  The cache file is split into page-sized slots; a map from
+ * (file, pageNo) to slot finds cached pages and slots are recycled in least
+ * recently used order once all of them are taken.
+ *
+ * The cache file is created (or truncated) when the object is constructed and
+ * removed when it is destroyed; its contents never outlive the process.  Only
+ * clean pages may be inserted.
+ *
+ * @warning This class is not threadsafe.
+ */
+class PageCacheFile {
+ public:
+  /**
+   * Creates the cache file.
+   *
+   * @param path      Name of the cache file, usually on a different device
+   *                  than the data files.
+   * @param numSlots  Number of pages the cache file can hold.
+   * @throws  FileNotFoundException  If the cache file can not be created.
+   */
+  PageCacheFile(const std::string& path, const std::uint32_t numSlots);
+
+  /**
+   * Closes and removes the cache file.
+   */
+  ~PageCacheFile();
+
+  /**
+   * Stores a copy of the page under (file, pageNo), replacing any previous
+   * copy.  Evicts the least recently used page if every slot is taken.  If
+   * the copy can not be written, the page is left out of the cache.
+   *
+   * @param file    File object the page belongs to.
+   * @param pageNo  Page number in the file.
+   * @param page    Clean contents of the page.
+   */
+  void insert(const File* file, const PageId pageNo, const Page& page);
+
+  /**
+   * Looks up (file, pageNo) and reads it into <page> on a hit.  The page stays
+   * cached and becomes the most recently used one.
+   *
+   * @param file    File object the page belongs to.
+   * @param pageNo  Page number in the file.
+   * @param page    Receives the page contents on a hit.
+   * @return  True on a hit.
+   */
+  bool lookup(const File* file, const PageId pageNo, Page& page);
+
+  /**
+   * Drops (file, pageNo) from the cache if it is present.
+   *
+   * @param file    File object the page belongs to.
+   * @param pageNo  Page number in the file.
+   */
+  void remove(const File* file, const PageId pageNo);
+
+  /**
+   * Drops every page of the file from the cache.
+   *
+   * @param file  File object.
+   */
+  void removeFile(const File* file);
+
+  /**
+   * Returns the name of the cache file.
+   */
+  const std::string& path() const { return path_; }
+
+  /**
+   * Returns the number of slots in the cache file.
+   */
+  std::uint32_t numSlots() const { return numSlots_; }
+
+  /**
+   * Returns the number of pages currently held.
+   */
+  std::size_t size() const { return index_.size(); }
+
+  /**
+   * Get cache usage statistics
+   */
+  const CacheStats& getStats() const { return stats_; }
+
+  /**
+   * Clear cache usage statistics
+   */
+  void clearStats() { stats_.clear(); }
+
+ private:
+  typedef PageKey Key;
+  typedef std::list<std::uint32_t> SlotList;
+
+  /**
+   * Where a cached page lives and its place in the LRU order.
+   */
+  struct Entry {
+    std::uint32_t slot;
+    SlotList::iterator lru;
+  };
+
+  typedef std::map<Key, Entry> EntryMap;
+
+  /**
+   * Removes the entry and returns its slot to the free list.
+   */
+  void erase(EntryMap::iterator entry);
+
+  /**
+   * Returns the offset of the slot in the cache file.
+   */
+  static std::streampos slotPosition(const std::uint32_t slot) {
+    return static_cast<std::streamoff>(slot) * Page::SIZE;
+  }
+
+  /**
+   * Name of the cache file.
+   */
+  std::string path_;
+
+  /**
+   * Number of page slots in the cache file.
+   */
+  std::uint32_t numSlots_;
+
+  /**
+   * Stream for the cache file.
+   */
+  std::fstream stream_;
+
+  /**
+   * Maps the key of each cached page to its slot.
+   */
+  EntryMap index_;
+
+  /**
+   * Key stored in each slot, used to find the entry of an evicted slot.
+   */
+  std::vector<Key> slotKeys_;
+
+  /**
+   * Occupied slots, least recently used first.
+   */
+  SlotList lru_;
+
+  /**
+   * Slots not holding any page.
+   */
+  std::vector<std::uint32_t> freeSlots_;
+
+  /**
+   * Cache usage statistics.
+   */
+  CacheStats stats_;
+};
+
+}
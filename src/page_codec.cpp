@@ -0,0 +1,73 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_codec.h"
+
+#include <cassert>
+#include <map>
+#include <mutex>
+
+#include "lz_codec.h"
+
+namespace badgerdb {
+
+const std::uint32_t PageCodec::MAX_ID;
+const std::uint32_t LzPageCodec::ID;
+
+namespace {
+
+/**
+ * Registered codecs by identifier.  Built on first use, so codecs can be
+ * registered from static initializers in other files.
+ */
+struct Registry {
+  Registry() {
+    codecs[LzPageCodec::ID] = &PageCodec::defaultCodec();
+  }
+
+  std::mutex latch;
+  std::map<std::uint32_t, const PageCodec*> codecs;
+};
+
+Registry& registry() {
+  static Registry instance;
+  return instance;
+}
+
+}
+
+void PageCodec::registerCodec(const PageCodec& codec) {
+  assert(codec.id() != 0 && codec.id() <= MAX_ID);
+  Registry& codecs = registry();
+  std::lock_guard<std::mutex> latch(codecs.latch);
+  codecs.codecs[codec.id()] = &codec;
+}
+
+const PageCodec* PageCodec::find(const std::uint32_t id) {
+  Registry& codecs = registry();
+  std::lock_guard<std::mutex> latch(codecs.latch);
+  std::map<std::uint32_t, const PageCodec*>::const_iterator codec =
+      codecs.codecs.find(id);
+  return codec == codecs.codecs.end() ? NULL : codec->second;
+}
+
+const PageCodec& PageCodec::defaultCodec() {
+  static const LzPageCodec codec;
+  return codec;
+}
+
+void LzPageCodec::compress(const char* src, const std::size_t length,
+                           std::string& out) const {
+  LzCodec::compress(src, length, out);
+}
+
+bool LzPageCodec::decompress(const char* src, const std::size_t length,
+                             char* dst, const std::size_t dst_length) const {
+  return LzCodec::decompress(src, length, dst, dst_length);
+}
+
+}
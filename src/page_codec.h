@@ -0,0 +1,113 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace badgerdb {
+
+/**
+ * @brief Codec that compressed files (see File::createCompressed()) pass
+ *        their pages through on the way to and from disk.
+ *
+ * Each codec has a small identifier, which compressed files record in their
+ * header so they can be opened again with the same codec.  Codecs are
+ * registered once, before any file using them is opened, and must outlive
+ * every such file.  The built-in LzPageCodec is always registered.
+ *
+ * Codecs must be safe to use from several threads at once.
+ */
+class PageCodec {
+ public:
+  /**
+   * Largest codec identifier; identifiers fit in one byte of the file header.
+   */
+  static const std::uint32_t MAX_ID = 0xff;
+
+  virtual ~PageCodec() {}
+
+  /**
+   * Returns the identifier of the codec, between 1 and MAX_ID.
+   */
+  virtual std::uint32_t id() const = 0;
+
+  /**
+   * Returns the name of the codec, for reports.
+   */
+  virtual const char* name() const = 0;
+
+  /**
+   * Compresses <length> bytes at <src>, replacing the contents of <out>.
+   *
+   * @param src     Bytes to compress.
+   * @param length  Number of bytes at src.
+   * @param out     Receives the compressed bytes.
+   */
+  virtual void compress(const char* src, const std::size_t length,
+                        std::string& out) const = 0;
+
+  /**
+   * Decompresses bytes produced by compress() into <dst>.
+   *
+   * @param src         Compressed bytes.
+   * @param length      Number of compressed bytes.
+   * @param dst         Destination buffer.
+   * @param dst_length  Exact number of bytes the input must expand to.
+   * @return  True if the input was well formed and expanded to exactly
+   *          dst_length bytes.
+   */
+  virtual bool decompress(const char* src, const std::size_t length,
+                          char* dst, const std::size_t dst_length) const = 0;
+
+  /**
+   * Makes a codec available to compressed files, replacing any codec
+   * registered before with the same identifier.
+   *
+   * @param codec   Codec to register.
+   */
+  static void registerCodec(const PageCodec& codec);
+
+  /**
+   * Returns the codec registered with the given identifier, or NULL if there
+   * is none.
+   *
+   * @param id  Identifier of codec.
+   */
+  static const PageCodec* find(const std::uint32_t id);
+
+  /**
+   * Returns the built-in codec, which compressed files use unless told
+   * otherwise.
+   */
+  static const PageCodec& defaultCodec();
+};
+
+/**
+ * @brief Built-in page codec, a thin wrapper around LzCodec.
+ */
+class LzPageCodec : public PageCodec {
+ public:
+  /**
+   * Identifier of the codec.
+   */
+  static const std::uint32_t ID = 1;
+
+  std::uint32_t id() const { return ID; }
+
+  const char* name() const { return "lz"; }
+
+  void compress(const char* src, const std::size_t length,
+                std::string& out) const;
+
+  bool decompress(const char* src, const std::size_t length,
+                  char* dst, const std::size_t dst_length) const;
+};
+
+}
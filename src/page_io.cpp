@@ -0,0 +1,442 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_io.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "exceptions/checksum_mismatch_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/io_error_exception.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define BADGERDB_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+// Name reported by exceptions about the queue itself rather than a file.
+const std::string kQueueName = "page I/O queue";
+
+long transfer(const FileDescriptor& fd, const bool write,
+              const struct iovec* parts, const off_t offset) {
+  const ssize_t result = write ? ::pwritev(fd.fd(), parts, 2, offset)
+                               : ::preadv(fd.fd(), parts, 2, offset);
+  return result < 0 ? -errno : result;
+}
+
+/**
+ * Backend running requests on a pool of threads doing pread/pwrite.
+ */
+class ThreadPoolPageIo : public PageIoQueue {
+ public:
+  explicit ThreadPoolPageIo(const unsigned queueDepth)
+      : PageIoQueue(queueDepth), stop_(false) {
+    const unsigned numThreads = queueDepth < 16 ? queueDepth : 16;
+    for (unsigned i = 0; i < numThreads; ++i) {
+      threads_.push_back(std::thread(&ThreadPoolPageIo::work, this));
+    }
+  }
+
+  ~ThreadPoolPageIo() {
+    waitAll();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    work_ready_.notify_all();
+    for (std::size_t i = 0; i < threads_.size(); ++i) {
+      threads_[i].join();
+    }
+  }
+
+  const char* backendName() const { return "thread pool"; }
+
+ protected:
+  void start(const unsigned slot) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.push_back(slot);
+    }
+    work_ready_.notify_one();
+  }
+
+  void flush() {}
+
+  void reap(const bool wait) {
+    std::vector<std::pair<unsigned, long> > done;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (wait && done_.empty()) {
+        work_done_.wait(lock);
+      }
+      done.swap(done_);
+    }
+    for (std::size_t i = 0; i < done.size(); ++i) {
+      complete(done[i].first, done[i].second);
+    }
+  }
+
+ private:
+  void work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      while (pending_.empty() && !stop_) {
+        work_ready_.wait(lock);
+      }
+      if (pending_.empty()) {
+        return;
+      }
+      const unsigned slot = pending_.front();
+      pending_.pop_front();
+      lock.unlock();
+      const Request& request = requests_[slot];
+      const long result = transfer(*request.fd, request.write, request.parts,
+                                   request.offset);
+      lock.lock();
+      done_.push_back(std::make_pair(slot, result));
+      work_done_.notify_one();
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable work_done_;
+  std::deque<unsigned> pending_;
+  std::vector<std::pair<unsigned, long> > done_;
+  bool stop_;
+};
+
+#if defined(BADGERDB_HAVE_IO_URING)
+
+/**
+ * Backend using io_uring through raw system calls.  Requests are put on the
+ * submission ring as they come and handed to the kernel with one
+ * io_uring_enter() per batch; completions are polled from the completion
+ * ring and only waited for in the kernel when none are ready.
+ */
+class IoUringPageIo : public PageIoQueue {
+ public:
+  explicit IoUringPageIo(const unsigned queueDepth)
+      : PageIoQueue(queueDepth), to_submit_(0) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd_ = static_cast<int>(
+        ::syscall(__NR_io_uring_setup, queueDepth, &params));
+    if (ring_fd_ < 0) {
+      throw IoErrorException(kQueueName, "io_uring_setup", errno);
+    }
+
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_ = params.cq_off.cqes +
+               params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_size_ = cq_size_ = sq_size_ > cq_size_ ? sq_size_ : cq_size_;
+    }
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    sq_ring_ = map(sq_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = single_mmap ? sq_ring_ : map(cq_size_, IORING_OFF_CQ_RING);
+    sqes_ = static_cast<struct io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+    if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED ||
+        sqes_ == MAP_FAILED) {
+      const int error = errno;
+      unmap();
+      throw IoErrorException(kQueueName, "mmap", error);
+    }
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+  }
+
+  ~IoUringPageIo() {
+    waitAll();
+    unmap();
+  }
+
+  const char* backendName() const { return "io_uring"; }
+
+ protected:
+  void start(const unsigned slot) {
+    // Only this thread produces submissions, so the tail can be read plainly.
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & sq_mask_;
+    const Request& request = requests_[slot];
+    struct io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = request.write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = request.fd->fd();
+    sqe->addr = reinterpret_cast<unsigned long>(request.parts);
+    sqe->len = 2;
+    sqe->off = request.offset;
+    sqe->user_data = slot;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++to_submit_;
+  }
+
+  void flush() {
+    while (to_submit_ > 0) {
+      const int submitted = enter(to_submit_, 0, 0);
+      if (submitted < 0) {
+        if (errno == EINTR || errno == EAGAIN) {
+          continue;
+        }
+        throw IoErrorException(kQueueName, "io_uring_enter", errno);
+      }
+      to_submit_ -= submitted;
+    }
+  }
+
+  void reap(const bool wait) {
+    unsigned head = *cq_head_;
+    while (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      flush();
+      if (!wait) {
+        return;
+      }
+      if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+        throw IoErrorException(kQueueName, "io_uring_enter", errno);
+      }
+    }
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    std::vector<std::pair<unsigned, long> > done;
+    for (; head != tail; ++head) {
+      const struct io_uring_cqe& cqe = cqes_[head & cq_mask_];
+      done.push_back(std::make_pair(static_cast<unsigned>(cqe.user_data),
+                                    static_cast<long>(cqe.res)));
+    }
+    // Release the entries before completing, which may start new requests.
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    for (std::size_t i = 0; i < done.size(); ++i) {
+      complete(done[i].first, done[i].second);
+    }
+  }
+
+ private:
+  void* map(const std::size_t size, const off_t offset) {
+    return ::mmap(NULL, size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+  }
+
+  void unmap() {
+    if (sqes_ != MAP_FAILED) {
+      ::munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      ::munmap(cq_ring_, cq_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      ::munmap(sq_ring_, sq_size_);
+    }
+    ::close(ring_fd_);
+  }
+
+  int enter(const unsigned to_submit, const unsigned min_complete,
+            const unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit,
+                                      min_complete, flags, NULL, 0));
+  }
+
+  int ring_fd_;
+  unsigned to_submit_;
+  std::size_t sq_size_;
+  std::size_t cq_size_;
+  std::size_t sqes_size_;
+  void* sq_ring_;
+  void* cq_ring_;
+  struct io_uring_sqe* sqes_;
+  unsigned* sq_tail_;
+  unsigned sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned cq_mask_;
+  struct io_uring_cqe* cqes_;
+};
+
+#endif
+
+}
+
+PageIoQueue* PageIoQueue::create(const unsigned queueDepth,
+                                 const Backend backend) {
+  const unsigned depth = queueDepth > 0 ? queueDepth : 1;
+#if defined(BADGERDB_HAVE_IO_URING)
+  if (backend != THREAD_POOL) {
+    try {
+      return new IoUringPageIo(depth);
+    } catch (IoErrorException&) {
+      // Kernel too old, or io_uring disabled by policy.
+      if (backend == IO_URING) {
+        throw;
+      }
+    }
+  }
+#else
+  if (backend == IO_URING) {
+    throw IoErrorException(kQueueName, "io_uring_setup", ENOSYS);
+  }
+#endif
+  return new ThreadPoolPageIo(depth);
+}
+
+PageIoQueue::PageIoQueue(const unsigned queueDepth)
+    : requests_(queueDepth), in_flight_(0), tagged_(0) {
+  for (unsigned i = queueDepth; i > 0; --i) {
+    free_.push_back(i - 1);
+  }
+}
+
+unsigned PageIoQueue::takeSlot() {
+  while (free_.empty()) {
+    flush();
+    reap(true);
+  }
+  const unsigned slot = free_.back();
+  free_.pop_back();
+  ++in_flight_;
+  return slot;
+}
+
+void PageIoQueue::queueRead(FileDescriptor& fd, const off_t offset,
+                            PageHeader* header, char* data, const Page* page,
+                            const PageId page_number, void* tag) {
+  const unsigned slot = takeSlot();
+  Request& request = requests_[slot];
+  request.fd = &fd;
+  request.offset = offset;
+  request.write = false;
+  request.parts[0].iov_base = header;
+  request.parts[0].iov_len = sizeof(PageHeader);
+  request.parts[1].iov_base = data;
+  request.parts[1].iov_len = Page::DATA_SIZE;
+  request.check = page;
+  request.page_number = page_number;
+  request.tag = tag;
+  if (tag) {
+    ++tagged_;
+  }
+  start(slot);
+}
+
+void PageIoQueue::queueWrite(FileDescriptor& fd, const off_t offset,
+                             const PageHeader& header, const char* data) {
+  const unsigned slot = takeSlot();
+  Request& request = requests_[slot];
+  request.fd = &fd;
+  request.offset = offset;
+  request.write = true;
+  request.header = header;
+  request.parts[0].iov_base = &request.header;
+  request.parts[0].iov_len = sizeof(PageHeader);
+  request.parts[1].iov_base = const_cast<char*>(data);
+  request.parts[1].iov_len = Page::DATA_SIZE;
+  request.check = NULL;
+  request.page_number = Page::INVALID_NUMBER;
+  request.tag = NULL;
+  start(slot);
+}
+
+void PageIoQueue::complete(const unsigned slot, const long result) {
+  Request& request = requests_[slot];
+  std::exception_ptr error;
+  try {
+    if (result < 0) {
+      throw IoErrorException(request.fd->filename(),
+                             request.write ? "pwritev" : "preadv",
+                             static_cast<int>(-result));
+    }
+    if (result < static_cast<long>(Page::SIZE)) {
+      // Short transfer, or a read past the end of the file: finish it the
+      // synchronous way, which retries and zero-fills.
+      if (request.write) {
+        request.fd->writev(request.parts, 2, request.offset);
+      } else {
+        request.fd->readv(request.parts, 2, request.offset);
+      }
+    }
+    if (request.check && request.check->page_number() == Page::INVALID_NUMBER) {
+      throw InvalidPageException(request.page_number, request.fd->filename());
+    }
+    if (request.check) {
+      const PageHeader* header =
+          static_cast<const PageHeader*>(request.parts[0].iov_base);
+      const char* data = static_cast<const char*>(request.parts[1].iov_base);
+      if (header->checksum != Page::checksum(*header, data)) {
+        throw ChecksumMismatchException(request.page_number,
+                                        request.fd->filename());
+      }
+    }
+  } catch (...) {
+    error = std::current_exception();
+  }
+  if (request.tag) {
+    Completion done = {request.tag, error};
+    completed_.push_back(done);
+  } else if (error && !error_) {
+    error_ = error;
+  }
+  free_.push_back(slot);
+  --in_flight_;
+}
+
+void PageIoQueue::submitAndWait() {
+  flush();
+  while (in_flight_ > 0) {
+    reap(true);
+  }
+  if (error_) {
+    std::exception_ptr error = error_;
+    error_ = std::exception_ptr();
+    std::rethrow_exception(error);
+  }
+}
+
+void PageIoQueue::waitAll() {
+  try {
+    submitAndWait();
+  } catch (...) {
+  }
+}
+
+void PageIoQueue::poll(std::vector<Completion>& done, const bool wait) {
+  flush();
+  reap(false);
+  while (wait && completed_.empty() && tagged_ > 0) {
+    reap(true);
+  }
+  tagged_ -= completed_.size();
+  done.insert(done.end(), completed_.begin(), completed_.end());
+  completed_.clear();
+}
+
+}
@@ -0,0 +1,182 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <exception>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "file_descriptor.h"
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Queue of asynchronous page reads and writes.
+ *
+ * Requests are queued with File::readPageAsync() and File::writePageAsync()
+ * and run in the background, up to queueDepth() at a time; queueing more
+ * waits for a slot.  submitAndWait() waits for everything queued so far.  The
+ * pages and files passed in must stay alive, and pages being read must not be
+ * used, until then.
+ *
+ * Reads queued with a tag are handed back one by one through poll() as they
+ * complete instead, each with its own error, so a caller can act on every
+ * read the moment it lands.
+ *
+ * Two backends exist: io_uring, which submits requests in batches and polls
+ * the completion ring without a system call while completions are ready, and
+ * a pool of threads doing pread/pwrite for systems without io_uring.
+ *
+ * @warning A queue is not threadsafe; use one per thread.
+ */
+class PageIoQueue {
+ public:
+  /**
+   * Backend choice for create().
+   */
+  enum Backend {
+    /** io_uring if the kernel allows it, the thread pool otherwise */
+    AUTO,
+    /** Linux io_uring, set up with raw system calls */
+    IO_URING,
+    /** Threads doing pread/pwrite */
+    THREAD_POOL
+  };
+
+  /**
+   * Creates a queue.
+   *
+   * @param queueDepth  Most requests in flight at once, at least 1.
+   * @param backend     Backend to use.
+   * @return  New queue, owned by the caller.
+   * @throws  IoErrorException  If IO_URING was asked for and can not be set up.
+   */
+  static PageIoQueue* create(const unsigned queueDepth,
+                             const Backend backend = AUTO);
+
+  /**
+   * A tagged read that has completed, see poll().
+   */
+  struct Completion {
+    /** Tag the read was queued with */
+    void* tag;
+    /** What submitAndWait() would have thrown for the read, if anything */
+    std::exception_ptr error;
+  };
+
+  virtual ~PageIoQueue() {}
+
+  /**
+   * Queues a read of a page image into header and data.  If page is not NULL,
+   * submitAndWait() throws InvalidPageException unless the page read is in use,
+   * and ChecksumMismatchException unless it matches its checksum.  If tag is
+   * not NULL, the read is reported by poll() rather than submitAndWait().
+   */
+  void queueRead(FileDescriptor& fd, const off_t offset, PageHeader* header,
+                 char* data, const Page* page, const PageId page_number,
+                 void* tag = NULL);
+
+  /**
+   * Queues a write of a page image.  The header is copied; the data is not.
+   */
+  void queueWrite(FileDescriptor& fd, const off_t offset,
+                  const PageHeader& header, const char* data);
+
+  /**
+   * Starts everything queued and waits until it has all completed.
+   *
+   * @throws  IoErrorException      If any request failed.
+   * @throws  InvalidPageException  If any checked read found a page not in use.
+   */
+  void submitAndWait();
+
+  /**
+   * Like submitAndWait(), but drops any errors.  For cleaning up after
+   * another exception.
+   */
+  void waitAll();
+
+  /**
+   * Starts everything queued and appends the tagged reads that have completed
+   * since the last call to done.
+   *
+   * @param done  Completions, in the order the reads finished.
+   * @param wait  Wait until at least one tagged read has completed, unless
+   *              none is in flight.
+   */
+  void poll(std::vector<Completion>& done, const bool wait);
+
+  /**
+   * Returns the number of tagged reads not yet handed out by poll().
+   */
+  unsigned taggedInFlight() const { return tagged_; }
+
+  /**
+   * Returns the most requests in flight at once.
+   */
+  unsigned queueDepth() const { return requests_.size(); }
+
+  /**
+   * Returns the name of the backend.
+   */
+  virtual const char* backendName() const = 0;
+
+ protected:
+  /**
+   * One queued request.
+   */
+  struct Request {
+    FileDescriptor* fd;
+    off_t offset;
+    bool write;
+    struct iovec parts[2];
+    PageHeader header;
+    const Page* check;
+    PageId page_number;
+    void* tag;
+  };
+
+  explicit PageIoQueue(const unsigned queueDepth);
+
+  /**
+   * Starts the request in the slot.  It may be batched until flush().
+   */
+  virtual void start(const unsigned slot) = 0;
+
+  /**
+   * Makes sure every started request is on its way to the device.
+   */
+  virtual void flush() = 0;
+
+  /**
+   * Calls complete() for each completed request.  If wait is set, first
+   * waits until at least one request has completed.
+   */
+  virtual void reap(const bool wait) = 0;
+
+  /**
+   * Finishes a request that transferred result bytes, or failed with -result
+   * as errno, and frees its slot.
+   */
+  void complete(const unsigned slot, const long result);
+
+  std::vector<Request> requests_;
+
+ private:
+  unsigned takeSlot();
+
+  std::vector<unsigned> free_;
+  unsigned in_flight_;
+  unsigned tagged_;
+  std::exception_ptr error_;
+  std::vector<Completion> completed_;
+};
+
+}
@@ -18,7 +18,7 @@ namespace badgerdb {
  * @brief Iterator for iterating over the records in a page.
  *
  * This class provides a forward-only iterator that iterates over all the
- * records stored in a Page.
+ * records stored in a Page, or in a PageView such as a page of a MappedFile.
  */
 class PageIterator {
  public:
@@ -55,13 +55,38 @@ class PageIterator {
         current_record_(record_id) {
   }
 
+  /**
+   * Constructs an iterator over the records in the viewed page, starting at
+   * the first record.
+   *
+   * @param view  View of page to iterate over.
+   */
+  PageIterator(const PageView& view)
+      : page_(NULL),
+        view_(view) {
+    const SlotId used_slot = getNextUsedSlot(Page::INVALID_SLOT /* start */);
+    current_record_ = {view_.page_number(), used_slot};
+  }
+
+  /**
+   * Constructs an iterator over the records in the viewed page, starting at
+   * the given record.
+   *
+   * @param view        View of page to iterate over.
+   * @param record_id   ID of record to start iterator at.
+   */
+  PageIterator(const PageView& view, const RecordId& record_id)
+      : page_(NULL),
+        view_(view),
+        current_record_(record_id) {
+  }
+
   /**
    * Advances the iterator to the next record in the page.
    */
 	inline PageIterator& operator++() {
-    assert(page_ != NULL);
     const SlotId used_slot = getNextUsedSlot(current_record_.slot_number);
-    current_record_ = {page_->page_number(), used_slot};
+    current_record_ = {view().page_number(), used_slot};
 
 		return *this;
   }
@@ -69,9 +94,8 @@ class PageIterator {
 	inline PageIterator operator++(int) {
 		PageIterator tmp = *this;   // copy ourselves
 
-    assert(page_ != NULL);
     const SlotId used_slot = getNextUsedSlot(current_record_.slot_number);
-    current_record_ = {page_->page_number(), used_slot};
+    current_record_ = {view().page_number(), used_slot};
 
 		return tmp;
   }
@@ -82,12 +106,12 @@ class PageIterator {
    * @return    True if other iterator is equal to this one.
    */
 	inline bool operator==(const PageIterator& rhs) const {
-    return page_->page_number() == rhs.page_->page_number() &&
+    return view().page_number() == rhs.view().page_number() &&
         current_record_ == rhs.current_record_;
   }
 
 	inline bool operator!=(const PageIterator& rhs) const {
-    return (page_->page_number() != rhs.page_->page_number()) || 
+    return (view().page_number() != rhs.view().page_number()) || 
         (current_record_ != rhs.current_record_);
   }
 
@@ -98,9 +122,18 @@ class PageIterator {
    * @return  Record in page.
    */
 	inline std::string operator*() const {
-		return page_->getRecord(current_record_); 
+		return view().getRecord(current_record_).toString();
 	}
 
+  /**
+   * Returns the current record without copying it.
+   *
+   * @return  Record in page.
+   */
+  RecordView record() const {
+    return view().getRecord(current_record_);
+  }
+
   /**
    * Returns the next used slot in the page after the given slot or
    * Page::INVALID_SLOT if no slots are used after the given slot.
@@ -110,9 +143,9 @@ class PageIterator {
    */
   SlotId getNextUsedSlot(const SlotId start) const {
     SlotId slot_number = Page::INVALID_SLOT;
-    for (SlotId i = start + 1; i <= page_->header_.num_slots; ++i) {
-      const PageSlot* slot = page_->getSlot(i);
-      if (slot->used) {
+    const PageView& page = view();
+    for (SlotId i = start + 1; i <= page.num_slots(); ++i) {
+      if (page.getSlot(i).used) {
         slot_number = i;
         break;
       }
@@ -121,11 +154,24 @@ class PageIterator {
   }
 
  private:
+  /**
+   * Returns a view of the page we're iterating over.  Views of a Page are
+   * taken afresh each time since the page may have been changed.
+   */
+  PageView view() const {
+    return page_ != NULL ? page_->view() : view_;
+  }
+
   /**
    * Page we're iterating over.
    */
   Page* page_;
 
+  /**
+   * View we're iterating over if not iterating over a Page.
+   */
+  PageView view_;
+
   /**
    * ID of record iterator is currently pointing to.
    */
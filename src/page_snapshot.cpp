@@ -0,0 +1,81 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_snapshot.h"
+
+namespace badgerdb {
+
+SnapshotArena::SnapshotArena(std::uint32_t numPages)
+    : pages_(numPages) {
+  free_.reserve(numPages);
+  for (std::uint32_t i = numPages; i > 0; --i) {
+    free_.push_back(&pages_[i - 1]);
+  }
+}
+
+Page* SnapshotArena::acquire() {
+  std::lock_guard<std::mutex> guard(latch_);
+  if (free_.empty()) {
+    return NULL;
+  }
+  Page* page = free_.back();
+  free_.pop_back();
+  return page;
+}
+
+void SnapshotArena::release(Page* page) {
+  std::lock_guard<std::mutex> guard(latch_);
+  free_.push_back(page);
+}
+
+std::uint32_t SnapshotArena::inUse() const {
+  std::lock_guard<std::mutex> guard(latch_);
+  return pages_.size() - free_.size();
+}
+
+SnapshotState::~SnapshotState() {
+  if (fromArena) {
+    arena->release(copy.load());
+  } else {
+    delete copy.load();
+  }
+}
+
+const Page* SnapshotState::get() {
+  const Page* page = copy.load(std::memory_order_acquire);
+  if (!page) {
+    if (pending) {
+      std::unique_lock<std::mutex> guard(latch);
+      while (!copy.load(std::memory_order_relaxed)) {
+        copied.wait(guard);
+      }
+    } else {
+      detach();
+    }
+    page = copy.load(std::memory_order_acquire);
+  }
+  return page;
+}
+
+bool SnapshotState::detach() {
+  std::lock_guard<std::mutex> guard(latch);
+  if (copy.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  Page* page = arena ? arena->acquire() : NULL;
+  fromArena = page != NULL;
+  if (fromArena) {
+    *page = *frame;
+  } else {
+    page = new Page(*frame);
+  }
+  copy.store(page, std::memory_order_release);
+  copied.notify_all();
+  return true;
+}
+
+}
@@ -0,0 +1,181 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Fixed pool of pages holding private copies for page snapshots.
+ *
+ * Copies are taken from the arena while it has room and from the heap
+ * otherwise, so taking a copy never fails.  Safe to use from several threads,
+ * since snapshot readers take and release copies outside the buffer pool latch.
+ */
+class SnapshotArena {
+ public:
+  /**
+   * Constructs an arena of the given number of pages.
+   */
+  explicit SnapshotArena(std::uint32_t numPages);
+
+  /**
+   * Returns a free page of the arena, or NULL if all are in use.
+   */
+  Page* acquire();
+
+  /**
+   * Returns a page taken with acquire() to the arena.
+   */
+  void release(Page* page);
+
+  /**
+   * Returns the number of pages in the arena.
+   */
+  std::uint32_t capacity() const { return pages_.size(); }
+
+  /**
+   * Returns the number of pages currently holding copies.
+   */
+  std::uint32_t inUse() const;
+
+ private:
+  mutable std::mutex latch_;
+  std::vector<Page> pages_;
+  std::vector<Page*> free_;
+};
+
+/**
+ * @brief State shared by all snapshots of one version of a page.
+ *
+ * Refers to the buffer pool frame until a private copy of the page is taken,
+ * either by the first reader of the snapshot or by the buffer pool just
+ * before the frame changes, whichever comes first.  Readers only ever see the
+ * copy, never the frame.
+ *
+ * A snapshot of a page that is pinned when it is taken is pending: its holders
+ * may be changing the frame, so only the buffer pool takes the copy, once the
+ * last pin is released, and readers wait for it.
+ */
+struct SnapshotState {
+  SnapshotState(const Page* framePage, const std::shared_ptr<SnapshotArena>& arenaIn,
+                const bool pendingIn)
+      : frame(framePage), copy(NULL), fromArena(false), arena(arenaIn),
+        pending(pendingIn) {
+  }
+
+  ~SnapshotState();
+
+  /**
+   * Returns the private copy of the page, taking it first if there is none.
+   * Waits for the buffer pool to take it if the snapshot is pending.
+   */
+  const Page* get();
+
+  /**
+   * Takes the private copy of the page unless there is one already.
+   *
+   * @return  True if this call took the copy.
+   */
+  bool detach();
+
+  /**
+   * Frame the page is copied from.  Unchanged until the copy is taken.
+   */
+  const Page* frame;
+
+  /**
+   * Private copy, NULL until it is taken.
+   */
+  std::atomic<Page*> copy;
+
+  /**
+   * True if copy came from the arena rather than the heap.
+   */
+  bool fromArena;
+
+  /**
+   * Arena the copy is taken from, kept alive for as long as the snapshot.
+   */
+  std::shared_ptr<SnapshotArena> arena;
+
+  /**
+   * True if only the buffer pool may take the copy, see above.
+   */
+  const bool pending;
+
+  /**
+   * Serializes taking the copy between readers and the buffer pool.
+   */
+  std::mutex latch;
+
+  /**
+   * Signalled once the copy is taken, for readers of a pending snapshot.
+   */
+  std::condition_variable copied;
+
+ private:
+  SnapshotState(const SnapshotState&);
+  SnapshotState& operator=(const SnapshotState&);
+};
+
+/**
+ * @brief Read-only view of a page returned by BufMgr::readSnapshot().
+ *
+ * The view holds no pin, so it never keeps writers, eviction or
+ * BufMgr::flushFile() from proceeding.  The page is copied once per version,
+ * when the view is first read or before the buffer pool hands the page to
+ * anyone else or reuses its frame, so the view keeps showing the page as it
+ * was when the snapshot was taken.  A snapshot of a pinned page shows it as it
+ * is when the last pin is released, and reading it waits until then, so a
+ * thread must not read a snapshot of a page it has pinned itself.
+ * Snapshots can be copied freely and used from any thread; all copies share
+ * one view.
+ */
+class PageSnapshot {
+ public:
+  /**
+   * Constructs an empty snapshot.
+   */
+  PageSnapshot() {}
+
+  /**
+   * Returns the private copy of the page, NULL for an empty snapshot.
+   */
+  const Page* get() const { return state_ ? state_->get() : NULL; }
+  const Page* operator->() const { return get(); }
+  const Page& operator*() const { return *get(); }
+
+  /**
+   * Returns true once the private copy of the page has been taken.
+   */
+  bool isCopy() const { return state_ && state_->copy.load() != NULL; }
+
+  /**
+   * Releases the snapshot; its private copy is freed with the last reference.
+   */
+  void reset() { state_.reset(); }
+
+ private:
+  friend class BufMgr;
+
+  explicit PageSnapshot(const std::shared_ptr<SnapshotState>& state)
+      : state_(state) {
+  }
+
+  std::shared_ptr<SnapshotState> state_;
+};
+
+}
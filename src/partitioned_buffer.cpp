@@ -0,0 +1,332 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <iostream>
+#include <utility>
+#include "partitioned_buffer.h"
+#include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/invalid_quota_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+// Out-of-range counts are clamped rather than rejected.
+std::uint32_t clampPartitions(std::uint32_t bufs, std::uint32_t numPartitions)
+{
+	if (numPartitions == 0 || bufs == 0)
+		return 1;
+	return numPartitions > bufs ? bufs : numPartitions;
+}
+
+// Share of partition p when total is split evenly, the remainder going to
+// the first partitions.
+std::size_t shareOf(const std::size_t total, const std::uint32_t p, const std::uint32_t count)
+{
+	return total / count + (p < total % count ? 1 : 0);
+}
+
+}
+
+PartitionedBufMgr::PartitionedBufMgr(std::uint32_t bufs, std::uint32_t numPartitions)
+	: latches(clampPartitions(bufs, numPartitions)), lockFreeTables(false)
+{
+	const std::uint32_t count = latches.size();
+	for (std::uint32_t i = 0; i < count; i++) {
+		partitions.push_back(new BufMgr(shareOf(bufs, i, count)));
+	}
+}
+
+PartitionedBufMgr::~PartitionedBufMgr()
+{
+	for (std::uint32_t i = 0; i < partitions.size(); i++) {
+		delete partitions[i];
+	}
+}
+
+std::uint32_t PartitionedBufMgr::partitionOf(const File* file, const PageId pageNo) const
+{
+	// Mixed differently from BufHashTbl::hash so pages of one partition still
+	// spread over that partition's hash table.
+	PageKey key = file->pageKey(pageNo);
+	key ^= key >> 31;
+	key *= 0xBF58476D1CE4E5B9ULL;
+	key ^= key >> 29;
+	return (std::uint32_t) (key % partitions.size());
+}
+
+void PartitionedBufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+{
+	const std::uint32_t p = partitionOf(file, pageNo);
+	std::lock_guard<std::mutex> latch(latches[p]);
+	partitions[p]->readPage(file, pageNo, page);
+}
+
+bool PartitionedBufMgr::pinIfResident(File* file, const PageId pageNo, Page*& page)
+{
+	const std::uint32_t p = partitionOf(file, pageNo);
+	std::lock_guard<std::mutex> latch(latches[p]);
+	return partitions[p]->pinIfResident(file, pageNo, page);
+}
+
+bool PartitionedBufMgr::pinIfCached(File* file, const PageId pageNo, Page*& page)
+{
+	const std::uint32_t p = partitionOf(file, pageNo);
+	std::lock_guard<std::mutex> latch(latches[p]);
+	return partitions[p]->pinIfCached(file, pageNo, page);
+}
+
+void PartitionedBufMgr::pinReadPage(File* file, const PageId pageNo, const Page& image, Page*& page)
+{
+	const std::uint32_t p = partitionOf(file, pageNo);
+	std::lock_guard<std::mutex> latch(latches[p]);
+	partitions[p]->pinReadPage(file, pageNo, image, page);
+}
+
+void PartitionedBufMgr::readPages(File* file, const std::vector<PageId>& pageNos, std::vector<Page*>& pages)
+{
+	/*	Group the pages by partition, keeping their positions in pageNos, and
+	 *	read each group with one readPages call. Latch one partition at a
+	 *	time so callers never wait on each other in a cycle.
+	 */
+	std::vector<std::vector<std::size_t> > positions(partitions.size());
+	for (std::size_t i = 0; i < pageNos.size(); i++) {
+		positions[partitionOf(file, pageNos[i])].push_back(i);
+	}
+	pages.resize(pageNos.size());
+
+	std::vector<std::uint32_t> done;
+	try {
+		for (std::uint32_t p = 0; p < partitions.size(); p++) {
+			if (positions[p].empty())
+				continue;
+			std::vector<PageId> group;
+			std::vector<Page*> groupPages;
+			for (std::size_t j = 0; j < positions[p].size(); j++) {
+				group.push_back(pageNos[positions[p][j]]);
+			}
+			{
+				std::lock_guard<std::mutex> latch(latches[p]);
+				partitions[p]->readPages(file, group, groupPages);
+			}
+			for (std::size_t j = 0; j < positions[p].size(); j++) {
+				pages[positions[p][j]] = groupPages[j];
+			}
+			done.push_back(p);
+		}
+	}
+	catch (...) {
+		for (std::size_t d = 0; d < done.size(); d++) {
+			const std::uint32_t p = done[d];
+			std::lock_guard<std::mutex> latch(latches[p]);
+			for (std::size_t j = 0; j < positions[p].size(); j++) {
+				partitions[p]->unPinPage(file, pageNos[positions[p][j]], false);
+			}
+		}
+		throw;
+	}
+}
+
+PageSnapshot PartitionedBufMgr::readSnapshot(File* file, const PageId pageNo)
+{
+	const std::uint32_t p = partitionOf(file, pageNo);
+	std::lock_guard<std::mutex> latch(latches[p]);
+	return partitions[p]->readSnapshot(file, pageNo);
+}
+
+void PartitionedBufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
+{
+	const std::uint32_t p = partitionOf(file, pageNo);
+	std::lock_guard<std::mutex> latch(latches[p]);
+	partitions[p]->unPinPage(file, pageNo, dirty);
+}
+
+void PartitionedBufMgr::allocPage(File* file, PageId& pageNo, Page*& page)
+{
+	/*	The partition depends on the page number, so reserve it in the file
+	 *	first, then find a frame in the page's partition.
+	 */
+	const Page newPage = file->reservePage();
+	pageNo = newPage.page_number();
+	const std::uint32_t p = partitionOf(file, pageNo);
+	std::lock_guard<std::mutex> latch(latches[p]);
+	try {
+		partitions[p]->installPage(file, newPage, page);
+	}
+	catch (BufferExceededException&) {
+		file->deletePage(pageNo);
+		throw;
+	}
+}
+
+void PartitionedBufMgr::flushFile(const File* file)
+{
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		partitions[p]->writeOutFile(file);
+	}
+	file->sync();
+}
+
+void PartitionedBufMgr::discardFile(const File* file)
+{
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		partitions[p]->discardFile(file);
+	}
+}
+
+void PartitionedBufMgr::disposePage(File* file, const PageId pageNo)
+{
+	const std::uint32_t p = partitionOf(file, pageNo);
+	std::lock_guard<std::mutex> latch(latches[p]);
+	partitions[p]->disposePage(file, pageNo);
+}
+
+bool PartitionedBufMgr::isResident(const File* file, const PageId pageNo)
+{
+	const std::uint32_t p = partitionOf(file, pageNo);
+	if (lockFreeTables.load(std::memory_order_acquire))
+		return partitions[p]->isResident(file, pageNo);
+	std::lock_guard<std::mutex> latch(latches[p]);
+	return partitions[p]->isResident(file, pageNo);
+}
+
+void PartitionedBufMgr::enableLockFreeTable()
+{
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		partitions[p]->enableLockFreeTable();
+	}
+	lockFreeTables.store(true, std::memory_order_release);
+}
+
+void PartitionedBufMgr::enableSnapshotArena(const std::uint32_t numPages)
+{
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		partitions[p]->enableSnapshotArena(numPages);
+	}
+}
+
+void PartitionedBufMgr::enableCompressedCache(const std::size_t capacity)
+{
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		partitions[p]->enableCompressedCache(shareOf(capacity, p, partitions.size()));
+	}
+}
+
+void PartitionedBufMgr::enableCacheFile(const std::string& path, const std::uint32_t numPages)
+{
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		partitions[p]->enableCacheFile(path + "." + std::to_string(p), shareOf(numPages, p, partitions.size()));
+	}
+}
+
+void PartitionedBufMgr::enableAsyncIo(const unsigned queueDepth, const PageIoQueue::Backend backend)
+{
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		partitions[p]->enableAsyncIo(queueDepth, backend);
+	}
+}
+
+void PartitionedBufMgr::setWriteCombineWindow(const std::uint32_t pages)
+{
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		partitions[p]->setWriteCombineWindow(pages);
+	}
+}
+
+void PartitionedBufMgr::setFileQuota(const File* file, const std::uint32_t minFrames, const std::uint32_t maxFrames)
+{
+	if (maxFrames > 0 && minFrames > maxFrames)
+		throw InvalidQuotaException(file->filename(), minFrames, maxFrames);
+
+	const std::uint32_t count = partitions.size();
+	// Earlier quota of each partition changed so far, if it had one
+	std::vector<std::pair<bool, FileQuota> > earlier;
+	std::uint32_t p = 0;
+	try {
+		for (; p < count; p++) {
+			std::lock_guard<std::mutex> latch(latches[p]);
+			std::map<FileId, FileQuota>::const_iterator old = partitions[p]->quotas.find(file->id());
+			if (old != partitions[p]->quotas.end())
+				earlier.push_back(std::make_pair(true, old->second));
+			else
+				earlier.push_back(std::make_pair(false, FileQuota()));
+			partitions[p]->setFileQuota(file, shareOf(minFrames, p, count),
+					maxFrames > 0 ? (maxFrames + count - 1) / count : 0);
+		}
+	}
+	catch (InvalidQuotaException&) {
+		for (std::uint32_t q = 0; q < p; q++) {
+			std::lock_guard<std::mutex> latch(latches[q]);
+			if (earlier[q].first)
+				partitions[q]->setFileQuota(file, earlier[q].second.minFrames, earlier[q].second.maxFrames);
+			else
+				partitions[q]->clearFileQuota(file);
+		}
+		throw;
+	}
+}
+
+void PartitionedBufMgr::clearFileQuota(const File* file)
+{
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		partitions[p]->clearFileQuota(file);
+	}
+}
+
+void PartitionedBufMgr::printSelf()
+{
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		std::cout << "Partition:" << p << "\n";
+		partitions[p]->printSelf();
+	}
+}
+
+BufSnapshot PartitionedBufMgr::snapshot()
+{
+	BufSnapshot total;
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		total.merge(partitions[p]->snapshot());
+	}
+	return total;
+}
+
+BufStats PartitionedBufMgr::getBufStats()
+{
+	BufStats total;
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		const BufStats& stats = partitions[p]->getBufStats();
+		total.accesses += stats.accesses;
+		total.diskreads += stats.diskreads;
+		total.diskwrites += stats.diskwrites;
+		total.combinedwrites += stats.combinedwrites;
+		total.quotaevictions += stats.quotaevictions;
+		total.snapshotcopies += stats.snapshotcopies;
+	}
+	return total;
+}
+
+void PartitionedBufMgr::clearBufStats()
+{
+	for (std::uint32_t p = 0; p < partitions.size(); p++) {
+		std::lock_guard<std::mutex> latch(latches[p]);
+		partitions[p]->clearBufStats();
+	}
+}
+
+}
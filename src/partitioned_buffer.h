@@ -0,0 +1,236 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Buffer manager split into independent partitions for multi-threaded use.
+ *
+ * Each (file, pageNo) is hashed to one of N partitions.  A partition is a
+ * complete BufMgr with its own frames, hash table, clock and statistics,
+ * guarded by its own latch, so threads working on pages of different
+ * partitions never contend.  The API mirrors BufMgr.
+ *
+ * A page can only be evicted by its own partition, so the pool is full for a
+ * page once its partition is full even if other partitions have free frames.
+ * File I/O itself is still serialized inside File.
+ */
+class PartitionedBufMgr
+{
+ public:
+	/**
+   * Constructor of PartitionedBufMgr class
+	 *
+	 * @param bufs  					Total number of frames, split evenly between the partitions
+	 * @param numPartitions  	Number of partitions, clamped to at least 1 and at most bufs (1 if bufs is 0)
+	 */
+  PartitionedBufMgr(std::uint32_t bufs, std::uint32_t numPartitions);
+
+	/**
+   * Destructor of PartitionedBufMgr class
+	 */
+  ~PartitionedBufMgr();
+
+	/**
+	 * Same as BufMgr::readPage().
+	 */
+  void readPage(File* file, const PageId PageNo, Page*& page);
+
+	/**
+	 * Same as BufMgr::pinIfResident().
+	 */
+  bool pinIfResident(File* file, const PageId pageNo, Page*& page);
+
+	/**
+	 * Same as BufMgr::pinIfCached().
+	 */
+  bool pinIfCached(File* file, const PageId pageNo, Page*& page);
+
+	/**
+	 * Same as BufMgr::pinReadPage().
+	 */
+  void pinReadPage(File* file, const PageId pageNo, const Page& image, Page*& page);
+
+#if defined(__cpp_impl_coroutine)
+	/**
+	 * Same as BufMgr::readPageAsync(). The partition is latched only to pin
+	 * the page, never while its read is in flight, so coroutines on several
+	 * threads, each with its own AsyncScheduler, can share the pool.
+	 */
+  PageAwaitable readPageAsync(File* file, const PageId pageNo);
+#endif
+
+	/**
+	 * Same as BufMgr::readPages(). The pages of each partition are read with
+	 * one call into it under its latch, partition after partition; if one
+	 * fails, the pages already pinned in the others are unpinned again.
+	 */
+  void readPages(File* file, const std::vector<PageId>& pageNos, std::vector<Page*>& pages);
+
+	/**
+	 * Same as BufMgr::readSnapshot().
+	 */
+  PageSnapshot readSnapshot(File* file, const PageId PageNo);
+
+	/**
+	 * Same as BufMgr::unPinPage().
+   * @throws  PageNotPinnedException If the page is not already pinned
+	 */
+  void unPinPage(File* file, const PageId PageNo, const bool dirty);
+
+	/**
+	 * Same as BufMgr::allocPage().  The page is reserved in the file first and
+	 * given back to the file if its partition has no free frame.
+	 *
+   * @throws BufferExceededException If the partition of the new page has no frame to give
+	 */
+  void allocPage(File* file, PageId &PageNo, Page*& page);
+
+	/**
+	 * Same as BufMgr::flushFile(), applied to every partition in turn, with
+	 * one sync of the file at the end.
+	 *
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+	 */
+  void flushFile(const File* file);
+
+	/**
+	 * Same as BufMgr::discardFile(), applied to every partition in turn.
+	 *
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+	 */
+  void discardFile(const File* file);
+
+	/**
+	 * Same as BufMgr::disposePage().
+	 */
+  void disposePage(File* file, const PageId PageNo);
+
+	/**
+	 * Same as BufMgr::isResident().  Once the partitions have lock-free page
+	 * tables (see enableLockFreeTable()) it takes no latch, so threads checking
+	 * residency, e.g. to decide what to prefetch, do not contend with the
+	 * threads reading and writing pages.
+	 */
+  bool isResident(const File* file, const PageId pageNo);
+
+	/**
+	 * Same as BufMgr::enableLockFreeTable(), for every partition in turn.
+	 */
+  void enableLockFreeTable();
+
+	/**
+	 * Same as BufMgr::enableSnapshotArena(), giving each partition an arena of
+	 * numPages pages.
+	 */
+  void enableSnapshotArena(const std::uint32_t numPages);
+
+	/**
+	 * Same as BufMgr::enableCompressedCache(), with the capacity split evenly
+	 * between the partitions.
+	 */
+  void enableCompressedCache(const std::size_t capacity);
+
+	/**
+	 * Same as BufMgr::enableCacheFile(), with the pages split evenly between
+	 * the partitions. Partition p keeps its share in the file path.p.
+	 */
+  void enableCacheFile(const std::string& path, const std::uint32_t numPages);
+
+	/**
+	 * Same as BufMgr::enableAsyncIo(). Each partition gets a queue of its own
+	 * with queueDepth slots, since a queue may only be used by one thread.
+	 */
+  void enableAsyncIo(const unsigned queueDepth,
+                     const PageIoQueue::Backend backend = PageIoQueue::AUTO);
+
+	/**
+	 * Same as BufMgr::setWriteCombineWindow(), for every partition.
+	 */
+  void setWriteCombineWindow(const std::uint32_t pages);
+
+	/**
+	 * Same as BufMgr::setFileQuota(). The pages of a file spread over all
+	 * partitions, so each partition gets a share of the quota: minFrames is
+	 * split evenly and maxFrames is split rounding up, so the file may hold up
+	 * to one frame per partition more than maxFrames. If a partition rejects
+	 * its share, the partitions already changed get their earlier quota back.
+	 *
+	 * @throws InvalidQuotaException If minFrames exceeds a non-zero maxFrames or a partition has no room for its share of the reservation
+	 */
+  void setFileQuota(const File* file, const std::uint32_t minFrames, const std::uint32_t maxFrames);
+
+	/**
+	 * Same as BufMgr::clearFileQuota(), for every partition.
+	 */
+  void clearFileQuota(const File* file);
+
+	/**
+   * Print member variable values of every partition.
+	 */
+  void printSelf();
+
+	/**
+	 * Snapshot of every partition merged into one.  Partitions are latched one at
+	 * a time, so the pool as a whole is never stopped.
+	 */
+  BufSnapshot snapshot();
+
+	/**
+   * Get buffer pool usage statistics summed over all partitions
+	 */
+  BufStats getBufStats();
+
+	/**
+   * Clear buffer pool usage statistics of all partitions
+	 */
+  void clearBufStats();
+
+	/**
+   * Returns the number of partitions
+	 */
+  std::uint32_t numPartitions() const
+  {
+		return partitions.size();
+  }
+
+	/**
+	 * Returns the partition a page belongs to.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  std::uint32_t partitionOf(const File* file, const PageId pageNo) const;
+
+ private:
+	/**
+   * The partitions, each a complete buffer manager
+	 */
+  std::vector<BufMgr*> partitions;
+
+	/**
+   * One latch per partition, held for the whole of every call into it
+	 */
+  std::vector<std::mutex> latches;
+
+	/**
+   * Set once every partition has a lock-free page table
+	 */
+  std::atomic<bool> lockFreeTables;
+};
+
+}
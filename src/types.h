@@ -24,6 +24,28 @@ typedef std::uint16_t SlotId;
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Identifier for an open file, unique for the life of the process.
+ */
+typedef std::uint32_t FileId;
+
+/**
+ * @brief Identifier for a page of an open file: the FileId in the high 32 bits
+ *        and the PageId in the low 32 bits.
+ */
+typedef std::uint64_t PageKey;
+
+/**
+ * Packs a file and page number into a PageKey.
+ *
+ * @param file_id     Identifier of the file.
+ * @param page_number Number of the page in the file.
+ * @return  Key of the page.
+ */
+inline PageKey makePageKey(const FileId file_id, const PageId page_number) {
+  return (static_cast<PageKey>(file_id) << 32) | page_number;
+}
+
 /**
  * @brief Identifier for a record in a page.
  */